@@ -7,6 +7,13 @@
 #include <glm/mat4x4.hpp>
 #include <glm/vec4.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/matrix.hpp>
+
+// Matrix_Inverse() utiliza instruções SSE2 quando disponíveis (x86 e x86-64).
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MATRICES_SSE2
+#include <emmintrin.h>
+#endif
 
 // Esta função Matrix() auxilia na criação de matrizes usando a biblioteca GLM.
 // Note que em OpenGL (e GLM) as matrizes são definidas como "column-major",
@@ -320,6 +327,110 @@ glm::mat4 Matrix_Perspective(float field_of_view, float aspect, float n, float f
     return -M*P;
 }
 
+#ifdef MATRICES_SSE2
+// Operações com matrizes 2x2 armazenadas em um registrador SSE como
+// [m00 m01 m10 m11], utilizadas por Matrix_Inverse(). "Adj" é a matriz
+// adjunta (adjugada): adj(A) = det(A) * inversa(A).
+#define MATRICES_SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x))
+#define MATRICES_SWIZZLE(a, x, y, z, w) _mm_castsi128_ps(_mm_shuffle_epi32(_mm_castps_si128(a), _MM_SHUFFLE(w, z, y, x)))
+
+// A*B
+static inline __m128 Matrix2x2_Mul(__m128 a, __m128 b)
+{
+    return _mm_add_ps(_mm_mul_ps(a, MATRICES_SWIZZLE(b, 0, 3, 0, 3)),
+                      _mm_mul_ps(MATRICES_SWIZZLE(a, 1, 0, 3, 2), MATRICES_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+// adj(A)*B
+static inline __m128 Matrix2x2_AdjMul(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(MATRICES_SWIZZLE(a, 3, 3, 0, 0), b),
+                      _mm_mul_ps(MATRICES_SWIZZLE(a, 1, 1, 2, 2), MATRICES_SWIZZLE(b, 2, 3, 0, 1)));
+}
+
+// A*adj(B)
+static inline __m128 Matrix2x2_MulAdj(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(a, MATRICES_SWIZZLE(b, 3, 0, 3, 0)),
+                      _mm_mul_ps(MATRICES_SWIZZLE(a, 1, 0, 3, 2), MATRICES_SWIZZLE(b, 2, 1, 2, 1)));
+}
+#endif
+
+// Matriz inversa de uma matriz M qualquer (inversível). Com SSE2, a inversa é
+// calculada por blocos 2x2 (inversão de matriz particionada, com complementos
+// de Schur), sem divisões além do inverso do determinante:
+//
+//       [A B]                     1    [ |D|A - B adj(D)C   ...  ]
+//   M = [C D]    =>   inversa(M) = --- [          ...        ... ]
+//                                  |M|
+//
+// Como inversa(transposta(M)) = transposta(inversa(M)), a mesma rotina serve
+// para matrizes "column-major": as colunas de M fazem o papel das linhas.
+// Utilizada para as variáveis uniform derivadas, calculadas uma vez por objeto
+// na CPU ao invés de uma vez por vértice ou fragmento na GPU (veja
+// ComputeDerivedUniforms() em "main.cpp").
+glm::mat4 Matrix_Inverse(const glm::mat4 &M)
+{
+#ifdef MATRICES_SSE2
+    __m128 c0 = _mm_loadu_ps(&M[0][0]);
+    __m128 c1 = _mm_loadu_ps(&M[1][0]);
+    __m128 c2 = _mm_loadu_ps(&M[2][0]);
+    __m128 c3 = _mm_loadu_ps(&M[3][0]);
+
+    // Blocos 2x2
+    __m128 A = _mm_movelh_ps(c0, c1);
+    __m128 B = _mm_movehl_ps(c1, c0);
+    __m128 C = _mm_movelh_ps(c2, c3);
+    __m128 D = _mm_movehl_ps(c3, c2);
+
+    // Determinantes dos blocos: (|A|, |B|, |C|, |D|)
+    __m128 det_blocks = _mm_sub_ps(
+        _mm_mul_ps(MATRICES_SHUFFLE(c0, c2, 0, 2, 0, 2), MATRICES_SHUFFLE(c1, c3, 1, 3, 1, 3)),
+        _mm_mul_ps(MATRICES_SHUFFLE(c0, c2, 1, 3, 1, 3), MATRICES_SHUFFLE(c1, c3, 0, 2, 0, 2)));
+    __m128 det_A = MATRICES_SWIZZLE(det_blocks, 0, 0, 0, 0);
+    __m128 det_B = MATRICES_SWIZZLE(det_blocks, 1, 1, 1, 1);
+    __m128 det_C = MATRICES_SWIZZLE(det_blocks, 2, 2, 2, 2);
+    __m128 det_D = MATRICES_SWIZZLE(det_blocks, 3, 3, 3, 3);
+
+    __m128 D_C = Matrix2x2_AdjMul(D, C);
+    __m128 A_B = Matrix2x2_AdjMul(A, B);
+
+    __m128 X = _mm_sub_ps(_mm_mul_ps(det_D, A), Matrix2x2_Mul(B, D_C));
+    __m128 W = _mm_sub_ps(_mm_mul_ps(det_A, D), Matrix2x2_Mul(C, A_B));
+    __m128 Y = _mm_sub_ps(_mm_mul_ps(det_B, C), Matrix2x2_MulAdj(D, A_B));
+    __m128 Z = _mm_sub_ps(_mm_mul_ps(det_C, B), Matrix2x2_MulAdj(A, D_C));
+
+    // |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+    __m128 trace = _mm_mul_ps(A_B, MATRICES_SWIZZLE(D_C, 0, 2, 1, 3));
+    trace = _mm_add_ps(trace, MATRICES_SWIZZLE(trace, 2, 3, 0, 1));
+    trace = _mm_add_ps(trace, MATRICES_SWIZZLE(trace, 1, 0, 3, 2));
+    __m128 det_M = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(det_A, det_D), _mm_mul_ps(det_B, det_C)), trace);
+
+    __m128 inverse_det = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), det_M);
+    X = _mm_mul_ps(X, inverse_det);
+    Y = _mm_mul_ps(Y, inverse_det);
+    Z = _mm_mul_ps(Z, inverse_det);
+    W = _mm_mul_ps(W, inverse_det);
+
+    glm::mat4 R;
+    _mm_storeu_ps(&R[0][0], MATRICES_SHUFFLE(X, Y, 3, 1, 3, 1));
+    _mm_storeu_ps(&R[1][0], MATRICES_SHUFFLE(X, Y, 2, 0, 2, 0));
+    _mm_storeu_ps(&R[2][0], MATRICES_SHUFFLE(Z, W, 3, 1, 3, 1));
+    _mm_storeu_ps(&R[3][0], MATRICES_SHUFFLE(Z, W, 2, 0, 2, 0));
+    return R;
+#else
+    return glm::inverse(M);
+#endif
+}
+
+// Matriz de transformação de normais de um objeto com matriz de modelagem
+// "model": a transposta da inversa. Veja slides 123-151 do documento
+// Aula_07_Transformacoes_Geometricas_3D.pdf.
+glm::mat4 Matrix_Normal(const glm::mat4 &model)
+{
+    return glm::transpose(Matrix_Inverse(model));
+}
+
 // Função que imprime uma matriz M no terminal
 void PrintMatrix(glm::mat4 M)
 {
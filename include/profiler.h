@@ -0,0 +1,55 @@
+#ifndef _PROFILER_H
+#define _PROFILER_H
+
+// Profiler de CPU por zonas. Uma zona é um escopo C++ marcado com
+// PROFILE_ZONE("nome") (ou PROFILE_FUNCTION(), com o nome da função): o
+// tempo de entrada e de saída do escopo é registrado em um buffer circular
+// da thread que o executou, sem travas. Os registros mais recentes de todas
+// as threads podem ser gravados em um arquivo JSON no formato "trace event"
+// do Chrome, para visualização em chrome://tracing ou https://ui.perfetto.dev.
+// Veja "profiler.cpp".
+//
+// Os nomes das zonas devem ser strings com duração estática (literais ou
+// __func__), pois somente o ponteiro é guardado.
+//
+// Compilando com -DPROFILER_DISABLED as zonas não geram código algum.
+
+#include <chrono>
+
+// Instante atual em nanossegundos, de um relógio monotônico.
+inline unsigned long long Profiler_Now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Registra uma zona no buffer da thread atual. Definida em "profiler.cpp".
+void Profiler_Record(const char *name, unsigned long long start_ns, unsigned long long end_ns);
+
+// Dá um nome à thread atual no arquivo de trace ("render", "simulation", ...).
+void Profiler_SetThreadName(const char *name);
+
+// Grava em "filename" as zonas terminadas nos últimos "seconds" segundos (ou
+// todas as zonas ainda nos buffers, se "seconds" <= 0). Retorna false se o
+// arquivo não pôde ser escrito.
+bool Profiler_WriteChromeTrace(const char *filename, double seconds);
+
+struct ProfilerZone
+{
+    const char *name;
+    unsigned long long start_ns;
+
+    explicit ProfilerZone(const char *zone_name) : name(zone_name), start_ns(Profiler_Now()) {}
+    ~ProfilerZone() { Profiler_Record(name, start_ns, Profiler_Now()); }
+};
+
+#define PROFILER_CONCAT_(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_(a, b)
+
+#if defined(PROFILER_DISABLED)
+#define PROFILE_ZONE(name)
+#else
+#define PROFILE_ZONE(name) ProfilerZone PROFILER_CONCAT(profiler_zone_, __LINE__)(name)
+#endif
+#define PROFILE_FUNCTION() PROFILE_ZONE(__func__)
+
+#endif // _PROFILER_H
@@ -0,0 +1,325 @@
+// Modo de benchmark (opção "--benchmark <roteiro>"): um teste de desempenho
+// repetível, sem ninguém jogando. O roteiro é um arquivo texto que define o
+// número de quadros, o tamanho da imagem, o caminho da câmera pelas salas e o
+// estado forçado do jogo (portas, alavancas) e das opções de renderização.
+// Cada quadro é desenhado em um contexto sem janela (veja "offscreen.cpp" e
+// RunBenchmark() em "main.cpp"), e os tempos e contagens de cada quadro são
+// gravados em arquivos CSV.
+//
+// Formato do roteiro, um comando por linha ('#' inicia um comentário):
+//
+//   frames <n>                    Número de quadros desenhados
+//   size <largura> <altura>       Tamanho da imagem, em pixels
+//   camera <px py pz> <lx ly lz>  Ponto de controle do caminho: posição da
+//                                 câmera e ponto para onde ela olha
+//   set <quadro> <nome> <valor>   A partir do quadro, força o valor da
+//                                 variável "nome" (veja SetBenchmarkVariable())
+//
+// Os pontos de controle formam curvas de Bézier cúbicas encadeadas, como as
+// da esfera de dica (veja bezierTipCurve()): os pontos 0 a 3 definem a
+// primeira curva, os pontos 3 a 6 a segunda, e assim por diante, de modo que
+// são necessários 3k+1 pontos para k curvas. O parâmetro das curvas avança
+// uniformemente ao longo dos quadros.
+//
+// Resultados: "<saída>_frames.csv", com uma linha por quadro, e
+// "<saída>_load.csv", com o tempo de cada etapa da carga. Por padrão <saída>
+// é o nome do roteiro, sem o diretório e a extensão, no diretório atual.
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+struct BenchmarkStateChange
+{
+    int frame;        // Quadro a partir do qual o valor é forçado
+    std::string name; // Nome da variável
+    int value;
+};
+
+struct BenchmarkFrame
+{
+    double frame_ms;            // Tempo total do quadro
+    double cpu_ms;              // Tempo de CPU da montagem e submissão do quadro
+    std::vector<double> gpu_ms; // Tempo de GPU de cada passada (vazio se não medido)
+    int draw_calls;
+    size_t triangles;
+    int objects; // Objetos na lista de desenho, após o culling
+};
+
+struct BenchmarkLoadPhase
+{
+    std::string name;
+    double ms;
+};
+
+static std::string g_BenchmarkScript;
+static int g_BenchmarkFrames = 600;
+static int g_BenchmarkWidth = 800;
+static int g_BenchmarkHeight = 600;
+static std::vector<glm::vec3> g_BenchmarkPositions; // Pontos de controle da posição da câmera
+static std::vector<glm::vec3> g_BenchmarkTargets;   // Pontos de controle do ponto observado
+static std::vector<BenchmarkStateChange> g_BenchmarkStateChanges;
+static std::vector<BenchmarkFrame> g_BenchmarkResults;
+static std::vector<BenchmarkLoadPhase> g_BenchmarkLoadPhases;
+
+static bool BenchmarkChangeOrder(const BenchmarkStateChange &a, const BenchmarkStateChange &b)
+{
+    return a.frame < b.frame;
+}
+
+// Lê o roteiro "filename". Retorna false, após imprimir o erro, se o arquivo
+// não existe ou é inválido.
+bool Benchmark_LoadScript(const char *filename)
+{
+    std::ifstream file(filename);
+    if (!file)
+    {
+        fprintf(stderr, "ERROR: Cannot open benchmark script \"%s\".\n", filename);
+        return false;
+    }
+
+    g_BenchmarkScript = filename;
+    g_BenchmarkPositions.clear();
+    g_BenchmarkTargets.clear();
+    g_BenchmarkStateChanges.clear();
+
+    std::string line;
+    for (int line_number = 1; std::getline(file, line); ++line_number)
+    {
+        std::string::size_type comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+
+        std::istringstream tokens(line);
+        std::string command;
+        if (!(tokens >> command))
+            continue;
+
+        bool ok;
+        if (command == "frames")
+        {
+            ok = (tokens >> g_BenchmarkFrames) && g_BenchmarkFrames > 0;
+        }
+        else if (command == "size")
+        {
+            ok = (tokens >> g_BenchmarkWidth >> g_BenchmarkHeight) && g_BenchmarkWidth > 0 && g_BenchmarkHeight > 0;
+        }
+        else if (command == "camera")
+        {
+            glm::vec3 position, target;
+            ok = !!(tokens >> position.x >> position.y >> position.z >> target.x >> target.y >> target.z);
+            g_BenchmarkPositions.push_back(position);
+            g_BenchmarkTargets.push_back(target);
+        }
+        else if (command == "set")
+        {
+            BenchmarkStateChange change;
+            ok = (tokens >> change.frame >> change.name >> change.value) && change.frame >= 0;
+            g_BenchmarkStateChanges.push_back(change);
+        }
+        else
+        {
+            ok = false;
+        }
+
+        std::string extra;
+        if (!ok || (tokens >> extra))
+        {
+            fprintf(stderr, "ERROR: %s:%d: invalid benchmark command \"%s\".\n", filename, line_number, line.c_str());
+            return false;
+        }
+    }
+
+    if (g_BenchmarkPositions.size() < 4 || (g_BenchmarkPositions.size() - 1) % 3 != 0)
+    {
+        fprintf(stderr, "ERROR: %s: the camera path needs 3k+1 control points (found %d).\n", filename, (int)g_BenchmarkPositions.size());
+        return false;
+    }
+
+    // As mudanças de estado são aplicadas em ordem de quadro; mudanças do
+    // mesmo quadro, na ordem do roteiro.
+    std::stable_sort(g_BenchmarkStateChanges.begin(), g_BenchmarkStateChanges.end(), BenchmarkChangeOrder);
+
+    g_BenchmarkResults.assign(g_BenchmarkFrames, BenchmarkFrame());
+
+    printf("Benchmark: roteiro \"%s\", %d quadros %dx%d, %d curvas, %d mudanças de estado\n",
+           filename, g_BenchmarkFrames, g_BenchmarkWidth, g_BenchmarkHeight,
+           (int)(g_BenchmarkPositions.size() - 1) / 3, (int)g_BenchmarkStateChanges.size());
+    return true;
+}
+
+int Benchmark_Frames()
+{
+    return g_BenchmarkFrames;
+}
+
+int Benchmark_Width()
+{
+    return g_BenchmarkWidth;
+}
+
+int Benchmark_Height()
+{
+    return g_BenchmarkHeight;
+}
+
+int Benchmark_NumStateChanges()
+{
+    return (int)g_BenchmarkStateChanges.size();
+}
+
+// Retorna o nome da variável da mudança de estado "index" (na ordem dos
+// quadros), e o quadro e o valor da mesma em "frame" e "value".
+const char *Benchmark_StateChange(int index, int *frame, int *value)
+{
+    const BenchmarkStateChange &change = g_BenchmarkStateChanges[index];
+    *frame = change.frame;
+    *value = change.value;
+    return change.name.c_str();
+}
+
+// Ponto da curva de Bézier cúbica de pontos de controle p[0..3], com t de 0 a
+// 1, pelo algoritmo de de Casteljau (como em bezierTipCurve()).
+static glm::vec3 Benchmark_Bezier(const glm::vec3 *p, float t)
+{
+    glm::vec3 c_01 = p[0] + t * (p[1] - p[0]);
+    glm::vec3 c_12 = p[1] + t * (p[2] - p[1]);
+    glm::vec3 c_23 = p[2] + t * (p[3] - p[2]);
+    glm::vec3 c_01_12 = c_01 + t * (c_12 - c_01);
+    glm::vec3 c_12_23 = c_12 + t * (c_23 - c_12);
+    return c_01_12 + t * (c_12_23 - c_01_12);
+}
+
+// Posição da câmera e ponto para onde ela olha no quadro "frame".
+void Benchmark_Camera(int frame, glm::vec4 &position, glm::vec4 &look_at)
+{
+    int num_curves = (int)(g_BenchmarkPositions.size() - 1) / 3;
+    float t = g_BenchmarkFrames > 1 ? (float)num_curves * frame / (g_BenchmarkFrames - 1) : 0.0f;
+    int curve = std::min((int)t, num_curves - 1);
+
+    glm::vec3 p = Benchmark_Bezier(&g_BenchmarkPositions[3 * curve], t - curve);
+    glm::vec3 l = Benchmark_Bezier(&g_BenchmarkTargets[3 * curve], t - curve);
+    position = glm::vec4(p.x, p.y, p.z, 1.0f);
+    look_at = glm::vec4(l.x, l.y, l.z, 1.0f);
+}
+
+void Benchmark_RecordLoadPhase(const char *name, double seconds)
+{
+    BenchmarkLoadPhase phase;
+    phase.name = name;
+    phase.ms = 1000.0 * seconds;
+    g_BenchmarkLoadPhases.push_back(phase);
+}
+
+// Registra os tempos e contagens do quadro "frame". Os tempos de GPU chegam
+// alguns quadros depois (veja Benchmark_RecordGpuTimes()).
+void Benchmark_RecordFrame(int frame, double frame_seconds, double cpu_seconds, int draw_calls, size_t triangles, int objects)
+{
+    BenchmarkFrame &result = g_BenchmarkResults[frame];
+    result.frame_ms = 1000.0 * frame_seconds;
+    result.cpu_ms = 1000.0 * cpu_seconds;
+    result.draw_calls = draw_calls;
+    result.triangles = triangles;
+    result.objects = objects;
+}
+
+void Benchmark_RecordGpuTimes(int frame, const double *pass_ms, int num_passes)
+{
+    g_BenchmarkResults[frame].gpu_ms.assign(pass_ms, pass_ms + num_passes);
+}
+
+// Grava os resultados em "<prefix>_frames.csv" e "<prefix>_load.csv" (com
+// "prefix" NULL, o nome do roteiro sem o diretório e a extensão) e imprime um resumo no
+// terminal. "pass_names" contém o nome de cada uma das "num_passes" passadas
+// medidas na GPU. Retorna false se algum arquivo não pôde ser escrito.
+bool Benchmark_WriteResults(const char *prefix, const char *const *pass_names, int num_passes)
+{
+    std::string base;
+    if (prefix != NULL)
+    {
+        base = prefix;
+    }
+    else
+    {
+        base = g_BenchmarkScript;
+        std::string::size_type slash = base.find_last_of("/\\");
+        if (slash != std::string::npos)
+            base.erase(0, slash + 1);
+        std::string::size_type dot = base.find_last_of('.');
+        if (dot != std::string::npos)
+            base.erase(dot);
+    }
+    std::string frames_filename = base + "_frames.csv";
+    std::string load_filename = base + "_load.csv";
+
+    FILE *file = fopen(frames_filename.c_str(), "w");
+    if (file == NULL)
+    {
+        fprintf(stderr, "ERROR: Cannot write \"%s\".\n", frames_filename.c_str());
+        return false;
+    }
+
+    fprintf(file, "frame,frame_ms,cpu_ms,gpu_ms");
+    for (int pass = 0; pass < num_passes; ++pass)
+        fprintf(file, ",gpu_%s_ms", pass_names[pass]);
+    fprintf(file, ",draw_calls,triangles,objects\n");
+
+    double total_frame_ms = 0.0, total_cpu_ms = 0.0, total_gpu_ms = 0.0;
+    double total_draw_calls = 0.0, total_triangles = 0.0;
+    int gpu_frames = 0;
+    for (int frame = 0; frame < g_BenchmarkFrames; ++frame)
+    {
+        const BenchmarkFrame &result = g_BenchmarkResults[frame];
+        fprintf(file, "%d,%.4f,%.4f", frame, result.frame_ms, result.cpu_ms);
+
+        // Passadas não medidas no quadro (por exemplo, a passada de
+        // profundidade desligada) têm tempo zero.
+        if ((int)result.gpu_ms.size() == num_passes)
+        {
+            double gpu_ms = 0.0;
+            for (int pass = 0; pass < num_passes; ++pass)
+                gpu_ms += result.gpu_ms[pass];
+            fprintf(file, ",%.4f", gpu_ms);
+            for (int pass = 0; pass < num_passes; ++pass)
+                fprintf(file, ",%.4f", result.gpu_ms[pass]);
+            total_gpu_ms += gpu_ms;
+            gpu_frames += 1;
+        }
+        else
+        {
+            fprintf(file, ",");
+            for (int pass = 0; pass < num_passes; ++pass)
+                fprintf(file, ",");
+        }
+        fprintf(file, ",%d,%lu,%d\n", result.draw_calls, (unsigned long)result.triangles, result.objects);
+
+        total_frame_ms += result.frame_ms;
+        total_cpu_ms += result.cpu_ms;
+        total_draw_calls += result.draw_calls;
+        total_triangles += result.triangles;
+    }
+    fclose(file);
+
+    file = fopen(load_filename.c_str(), "w");
+    if (file == NULL)
+    {
+        fprintf(stderr, "ERROR: Cannot write \"%s\".\n", load_filename.c_str());
+        return false;
+    }
+    fprintf(file, "phase,ms\n");
+    for (size_t i = 0; i < g_BenchmarkLoadPhases.size(); ++i)
+        fprintf(file, "%s,%.3f\n", g_BenchmarkLoadPhases[i].name.c_str(), g_BenchmarkLoadPhases[i].ms);
+    fclose(file);
+
+    int n = g_BenchmarkFrames;
+    printf("Benchmark: %d quadros, média %.3f ms/quadro (CPU %.3f ms, GPU %.3f ms), %.1f chamadas de desenho e %.0f triângulos por quadro\n",
+           n, total_frame_ms / n, total_cpu_ms / n, gpu_frames > 0 ? total_gpu_ms / gpu_frames : 0.0,
+           total_draw_calls / n, total_triangles / n);
+    printf("Benchmark: resultados gravados em \"%s\" e \"%s\"\n", frames_filename.c_str(), load_filename.c_str());
+    return true;
+}
@@ -0,0 +1,212 @@
+// Estatísticas do tempo por quadro. A média de quadros por segundo esconde
+// os quadros lentos isolados ("stutters"), percebidos pelo jogador; por isso
+// guardamos também a distribuição dos tempos:
+//
+//  - os tempos dos últimos FRAMESTATS_WINDOW quadros, em um buffer circular,
+//    de onde calculamos os percentis 50, 95 e 99 e o máximo recentes, e
+//    desenhamos o gráfico de FrameStats_DrawGraph();
+//  - um histograma de todos os quadros da execução, com intervalos de
+//    FRAMESTATS_BIN_MS, de onde calculamos os percentis do resumo impresso
+//    no terminal ao final (FrameStats_PrintSummary()), para comparação entre
+//    execuções.
+//
+// Um quadro acima do orçamento é um quadro mais lento que o intervalo de
+// atualização do monitor (veja FrameStats_Init()).
+#include <cstdio>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include <glad/glad.h>
+
+void CompileShader(const std::string &source, GLuint shader_id, const char *filename); // Função definida em main.cpp
+GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id); // Função definida em main.cpp
+
+#define FRAMESTATS_WINDOW 240       // Quadros no buffer circular
+#define FRAMESTATS_BIN_MS 0.1       // Largura dos intervalos do histograma
+#define FRAMESTATS_NUM_BINS 2000    // Intervalos do histograma (até 200 ms; o último acumula os quadros mais lentos)
+
+static double g_FrameStatsBudgetMs = 1000.0 / 60.0;
+
+// Buffer circular dos últimos quadros, em milissegundos.
+static float g_FrameStatsWindow[FRAMESTATS_WINDOW];
+static int g_FrameStatsWindowCount = 0;
+static int g_FrameStatsWindowNext = 0;
+
+// Histograma e totais desde FrameStats_Init().
+static unsigned long g_FrameStatsHistogram[FRAMESTATS_NUM_BINS];
+static unsigned long g_FrameStatsFrames = 0;
+static unsigned long g_FrameStatsOverBudget = 0;
+static double g_FrameStatsTotalMs = 0.0;
+static double g_FrameStatsMaxMs = 0.0;
+
+// Recursos do gráfico.
+static GLuint g_FrameStatsProgram = 0;
+static GLint g_FrameStatsColorUniform;
+static GLuint g_FrameStatsVAO;
+static GLuint g_FrameStatsVBO;
+
+const GLchar *const framestats_vertexshader_source = ""
+"#version 330\n"
+"layout (location = 0) in vec2 position;\n"
+"void main()\n"
+"{\n"
+"    gl_Position = vec4(position, 0, 1);\n"
+"}\n";
+
+const GLchar *const framestats_fragmentshader_source = ""
+"#version 330\n"
+"uniform vec4 color;\n"
+"out vec4 fragColor;\n"
+"void main()\n"
+"{\n"
+"    fragColor = color;\n"
+"}\n";
+
+// Inicializa as estatísticas com o orçamento de tempo por quadro dado, em
+// milissegundos, e cria os recursos do gráfico. Deve ser chamada após a
+// criação do contexto OpenGL.
+void FrameStats_Init(double budget_ms)
+{
+    g_FrameStatsBudgetMs = budget_ms;
+
+    GLuint vertexshader_id = glCreateShader(GL_VERTEX_SHADER);
+    GLuint fragmentshader_id = glCreateShader(GL_FRAGMENT_SHADER);
+    CompileShader(framestats_vertexshader_source, vertexshader_id, "framestats_vertexshader_source");
+    CompileShader(framestats_fragmentshader_source, fragmentshader_id, "framestats_fragmentshader_source");
+    g_FrameStatsProgram = CreateGpuProgram(vertexshader_id, fragmentshader_id);
+    g_FrameStatsColorUniform = glGetUniformLocation(g_FrameStatsProgram, "color");
+
+    // Espaço para a linha do gráfico e para a linha do orçamento.
+    glGenVertexArrays(1, &g_FrameStatsVAO);
+    glGenBuffers(1, &g_FrameStatsVBO);
+    glBindVertexArray(g_FrameStatsVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, g_FrameStatsVBO);
+    glBufferData(GL_ARRAY_BUFFER, (FRAMESTATS_WINDOW + 2) * 2 * sizeof(float), NULL, GL_STREAM_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+// Acumula o tempo de um quadro, em segundos.
+void FrameStats_AddFrame(double seconds)
+{
+    double ms = 1000.0 * seconds;
+
+    g_FrameStatsWindow[g_FrameStatsWindowNext] = (float)ms;
+    g_FrameStatsWindowNext = (g_FrameStatsWindowNext + 1) % FRAMESTATS_WINDOW;
+    g_FrameStatsWindowCount = std::min(g_FrameStatsWindowCount + 1, FRAMESTATS_WINDOW);
+
+    int bin = std::min((int)(ms / FRAMESTATS_BIN_MS), FRAMESTATS_NUM_BINS - 1);
+    g_FrameStatsHistogram[bin] += 1;
+    g_FrameStatsFrames += 1;
+    g_FrameStatsTotalMs += ms;
+    g_FrameStatsMaxMs = std::max(g_FrameStatsMaxMs, ms);
+    if (ms > g_FrameStatsBudgetMs)
+        g_FrameStatsOverBudget += 1;
+}
+
+double FrameStats_BudgetMs()
+{
+    return g_FrameStatsBudgetMs;
+}
+
+// Calcula os percentis 50, 95 e 99, o máximo e o número de quadros acima do
+// orçamento dos últimos FRAMESTATS_WINDOW quadros, em milissegundos.
+// Retorna o número de quadros considerados (zero antes do primeiro quadro).
+int FrameStats_Window(double *p50, double *p95, double *p99, double *max_ms, int *over_budget)
+{
+    static std::vector<float> sorted;
+    sorted.assign(g_FrameStatsWindow, g_FrameStatsWindow + g_FrameStatsWindowCount);
+    if (sorted.empty())
+    {
+        *p50 = *p95 = *p99 = *max_ms = 0.0;
+        *over_budget = 0;
+        return 0;
+    }
+    std::sort(sorted.begin(), sorted.end());
+
+    // Percentil pelo método do posto mais próximo ("nearest rank").
+    int n = (int)sorted.size();
+    *p50 = sorted[std::max((n * 50 + 99) / 100 - 1, 0)];
+    *p95 = sorted[std::max((n * 95 + 99) / 100 - 1, 0)];
+    *p99 = sorted[std::max((n * 99 + 99) / 100 - 1, 0)];
+    *max_ms = sorted[n - 1];
+    *over_budget = (int)(sorted.end() - std::upper_bound(sorted.begin(), sorted.end(), (float)g_FrameStatsBudgetMs));
+    return n;
+}
+
+// Percentil "percent" de todos os quadros da execução, em milissegundos,
+// dado pelo limite superior do intervalo do histograma onde se encontra.
+static double FrameStats_HistogramPercentile(int percent)
+{
+    unsigned long rank = (g_FrameStatsFrames * percent + 99) / 100;
+    unsigned long count = 0;
+    for (int bin = 0; bin < FRAMESTATS_NUM_BINS - 1; ++bin)
+    {
+        count += g_FrameStatsHistogram[bin];
+        if (count >= rank)
+            return (bin + 1) * FRAMESTATS_BIN_MS;
+    }
+    return g_FrameStatsMaxMs;
+}
+
+// Desenha o gráfico dos tempos dos últimos FRAMESTATS_WINDOW quadros no
+// retângulo [x0,x1]x[y0,y1] (em NDC) da tela, do mais antigo (à esquerda) ao
+// mais recente. A altura do retângulo corresponde a duas vezes o orçamento,
+// indicado por uma linha vermelha; quadros mais lentos são cortados no topo.
+void FrameStats_DrawGraph(float x0, float y0, float x1, float y1)
+{
+    if (g_FrameStatsWindowCount < 2)
+        return;
+
+    float data[(FRAMESTATS_WINDOW + 2) * 2];
+    float scale = (y1 - y0) / (float)(2.0 * g_FrameStatsBudgetMs);
+    int first = (g_FrameStatsWindowNext - g_FrameStatsWindowCount + FRAMESTATS_WINDOW) % FRAMESTATS_WINDOW;
+    for (int i = 0; i < g_FrameStatsWindowCount; ++i)
+    {
+        float ms = g_FrameStatsWindow[(first + i) % FRAMESTATS_WINDOW];
+        data[2 * i + 0] = x0 + (x1 - x0) * i / (FRAMESTATS_WINDOW - 1);
+        data[2 * i + 1] = std::min(y0 + ms * scale, y1);
+    }
+
+    float budget_y = y0 + (float)g_FrameStatsBudgetMs * scale;
+    float *budget_line = data + 2 * g_FrameStatsWindowCount;
+    budget_line[0] = x0;
+    budget_line[1] = budget_y;
+    budget_line[2] = x1;
+    budget_line[3] = budget_y;
+
+    glBindBuffer(GL_ARRAY_BUFFER, g_FrameStatsVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(data), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, (g_FrameStatsWindowCount + 2) * 2 * sizeof(float), data);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glDepthFunc(GL_ALWAYS);
+    glUseProgram(g_FrameStatsProgram);
+    glBindVertexArray(g_FrameStatsVAO);
+
+    glUniform4f(g_FrameStatsColorUniform, 1.0f, 0.0f, 0.0f, 1.0f);
+    glDrawArrays(GL_LINES, g_FrameStatsWindowCount, 2);
+    glUniform4f(g_FrameStatsColorUniform, 0.0f, 0.0f, 0.0f, 1.0f);
+    glDrawArrays(GL_LINE_STRIP, 0, g_FrameStatsWindowCount);
+
+    glBindVertexArray(0);
+    glUseProgram(0);
+    glDepthFunc(GL_LESS);
+}
+
+// Imprime no terminal o resumo dos tempos de todos os quadros da execução.
+void FrameStats_PrintSummary()
+{
+    if (g_FrameStatsFrames == 0)
+        return;
+
+    printf("Tempo por quadro: %lu quadros, média %.2f ms, p50 %.1f ms, p95 %.1f ms, p99 %.1f ms, máximo %.1f ms\n",
+           g_FrameStatsFrames, g_FrameStatsTotalMs / g_FrameStatsFrames,
+           FrameStats_HistogramPercentile(50), FrameStats_HistogramPercentile(95), FrameStats_HistogramPercentile(99),
+           g_FrameStatsMaxMs);
+    printf("  %lu quadros (%.2f%%) acima do orçamento de %.2f ms\n",
+           g_FrameStatsOverBudget, 100.0 * g_FrameStatsOverBudget / g_FrameStatsFrames, g_FrameStatsBudgetMs);
+}
@@ -0,0 +1,231 @@
+// Frustum culling dos objetos da cena virtual na CPU. Cada objeto é
+// representado pela sua axis-aligned bounding box (AABB) em coordenadas de
+// modelo, a qual é transformada pela matriz "model" do objeto e testada contra
+// os seis planos do frustum da câmera. As caixas são processadas em grupos de
+// 8 (AVX) ou 4 (SSE) por iteração, com um caminho escalar para as caixas
+// restantes e para processadores sem essas instruções.
+//
+// Veja o documento Aula_13_Clipping_and_Culling.pdf.
+#include <cmath>
+#include <cstddef>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+// O caminho SSE só é compilado quando o compilador gera SSE2 por padrão (como
+// em include/matrices.h), e o caminho AVX, escolhido em tempo de execução,
+// depende de extensões do GCC; nos demais casos, é utilizado o caminho escalar.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUMCULLING_SSE
+#include <immintrin.h>
+#if defined(__GNUC__)
+#define FRUSTUMCULLING_AVX
+#endif
+#endif
+
+// Extrai os seis planos do frustum (left, right, bottom, top, near, far) da
+// matriz clip = projection * view, pelo método de Gribb e Hartmann: um ponto p
+// em coordenadas do mundo está dentro do volume de visualização se
+// -w <= x,y,z <= w, onde [x y z w] = clip * p. Cada desigualdade corresponde a
+// um plano com a forma dot(plane.xyz, p) + plane.w >= 0.
+void FrustumCulling_ExtractPlanes(const glm::mat4 &clip, glm::vec4 planes[6])
+{
+    // Linhas da matriz (GLM armazena as matrizes por colunas)
+    glm::vec4 row0 = glm::vec4(clip[0][0], clip[1][0], clip[2][0], clip[3][0]);
+    glm::vec4 row1 = glm::vec4(clip[0][1], clip[1][1], clip[2][1], clip[3][1]);
+    glm::vec4 row2 = glm::vec4(clip[0][2], clip[1][2], clip[2][2], clip[3][2]);
+    glm::vec4 row3 = glm::vec4(clip[0][3], clip[1][3], clip[2][3], clip[3][3]);
+
+    planes[0] = row3 + row0; // left
+    planes[1] = row3 - row0; // right
+    planes[2] = row3 + row1; // bottom
+    planes[3] = row3 - row1; // top
+    planes[4] = row3 + row2; // near
+    planes[5] = row3 - row2; // far
+}
+
+// Teste de uma única caixa. A AABB é transformada para coordenadas do mundo
+// pelo método de Arvo: o centro é transformado pela matriz, e a extensão
+// (metade do tamanho) pelo valor absoluto da parte 3x3 da matriz. A caixa está
+// fora do frustum se estiver inteiramente no lado negativo de algum plano.
+static bool FrustumCulling_TestBox(const glm::vec4 planes[6], const glm::mat4 &model, const glm::vec3 &bbox_min, const glm::vec3 &bbox_max)
+{
+    glm::vec3 center = 0.5f * (bbox_min + bbox_max);
+    glm::vec3 extent = 0.5f * (bbox_max - bbox_min);
+
+    glm::vec3 world_center = glm::vec3(model[0]) * center.x + glm::vec3(model[1]) * center.y + glm::vec3(model[2]) * center.z + glm::vec3(model[3]);
+    glm::vec3 world_extent = glm::abs(glm::vec3(model[0])) * extent.x + glm::abs(glm::vec3(model[1])) * extent.y + glm::abs(glm::vec3(model[2])) * extent.z;
+
+    for (int i = 0; i < 6; ++i)
+    {
+        float d = planes[i].x * world_center.x + planes[i].y * world_center.y + planes[i].z * world_center.z + planes[i].w;
+        float r = fabsf(planes[i].x) * world_extent.x + fabsf(planes[i].y) * world_extent.y + fabsf(planes[i].z) * world_extent.z;
+        if (d + r < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+#ifdef FRUSTUMCULLING_SSE
+
+// Testa as caixas [first, first+4) com SSE. Os dados de 4 caixas são
+// reorganizados no formato "structure of arrays", onde cada registrador guarda
+// o mesmo coeficiente das 4 caixas, e cada operação processa as 4 caixas.
+static void FrustumCulling_TestBoxes4(const glm::vec4 planes[6], const glm::mat4 *models, const glm::vec3 *bbox_min, const glm::vec3 *bbox_max, size_t first, unsigned char *visible)
+{
+    const glm::mat4 &m0 = models[first + 0];
+    const glm::mat4 &m1 = models[first + 1];
+    const glm::mat4 &m2 = models[first + 2];
+    const glm::mat4 &m3 = models[first + 3];
+
+#define SOA4(expr0, expr1, expr2, expr3) _mm_set_ps(expr3, expr2, expr1, expr0)
+#define MATRIX4(col, row) SOA4(m0[col][row], m1[col][row], m2[col][row], m3[col][row])
+#define BOX4(array, coord) SOA4(array[first + 0].coord, array[first + 1].coord, array[first + 2].coord, array[first + 3].coord)
+
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+
+    __m128 min_x = BOX4(bbox_min, x), min_y = BOX4(bbox_min, y), min_z = BOX4(bbox_min, z);
+    __m128 max_x = BOX4(bbox_max, x), max_y = BOX4(bbox_max, y), max_z = BOX4(bbox_max, z);
+
+    __m128 cx = _mm_mul_ps(half, _mm_add_ps(min_x, max_x));
+    __m128 cy = _mm_mul_ps(half, _mm_add_ps(min_y, max_y));
+    __m128 cz = _mm_mul_ps(half, _mm_add_ps(min_z, max_z));
+    __m128 ex = _mm_mul_ps(half, _mm_sub_ps(max_x, min_x));
+    __m128 ey = _mm_mul_ps(half, _mm_sub_ps(max_y, min_y));
+    __m128 ez = _mm_mul_ps(half, _mm_sub_ps(max_z, min_z));
+
+    __m128 world_c[3];
+    __m128 world_e[3];
+    for (int row = 0; row < 3; ++row)
+    {
+        __m128 a = MATRIX4(0, row), b = MATRIX4(1, row), c = MATRIX4(2, row), t = MATRIX4(3, row);
+
+        world_c[row] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, cx), _mm_mul_ps(b, cy)), _mm_add_ps(_mm_mul_ps(c, cz), t));
+        world_e[row] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(sign_mask, a), ex),
+                                             _mm_mul_ps(_mm_andnot_ps(sign_mask, b), ey)),
+                                  _mm_mul_ps(_mm_andnot_ps(sign_mask, c), ez));
+    }
+
+    __m128 outside = _mm_setzero_ps();
+    for (int i = 0; i < 6; ++i)
+    {
+        __m128 px = _mm_set1_ps(planes[i].x), py = _mm_set1_ps(planes[i].y), pz = _mm_set1_ps(planes[i].z);
+
+        __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, world_c[0]), _mm_mul_ps(py, world_c[1])),
+                              _mm_add_ps(_mm_mul_ps(pz, world_c[2]), _mm_set1_ps(planes[i].w)));
+        __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(sign_mask, px), world_e[0]),
+                                         _mm_mul_ps(_mm_andnot_ps(sign_mask, py), world_e[1])),
+                              _mm_mul_ps(_mm_andnot_ps(sign_mask, pz), world_e[2]));
+
+        outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(d, r), _mm_setzero_ps()));
+    }
+
+    int outside_bits = _mm_movemask_ps(outside);
+    for (int k = 0; k < 4; ++k)
+        visible[first + k] = !(outside_bits & (1 << k));
+
+#undef SOA4
+#undef MATRIX4
+#undef BOX4
+}
+
+#ifdef FRUSTUMCULLING_AVX
+
+// Mesmo teste acima, para 8 caixas por iteração com AVX. A função é compilada
+// para AVX independentemente das flags do compilador e só é chamada caso o
+// processador suporte essas instruções (veja FrustumCulling_TestBoxes()).
+__attribute__((target("avx")))
+static void FrustumCulling_TestBoxes8(const glm::vec4 planes[6], const glm::mat4 *models, const glm::vec3 *bbox_min, const glm::vec3 *bbox_max, size_t first, unsigned char *visible)
+{
+    const glm::mat4 *m = models + first;
+    const glm::vec3 *bmin = bbox_min + first;
+    const glm::vec3 *bmax = bbox_max + first;
+
+#define MATRIX8(col, row) _mm256_set_ps(m[7][col][row], m[6][col][row], m[5][col][row], m[4][col][row], m[3][col][row], m[2][col][row], m[1][col][row], m[0][col][row])
+#define BOX8(array, coord) _mm256_set_ps(array[7].coord, array[6].coord, array[5].coord, array[4].coord, array[3].coord, array[2].coord, array[1].coord, array[0].coord)
+
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+
+    __m256 min_x = BOX8(bmin, x), min_y = BOX8(bmin, y), min_z = BOX8(bmin, z);
+    __m256 max_x = BOX8(bmax, x), max_y = BOX8(bmax, y), max_z = BOX8(bmax, z);
+
+    __m256 cx = _mm256_mul_ps(half, _mm256_add_ps(min_x, max_x));
+    __m256 cy = _mm256_mul_ps(half, _mm256_add_ps(min_y, max_y));
+    __m256 cz = _mm256_mul_ps(half, _mm256_add_ps(min_z, max_z));
+    __m256 ex = _mm256_mul_ps(half, _mm256_sub_ps(max_x, min_x));
+    __m256 ey = _mm256_mul_ps(half, _mm256_sub_ps(max_y, min_y));
+    __m256 ez = _mm256_mul_ps(half, _mm256_sub_ps(max_z, min_z));
+
+    __m256 world_c[3];
+    __m256 world_e[3];
+    for (int row = 0; row < 3; ++row)
+    {
+        __m256 a = MATRIX8(0, row), b = MATRIX8(1, row), c = MATRIX8(2, row), t = MATRIX8(3, row);
+
+        world_c[row] = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a, cx), _mm256_mul_ps(b, cy)), _mm256_add_ps(_mm256_mul_ps(c, cz), t));
+        world_e[row] = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_andnot_ps(sign_mask, a), ex),
+                                                   _mm256_mul_ps(_mm256_andnot_ps(sign_mask, b), ey)),
+                                     _mm256_mul_ps(_mm256_andnot_ps(sign_mask, c), ez));
+    }
+
+    __m256 outside = _mm256_setzero_ps();
+    for (int i = 0; i < 6; ++i)
+    {
+        __m256 px = _mm256_set1_ps(planes[i].x), py = _mm256_set1_ps(planes[i].y), pz = _mm256_set1_ps(planes[i].z);
+
+        __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px, world_c[0]), _mm256_mul_ps(py, world_c[1])),
+                                 _mm256_add_ps(_mm256_mul_ps(pz, world_c[2]), _mm256_set1_ps(planes[i].w)));
+        __m256 r = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_andnot_ps(sign_mask, px), world_e[0]),
+                                               _mm256_mul_ps(_mm256_andnot_ps(sign_mask, py), world_e[1])),
+                                 _mm256_mul_ps(_mm256_andnot_ps(sign_mask, pz), world_e[2]));
+
+        outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(d, r), _mm256_setzero_ps(), _CMP_LT_OQ));
+    }
+
+    int outside_bits = _mm256_movemask_ps(outside);
+    for (int k = 0; k < 8; ++k)
+        visible[first + k] = !(outside_bits & (1 << k));
+
+#undef MATRIX8
+#undef BOX8
+}
+
+#endif // FRUSTUMCULLING_AVX
+
+#endif // FRUSTUMCULLING_SSE
+
+// Testa "count" objetos contra o frustum definido por "planes" (veja
+// FrustumCulling_ExtractPlanes()). Para cada objeto i, com matriz models[i] e
+// AABB [bbox_min[i], bbox_max[i]] em coordenadas de modelo, escreve em
+// visible[i] se o mesmo pode estar visível (1) ou está fora do frustum (0).
+// Retorna o número de objetos visíveis.
+size_t FrustumCulling_TestBoxes(const glm::vec4 planes[6], const glm::mat4 *models, const glm::vec3 *bbox_min, const glm::vec3 *bbox_max, size_t count, unsigned char *visible)
+{
+    size_t i = 0;
+
+#ifdef FRUSTUMCULLING_AVX
+    static const bool has_avx = __builtin_cpu_supports("avx");
+
+    if (has_avx)
+    {
+        for (; i + 8 <= count; i += 8)
+            FrustumCulling_TestBoxes8(planes, models, bbox_min, bbox_max, i, visible);
+    }
+#endif
+
+#ifdef FRUSTUMCULLING_SSE
+    for (; i + 4 <= count; i += 4)
+        FrustumCulling_TestBoxes4(planes, models, bbox_min, bbox_max, i, visible);
+#endif
+
+    for (; i < count; ++i)
+        visible[i] = FrustumCulling_TestBox(planes, models[i], bbox_min[i], bbox_max[i]);
+
+    size_t num_visible = 0;
+    for (size_t k = 0; k < count; ++k)
+        num_visible += visible[k];
+    return num_visible;
+}
@@ -0,0 +1,192 @@
+// Medição do tempo de GPU de cada passada de renderização. Cada passada
+// (passada de profundidade, cena, texto; veja GpuPass em "main.cpp") é
+// envolvida por um par glBeginQuery()/glEndQuery() do tipo GL_TIME_ELAPSED,
+// e a GPU mede o tempo gasto por ela nos comandos entre os dois.
+//
+// O resultado de uma consulta só fica pronto quando a GPU termina o quadro,
+// tipicamente um ou dois quadros depois de emitido. Por isso as consultas
+// ficam em GPUTIMER_FRAMES conjuntos usados em rodízio: ao terminar um
+// quadro, lemos o conjunto mais antigo, o qual será reutilizado no quadro
+// seguinte, somente se o resultado já estiver disponível
+// (GL_QUERY_RESULT_AVAILABLE). A CPU nunca espera pela GPU; um resultado
+// ainda não disponível é descartado e contado em GpuTimer_PrintStats().
+//
+// No modo de benchmark (veja GpuTimer_SetWaitForResults()) a CPU espera pelos
+// resultados, de modo que todo quadro tem os seus tempos; a espera limita a
+// CPU a GPUTIMER_FRAMES - 1 quadros à frente da GPU, como uma "swap chain".
+//
+// Consultas GL_TIME_ELAPSED não podem ser aninhadas: uma passada deve
+// terminar antes do início da seguinte, o que é verificado por
+// GpuTimer_Begin() e GpuTimer_End().
+#include <cassert>
+#include <cstdio>
+#include <vector>
+
+#include <glad/glad.h>
+
+#define GPUTIMER_FRAMES 3  // Conjuntos de consultas em rodízio
+#define GPUTIMER_WINDOW 60 // Número de resultados na média móvel de cada passada
+
+struct GpuTimerPass
+{
+    GLuint queries[GPUTIMER_FRAMES];
+    bool issued[GPUTIMER_FRAMES]; // Consulta emitida no quadro do conjunto, resultado ainda não lido
+
+    // Últimos GPUTIMER_WINDOW resultados, em milissegundos, e a sua soma.
+    double samples[GPUTIMER_WINDOW];
+    int num_samples;
+    int next_sample;
+    double window_sum;
+
+    bool active;          // A passada foi medida no último quadro lido
+    double last_ms;       // Resultado do último quadro lido
+    double total_ms;      // Tempo total desde GpuTimer_Init()
+    unsigned long frames; // Número de resultados em total_ms
+};
+
+static std::vector<GpuTimerPass> g_GpuTimerPasses;
+static int g_GpuTimerFrame = 0;              // Conjunto de consultas do quadro atual
+static unsigned long g_GpuTimerDropped = 0;  // Resultados descartados por não estarem prontos
+static bool g_GpuTimerWait = false;          // Esperar pelos resultados ao invés de descartá-los
+static int g_GpuTimerOpenPass = -1;          // Passada com a consulta em andamento, ou -1
+
+// Cria as consultas de "num_passes" passadas. Deve ser chamada após a criação
+// do contexto OpenGL.
+void GpuTimer_Init(int num_passes)
+{
+    g_GpuTimerPasses.assign(num_passes, GpuTimerPass());
+    for (int pass = 0; pass < num_passes; ++pass)
+    {
+        GpuTimerPass &timer = g_GpuTimerPasses[pass];
+        glGenQueries(GPUTIMER_FRAMES, timer.queries);
+        for (int frame = 0; frame < GPUTIMER_FRAMES; ++frame)
+            timer.issued[frame] = false;
+        timer.num_samples = 0;
+        timer.next_sample = 0;
+        timer.window_sum = 0.0;
+        timer.active = false;
+        timer.last_ms = 0.0;
+        timer.total_ms = 0.0;
+        timer.frames = 0;
+    }
+}
+
+void GpuTimer_Begin(int pass)
+{
+    assert(g_GpuTimerOpenPass == -1);
+    g_GpuTimerOpenPass = pass;
+
+    GpuTimerPass &timer = g_GpuTimerPasses[pass];
+    glBeginQuery(GL_TIME_ELAPSED, timer.queries[g_GpuTimerFrame]);
+    timer.issued[g_GpuTimerFrame] = true;
+}
+
+// Termina a medição de "pass", a qual deve ser a passada iniciada pela última
+// chamada a GpuTimer_Begin().
+void GpuTimer_End(int pass)
+{
+    assert(pass == g_GpuTimerOpenPass);
+    g_GpuTimerOpenPass = -1;
+
+    glEndQuery(GL_TIME_ELAPSED);
+}
+
+// Termina o quadro atual: passa para o próximo conjunto de consultas, lendo
+// antes os resultados que o mesmo guarda, de GPUTIMER_FRAMES - 1 quadros
+// atrás. Deve ser chamada uma vez por quadro, após o desenho de todas as
+// passadas.
+void GpuTimer_EndFrame()
+{
+    assert(g_GpuTimerOpenPass == -1);
+
+    g_GpuTimerFrame = (g_GpuTimerFrame + 1) % GPUTIMER_FRAMES;
+
+    for (size_t pass = 0; pass < g_GpuTimerPasses.size(); ++pass)
+    {
+        GpuTimerPass &timer = g_GpuTimerPasses[pass];
+        if (!timer.issued[g_GpuTimerFrame])
+        {
+            timer.active = false;
+            continue;
+        }
+        timer.issued[g_GpuTimerFrame] = false;
+
+        GLuint query = timer.queries[g_GpuTimerFrame];
+        GLint available = GL_TRUE;
+        if (!g_GpuTimerWait)
+            glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == GL_FALSE)
+        {
+            g_GpuTimerDropped += 1;
+            continue;
+        }
+
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+        double ms = nanoseconds / 1.0e6;
+
+        if (timer.num_samples == GPUTIMER_WINDOW)
+            timer.window_sum -= timer.samples[timer.next_sample];
+        else
+            timer.num_samples += 1;
+        timer.samples[timer.next_sample] = ms;
+        timer.next_sample = (timer.next_sample + 1) % GPUTIMER_WINDOW;
+        timer.window_sum += ms;
+
+        timer.active = true;
+        timer.last_ms = ms;
+        timer.total_ms += ms;
+        timer.frames += 1;
+    }
+}
+
+// Com "wait" verdadeiro, GpuTimer_EndFrame() espera pelos resultados ainda
+// não disponíveis, ao invés de descartá-los.
+void GpuTimer_SetWaitForResults(bool wait)
+{
+    g_GpuTimerWait = wait;
+}
+
+// Número de quadros entre a emissão das consultas de um quadro e a leitura
+// dos seus resultados por GpuTimer_EndFrame().
+int GpuTimer_Latency()
+{
+    return GPUTIMER_FRAMES - 1;
+}
+
+// Retorna true se a passada foi medida no último quadro com resultado lido.
+bool GpuTimer_IsActive(int pass)
+{
+    return g_GpuTimerPasses[pass].active;
+}
+
+// Tempo de GPU da passada no último quadro com resultado lido, em
+// milissegundos (veja GpuTimer_IsActive()).
+double GpuTimer_LastMs(int pass)
+{
+    return g_GpuTimerPasses[pass].last_ms;
+}
+
+// Média móvel do tempo de GPU da passada, em milissegundos, sobre os últimos
+// GPUTIMER_WINDOW resultados.
+double GpuTimer_AverageMs(int pass)
+{
+    const GpuTimerPass &timer = g_GpuTimerPasses[pass];
+    return timer.num_samples > 0 ? timer.window_sum / timer.num_samples : 0.0;
+}
+
+// Imprime no terminal o tempo médio de GPU de cada passada durante a
+// execução. "names" contém o nome de cada passada.
+void GpuTimer_PrintStats(const char *const *names)
+{
+    printf("Tempo de GPU por passada:\n");
+    for (size_t pass = 0; pass < g_GpuTimerPasses.size(); ++pass)
+    {
+        const GpuTimerPass &timer = g_GpuTimerPasses[pass];
+        if (timer.frames == 0)
+            continue;
+        printf("  %-10s %8.4f ms/quadro (%lu quadros)\n", names[pass], timer.total_ms / timer.frames, timer.frames);
+    }
+    if (g_GpuTimerDropped > 0)
+        printf("  %lu resultados descartados por não estarem prontos\n", g_GpuTimerDropped);
+}
@@ -0,0 +1,366 @@
+// Gravação e reprodução da entrada do usuário. Com a opção "--record
+// <arquivo>", os eventos de teclado e mouse recebidos pelos callbacks da GLFW
+// (KeyCallback(), MouseButtonCallback(), CursorPosCallback() e
+// ScrollCallback(), em "main.cpp") são gravados em um arquivo binário; com
+// "--replay <arquivo>", são entregues novamente aos mesmos callbacks, e a
+// sessão gravada é reproduzida exatamente (veja RunReplay() em "main.cpp").
+//
+// O instante de cada evento não é o tempo do relógio, mas o número de passos
+// fixos da simulação executados até ele (veja SimulationStep()). Como o
+// estado do jogo só é alterado pelos eventos e pelos passos, reproduzir os
+// eventos entre os mesmos passos leva aos mesmos estados, bit a bit,
+// independentemente da taxa de quadros da gravação e da reprodução.
+//
+// Formato do arquivo, com os inteiros e reais na ordem de bytes da máquina:
+//
+//   "INRC", versão (1 byte), largura e altura do framebuffer (int32)
+//   eventos: tipo (1 byte), passos desde o evento anterior (inteiro sem
+//            sinal de tamanho variável, 7 bits por byte), e os argumentos:
+//       tecla   key, scancode (int16), action, mods (1 byte cada)
+//       botão   button, action, mods (1 byte cada), posição do cursor (2 double)
+//       cursor  posição do cursor (2 double)
+//       rolagem deslocamentos (2 double)
+//       fim     soma de verificação do estado final da simulação (uint32)
+//
+// A posição do cursor é gravada com os botões porque MouseButtonCallback()
+// a consulta na GLFW, e não a recebe como argumento.
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <GLFW/glfw3.h>
+
+// Funções definidas em main.cpp
+void KeyCallback(GLFWwindow *window, int key, int scancode, int action, int mod);
+void MouseButtonCallback(GLFWwindow *window, int button, int action, int mods);
+void CursorPosCallback(GLFWwindow *window, double xpos, double ypos);
+void ScrollCallback(GLFWwindow *window, double xoffset, double yoffset);
+
+#define INPUT_RECORD_VERSION 1
+
+enum InputEventType
+{
+    INPUT_EVENT_KEY = 1,
+    INPUT_EVENT_MOUSE_BUTTON = 2,
+    INPUT_EVENT_CURSOR_POS = 3,
+    INPUT_EVENT_SCROLL = 4,
+    INPUT_EVENT_END = 5,
+};
+
+struct InputEvent
+{
+    unsigned char type;
+    unsigned long step;  // Passos da simulação executados antes do evento
+    int key_or_button;
+    int scancode;
+    int action;
+    int mods;
+    double x, y;         // Posição do cursor ou deslocamento da rolagem
+};
+
+// Gravação
+static FILE *g_InputRecordFile = NULL;
+static unsigned long g_InputRecordStep = 0; // Passo do último evento gravado
+static unsigned long g_InputRecordEvents = 0;
+
+// Reprodução
+static std::vector<InputEvent> g_InputReplayEvents;
+static size_t g_InputReplayNext = 0;
+static unsigned long g_InputReplayEndStep = 0;
+static unsigned int g_InputReplayChecksum = 0;
+static bool g_InputReplayHasChecksum = false;
+static int g_InputReplayWidth = 0;
+static int g_InputReplayHeight = 0;
+static double g_InputReplayCursorX = 0.0; // Posição gravada com o botão sendo entregue
+static double g_InputReplayCursorY = 0.0;
+
+static void InputRecord_WriteHeader(FILE *file, int width, int height)
+{
+    unsigned char version = INPUT_RECORD_VERSION;
+    fwrite("INRC", 1, 4, file);
+    fwrite(&version, 1, 1, file);
+    fwrite(&width, sizeof(int), 1, file);
+    fwrite(&height, sizeof(int), 1, file);
+}
+
+// Grava o tipo e o passo de um evento. O passo é gravado como a diferença
+// para o evento anterior, quase sempre zero ou pequena, em um único byte.
+static void InputRecord_BeginEvent(unsigned char type, unsigned long step)
+{
+    fputc(type, g_InputRecordFile);
+
+    unsigned long delta = step - g_InputRecordStep;
+    g_InputRecordStep = step;
+    do
+    {
+        unsigned char byte = delta & 0x7f;
+        delta >>= 7;
+        if (delta != 0)
+            byte |= 0x80;
+        fputc(byte, g_InputRecordFile);
+    } while (delta != 0);
+
+    g_InputRecordEvents += 1;
+}
+
+// Inicia a gravação no arquivo "filename". "width" e "height" são o tamanho
+// do framebuffer, utilizado pela reprodução. Retorna false se o arquivo não
+// pôde ser criado.
+bool InputRecord_Start(const char *filename, int width, int height)
+{
+    g_InputRecordFile = fopen(filename, "wb");
+    if (g_InputRecordFile == NULL)
+    {
+        fprintf(stderr, "ERROR: Cannot create input recording \"%s\".\n", filename);
+        return false;
+    }
+
+    InputRecord_WriteHeader(g_InputRecordFile, width, height);
+    g_InputRecordStep = 0;
+    g_InputRecordEvents = 0;
+    return true;
+}
+
+bool InputRecord_IsActive()
+{
+    return g_InputRecordFile != NULL;
+}
+
+void InputRecord_Key(unsigned long step, int key, int scancode, int action, int mods)
+{
+    if (g_InputRecordFile == NULL)
+        return;
+
+    short key16 = (short)key;
+    short scancode16 = (short)scancode;
+    InputRecord_BeginEvent(INPUT_EVENT_KEY, step);
+    fwrite(&key16, sizeof(short), 1, g_InputRecordFile);
+    fwrite(&scancode16, sizeof(short), 1, g_InputRecordFile);
+    fputc(action, g_InputRecordFile);
+    fputc(mods, g_InputRecordFile);
+}
+
+void InputRecord_MouseButton(unsigned long step, int button, int action, int mods, double xpos, double ypos)
+{
+    if (g_InputRecordFile == NULL)
+        return;
+
+    InputRecord_BeginEvent(INPUT_EVENT_MOUSE_BUTTON, step);
+    fputc(button, g_InputRecordFile);
+    fputc(action, g_InputRecordFile);
+    fputc(mods, g_InputRecordFile);
+    fwrite(&xpos, sizeof(double), 1, g_InputRecordFile);
+    fwrite(&ypos, sizeof(double), 1, g_InputRecordFile);
+}
+
+void InputRecord_CursorPos(unsigned long step, double xpos, double ypos)
+{
+    if (g_InputRecordFile == NULL)
+        return;
+
+    InputRecord_BeginEvent(INPUT_EVENT_CURSOR_POS, step);
+    fwrite(&xpos, sizeof(double), 1, g_InputRecordFile);
+    fwrite(&ypos, sizeof(double), 1, g_InputRecordFile);
+}
+
+void InputRecord_Scroll(unsigned long step, double xoffset, double yoffset)
+{
+    if (g_InputRecordFile == NULL)
+        return;
+
+    InputRecord_BeginEvent(INPUT_EVENT_SCROLL, step);
+    fwrite(&xoffset, sizeof(double), 1, g_InputRecordFile);
+    fwrite(&yoffset, sizeof(double), 1, g_InputRecordFile);
+}
+
+// Termina a gravação no passo "step", gravando a soma de verificação do
+// estado da simulação nesse passo (veja SimulationChecksum()).
+void InputRecord_Stop(unsigned long step, unsigned int checksum)
+{
+    if (g_InputRecordFile == NULL)
+        return;
+
+    InputRecord_BeginEvent(INPUT_EVENT_END, step);
+    fwrite(&checksum, sizeof(unsigned int), 1, g_InputRecordFile);
+
+    bool ok = ferror(g_InputRecordFile) == 0;
+    long size = ftell(g_InputRecordFile);
+    if (fclose(g_InputRecordFile) != 0)
+        ok = false;
+    g_InputRecordFile = NULL;
+
+    if (ok)
+        printf("Gravação da entrada: %lu eventos em %lu passos da simulação, %ld bytes\n", g_InputRecordEvents - 1, step, size);
+    else
+        fprintf(stderr, "ERROR: Cannot write input recording.\n");
+}
+
+// Lê os "count" bytes seguintes do arquivo carregado, avançando "offset".
+static bool InputReplay_Read(const std::vector<unsigned char> &data, size_t &offset, void *value, size_t count)
+{
+    if (offset + count > data.size())
+        return false;
+    memcpy(value, &data[offset], count);
+    offset += count;
+    return true;
+}
+
+// Carrega a gravação "filename" para reprodução. Retorna false, após
+// imprimir o motivo, se o arquivo não existe ou não é uma gravação válida.
+bool InputReplay_Load(const char *filename)
+{
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "ERROR: Cannot open input recording \"%s\".\n", filename);
+        return false;
+    }
+
+    std::vector<unsigned char> data;
+    unsigned char buffer[4096];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.insert(data.end(), buffer, buffer + count);
+    fclose(file);
+
+    size_t offset = 0;
+    char magic[4];
+    unsigned char version;
+    if (!InputReplay_Read(data, offset, magic, 4) || memcmp(magic, "INRC", 4) != 0 ||
+        !InputReplay_Read(data, offset, &version, 1) || version != INPUT_RECORD_VERSION ||
+        !InputReplay_Read(data, offset, &g_InputReplayWidth, sizeof(int)) ||
+        !InputReplay_Read(data, offset, &g_InputReplayHeight, sizeof(int)))
+    {
+        fprintf(stderr, "ERROR: \"%s\" is not an input recording.\n", filename);
+        return false;
+    }
+
+    g_InputReplayEvents.clear();
+    g_InputReplayNext = 0;
+    unsigned long step = 0;
+    bool ended = false;
+    while (!ended && offset < data.size())
+    {
+        InputEvent event = {};
+        event.type = data[offset++];
+
+        unsigned long delta = 0;
+        unsigned char byte = 0x80;
+        for (int shift = 0; (byte & 0x80) && offset < data.size(); shift += 7)
+        {
+            byte = data[offset++];
+            delta |= (unsigned long)(byte & 0x7f) << shift;
+        }
+        step += delta;
+        event.step = step;
+
+        bool ok = true;
+        unsigned char bytes[3];
+        short shorts[2];
+        switch (event.type)
+        {
+        case INPUT_EVENT_KEY:
+            ok = InputReplay_Read(data, offset, shorts, sizeof(shorts)) && InputReplay_Read(data, offset, bytes, 2);
+            event.key_or_button = shorts[0];
+            event.scancode = shorts[1];
+            event.action = bytes[0];
+            event.mods = bytes[1];
+            break;
+        case INPUT_EVENT_MOUSE_BUTTON:
+            ok = InputReplay_Read(data, offset, bytes, 3) &&
+                 InputReplay_Read(data, offset, &event.x, sizeof(double)) && InputReplay_Read(data, offset, &event.y, sizeof(double));
+            event.key_or_button = bytes[0];
+            event.action = bytes[1];
+            event.mods = bytes[2];
+            break;
+        case INPUT_EVENT_CURSOR_POS:
+        case INPUT_EVENT_SCROLL:
+            ok = InputReplay_Read(data, offset, &event.x, sizeof(double)) && InputReplay_Read(data, offset, &event.y, sizeof(double));
+            break;
+        case INPUT_EVENT_END:
+            ok = InputReplay_Read(data, offset, &g_InputReplayChecksum, sizeof(unsigned int));
+            g_InputReplayHasChecksum = ok;
+            g_InputReplayEndStep = step;
+            ended = true;
+            break;
+        default:
+            ok = false;
+        }
+
+        if (!ok)
+            break;
+        if (!ended)
+            g_InputReplayEvents.push_back(event);
+    }
+
+    // Uma gravação interrompida (o programa terminou sem InputRecord_Stop())
+    // não tem o evento de fim; reproduzimos até o seu último evento, sem a
+    // verificação do estado final.
+    if (!ended)
+    {
+        fprintf(stderr, "WARNING: Input recording \"%s\" is truncated; replaying up to its last event.\n", filename);
+        g_InputReplayEndStep = g_InputReplayEvents.empty() ? 0 : g_InputReplayEvents.back().step;
+        g_InputReplayHasChecksum = false;
+    }
+
+    printf("Reprodução da entrada: %d eventos em %lu passos da simulação, framebuffer %dx%d\n",
+           (int)g_InputReplayEvents.size(), g_InputReplayEndStep, g_InputReplayWidth, g_InputReplayHeight);
+    return true;
+}
+
+// Tamanho do framebuffer na gravação.
+void InputReplay_Size(int *width, int *height)
+{
+    *width = g_InputReplayWidth;
+    *height = g_InputReplayHeight;
+}
+
+// Número de passos da simulação da gravação.
+unsigned long InputReplay_EndStep()
+{
+    return g_InputReplayEndStep;
+}
+
+// Soma de verificação do estado final da gravação. Retorna false se a
+// gravação não a contém.
+bool InputReplay_Checksum(unsigned int *checksum)
+{
+    *checksum = g_InputReplayChecksum;
+    return g_InputReplayHasChecksum;
+}
+
+// Entrega aos callbacks de entrada, na ordem gravada, todos os eventos
+// recebidos após "step" passos da simulação. Deve ser chamada sem
+// g_SimulationMutex travado, pois os callbacks o travam.
+void InputReplay_DispatchEvents(GLFWwindow *window, unsigned long step)
+{
+    while (g_InputReplayNext < g_InputReplayEvents.size() && g_InputReplayEvents[g_InputReplayNext].step <= step)
+    {
+        const InputEvent &event = g_InputReplayEvents[g_InputReplayNext++];
+        switch (event.type)
+        {
+        case INPUT_EVENT_KEY:
+            KeyCallback(window, event.key_or_button, event.scancode, event.action, event.mods);
+            break;
+        case INPUT_EVENT_MOUSE_BUTTON:
+            g_InputReplayCursorX = event.x;
+            g_InputReplayCursorY = event.y;
+            MouseButtonCallback(window, event.key_or_button, event.action, event.mods);
+            break;
+        case INPUT_EVENT_CURSOR_POS:
+            CursorPosCallback(window, event.x, event.y);
+            break;
+        case INPUT_EVENT_SCROLL:
+            ScrollCallback(window, event.x, event.y);
+            break;
+        }
+    }
+}
+
+// Posição do cursor gravada com o evento de botão sendo entregue, no lugar
+// de glfwGetCursorPos().
+void InputReplay_CursorPos(double *xpos, double *ypos)
+{
+    *xpos = g_InputReplayCursorX;
+    *ypos = g_InputReplayCursorY;
+}
@@ -11,6 +11,7 @@
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <map>
 #include <stack>
 #include <string>
@@ -20,6 +21,11 @@
 #include <sstream>
 #include <stdexcept>
 #include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
 
 // Headers das bibliotecas OpenGL
 #include <glad/glad.h>  // Criação de contexto OpenGL 3.3
@@ -38,6 +44,7 @@
 // Headers locais, definidos na pasta "include/"
 #include "utils.h"
 #include "matrices.h"
+#include "profiler.h"
 
 #define M_PI 3.14159265358979323846
 int door1open = 0;
@@ -66,6 +73,7 @@ struct ObjModel
     // Veja: https://github.com/syoyo/tinyobjloader
     ObjModel(const char *filename, const char *basepath = NULL, bool triangulate = true)
     {
+        PROFILE_ZONE("LoadObj");
         printf("Carregando modelo \"%s\"... ", filename);
 
         std::string err;
@@ -81,22 +89,39 @@ struct ObjModel
     }
 };
 
+// Geradores de coordenadas de textura procedurais, escolhidos de acordo com
+// o material de cada modelo. Veja GenerateTextureCoordinates().
+enum UVGenerator
+{
+    UV_GENERATOR_NONE = 0,      // Coordenadas de textura do arquivo OBJ
+    UV_GENERATOR_SPHERICAL = 1, // Projeção esférica a partir do centro da AABB
+    UV_GENERATOR_PLANAR_XY = 2, // Projeção planar no plano XY, normalizada pela AABB
+    UV_GENERATOR_BOX = 3        // Projeção planar no plano mais alinhado a cada triângulo, normalizada pela AABB
+};
+
 // Declaração de funções utilizadas para pilha de matrizes de modelagem.
 void PushMatrix(glm::mat4 M);
 void PopMatrix(glm::mat4 &M);
 
 // Declaração de várias funções utilizadas em main().  Essas estão definidas
 // logo após a definição de main() neste arquivo.
-void BuildTrianglesAndAddToVirtualScene(ObjModel *);                         // Constrói representação de um ObjModel como malha de triângulos para renderização
+void BuildTrianglesAndAddToVirtualScene(ObjModel *, UVGenerator uv_generator = UV_GENERATOR_NONE); // Constrói representação de um ObjModel como malha de triângulos para renderização
+void GenerateTextureCoordinates(float *vertex_coefficients, size_t num_vertices, glm::vec3 bbox_min, glm::vec3 bbox_max, UVGenerator uv_generator);
 void ComputeNormals(ObjModel *model);                                        // Computa normais de um ObjModel, caso não existam.
 void LoadShadersFromFiles();                                                 // Carrega os shaders de vértice e fragmento, criando um programa de GPU
 void LoadTextureImage(const char *filename);                                 // Função que carrega imagens de textura
-void DrawVirtualObject(const char *object_name);                             // Desenha um objeto armazenado em g_VirtualScene
-GLuint LoadShader_Vertex(const char *filename);                              // Carrega um vertex shader
-GLuint LoadShader_Fragment(const char *filename);                            // Carrega um fragment shader
-void LoadShader(const char *filename, GLuint shader_id);                     // Função utilizada pelas duas acima
+GLuint LoadShader_Vertex(const char *filename, const char *defines = NULL);   // Carrega um vertex shader
+GLuint LoadShader_Fragment(const char *filename, const char *defines = NULL); // Carrega um fragment shader
+void LoadShader(const char *filename, GLuint shader_id, const char *defines); // Função utilizada pelas duas acima
+std::string LoadShaderSource(const char *filename, const char *defines);     // Lê o código de um shader de um arquivo GLSL
+void CompileShader(const std::string &source, GLuint shader_id, const char *filename); // Compila o código de um shader
+bool CheckShaderCompilation(GLuint shader_id, const char *filename);         // Imprime o log de compilação de um shader
 GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id); // Cria um programa de GPU
+bool CheckProgramLinking(GLuint program_id);                                 // Imprime o log de linkagem de um programa
+GLuint LoadGpuProgram(const char *vertex_filename, const char *vertex_defines, const char *fragment_filename, const char *fragment_defines); // Cria um programa de GPU de arquivos GLSL, utilizando o cache de programas
 void PrintObjModelInfo(ObjModel *);                                          // Função para debugging
+double GetTimeSeconds();                                                     // Tempo desde o início do programa, em segundos
+void *GetGLProcAddress(const char *name);                                    // Endereço de uma função OpenGL ausente do carregador GLAD
 
 // Declaração de funções auxiliares para renderizar texto dentro da janela
 // OpenGL. Estas funções estão definidas no arquivo "textrendering.cpp".
@@ -104,6 +129,10 @@ void TextRendering_Init();
 float TextRendering_LineHeight(GLFWwindow *window);
 float TextRendering_CharWidth(GLFWwindow *window);
 void TextRendering_PrintString(GLFWwindow *window, const std::string &str, float x, float y, float scale = 1.0f);
+void TextRendering_Flush();
+void TextRendering_SetWindowSize(int width, int height);
+int TextRendering_NewLayout();
+void TextRendering_PrintLayout(GLFWwindow *window, int layout, const std::string &str, float x, float y, float scale = 1.0f);
 void TextRendering_PrintMatrix(GLFWwindow *window, glm::mat4 M, float x, float y, float scale = 1.0f);
 void TextRendering_PrintVector(GLFWwindow *window, glm::vec4 v, float x, float y, float scale = 1.0f);
 void TextRendering_PrintMatrixVectorProduct(GLFWwindow *window, glm::mat4 M, glm::vec4 v, float x, float y, float scale = 1.0f);
@@ -111,17 +140,28 @@ void TextRendering_PrintMatrixVectorProductMoreDigits(GLFWwindow *window, glm::m
 void TextRendering_PrintMatrixVectorProductDivW(GLFWwindow *window, glm::mat4 M, glm::vec4 v, float x, float y, float scale = 1.0f);
 void PrintFinalMessage(GLFWwindow *window, std::string text, float scale);
 
+// Declaração das funções da arena global de malhas (um único VBO e IBO
+// compartilhados por todos os objetos). Definidas no arquivo "mesharena.cpp".
+void MeshArena_Init(size_t vertex_capacity, size_t index_capacity);
+size_t MeshArena_AllocVertices(size_t count);
+size_t MeshArena_AllocIndices(size_t count);
+void MeshArena_UploadVertices(size_t first_vertex, size_t count, const float *vertex_coefficients);
+void MeshArena_UploadIndices(size_t first_index, size_t count, const GLuint *indices);
+GLuint MeshArena_VertexArrayObject();
+void MeshArena_PrintStats();
+
 // Funções abaixo renderizam como texto na janela OpenGL algumas matrizes e
 // outras informações do programa. Definidas após main().
 void TextRendering_ShowModelViewProjection(GLFWwindow *window, glm::mat4 projection, glm::mat4 view, glm::mat4 model, glm::vec4 p_model);
 void TextRendering_ShowEulerAngles(GLFWwindow *window);
-void TextRendering_ShowProjection(GLFWwindow *window);
 void TextRendering_ShowFramesPerSecond(GLFWwindow *window);
 void TextRendering_ShowControls(GLFWwindow *window);
+void TextRendering_ShowGpuTimes(GLFWwindow *window);
 
 // Funções callback para comunicação com o sistema operacional e interação do
 // usuário. Veja mais comentários nas definições das mesmas, abaixo.
 void FramebufferSizeCallback(GLFWwindow *window, int width, int height);
+void WindowRefreshCallback(GLFWwindow *window);
 void ErrorCallback(int error, const char *description);
 void KeyCallback(GLFWwindow *window, int key, int scancode, int action, int mode);
 void MouseButtonCallback(GLFWwindow *window, int button, int action, int mods);
@@ -129,22 +169,383 @@ void CursorPosCallback(GLFWwindow *window, double xpos, double ypos);
 void ScrollCallback(GLFWwindow *window, double xoffset, double yoffset);
 
 bool collisionTest(glm::vec4 position);
-glm::mat4 bezierTipCurve();
+glm::mat4 bezierTipCurve(float t);
+bool HasOpenGLExtension(const char *name); // Verifica se o driver OpenGL suporta uma extensão
 
 // Definimos uma estrutura que armazenará dados necessários para renderizar
 // cada objeto da cena virtual.
 struct SceneObject
 {
     std::string name;              // Nome do objeto
-    size_t first_index;            // Índice do primeiro vértice dentro do vetor indices[] definido em BuildTrianglesAndAddToVirtualScene()
-    size_t num_indices;            // Número de índices do objeto dentro do vetor indices[] definido em BuildTrianglesAndAddToVirtualScene()
+    size_t first_index;            // Posição do primeiro índice do objeto dentro do IBO da arena de malhas (veja mesharena.cpp)
+    size_t num_indices;            // Número de índices do objeto dentro do IBO da arena de malhas
+    GLint base_vertex;             // Posição do primeiro vértice do modelo dentro do VBO da arena ("basevertex" de glDrawElementsBaseVertex())
     GLenum rendering_mode;         // Modo de rasterização (GL_TRIANGLES, GL_TRIANGLE_STRIP, etc.)
-    GLuint vertex_array_object_id; // ID do VAO onde estão armazenados os atributos do modelo
+    GLuint vertex_array_object_id; // ID do VAO onde estão armazenados os atributos do modelo (o VAO da arena, compartilhado)
     glm::vec3 bbox_min;            // Axis-Aligned Bounding Box do objeto
     glm::vec3 bbox_max;
+    std::vector<float> occluder_positions; // Posições (x,y,z) dos triângulos, só para malhas oclusoras (veja IsOccluderMesh())
+};
+
+// Modelo de iluminação de um material.
+enum MaterialLighting
+{
+    MATERIAL_LIGHTING_UNLIT = 0,      // Cor da textura, com um termo de Lambert desprezível
+    MATERIAL_LIGHTING_LAMBERT = 1,    // Termo difuso de Lambert
+    MATERIAL_LIGHTING_BLINN_PHONG = 2 // Termos difuso, ambiente e especular de Blinn-Phong
+};
+
+// Um programa de GPU de uma variante de "shader_fragment.glsl", com os
+// endereços das suas variáveis uniform (-1 para as que não existem na variante).
+struct VariantProgram
+{
+    GLuint program_id;
+    GLint model_uniform;       // Somente no desenho por objeto
+    GLint normal_matrix_uniform; // Somente no desenho por objeto
+    GLint view_uniform;
+    GLint projection_uniform;
+    GLint draw_offset_uniform; // Somente na submissão em lote
+    GLint camera_position_uniform;
+    GLint texture_uniforms[2]; // "texture0" e "texture1"
+    GLint kd_uniform;
+    GLint ks_uniform;
+    GLint ka_uniform;
+    GLint q_uniform;
+};
+
+// Uma permutação dos shaders: os programas compilados com um conjunto de
+// "#define" que seleciona somente o código de um tipo de material. Veja
+// GetShaderVariant().
+struct ShaderVariant
+{
+    std::string defines;      // Linhas "#define" inseridas no início dos shaders
+    VariantProgram program;   // Desenho por objeto
+    VariantProgram multidraw; // Submissão em lote ("#define MULTI_DRAW")
+};
+
+// Um programa de GPU criado de "shader_vertex.glsl" e "shader_fragment.glsl"
+// com um conjunto de "#define" em cada shader. Veja CollectShaderPrograms().
+struct ShaderProgramSource
+{
+    GLuint *program_id; // Variável que guarda o programa em uso
+    std::string vertex_defines;
+    std::string fragment_defines;
+};
+
+// Um programa sendo (re)compilado em segundo plano. Veja UpdateShaderReload().
+struct PendingShaderProgram
+{
+    GLuint *target;           // Programa em uso, substituído somente ao final da recarga
+    std::string vertex_source;
+    std::string fragment_source;
+    GLuint program_id;        // 0 enquanto a compilação não foi iniciada
+    GLuint vertex_shader_id;  // 0 se o programa foi carregado do cache de programas
+    GLuint fragment_shader_id;
+};
+
+// Material de um objeto da cena. Veja InitMaterials().
+struct Material
+{
+    MaterialLighting lighting;
+    bool point_light;        // Luz pontual no teto, ao invés da luz direcional
+    int num_textures;        // Número de texturas utilizadas (0, 1 ou 2)
+    GLint texture_units[2];  // Unidades de textura (na ordem das chamadas a LoadTextureImage())
+    UVGenerator uv_generator; // Coordenadas de textura das malhas que usam o material (veja BindMaterial())
+    glm::vec3 Kd;            // Refletância difusa (quando não há textura)
+    glm::vec3 Ks;            // Refletância especular
+    glm::vec3 Ka;            // Refletância ambiente
+    float q;                 // Expoente especular
+    ShaderVariant *variant;  // Programas especializados para este material
+};
+
+// Programa e material ativos durante o desenho da lista de desenho, para
+// evitar trocas de programa e envios de variáveis uniform redundantes.
+struct MaterialBinding
+{
+    const VariantProgram *program;
+    const Material *material;
+};
+
+// Um pedido de desenho de um objeto da cena virtual no quadro atual. Veja
+// AddToDrawList() e SubmitDrawList().
+struct DrawCommand
+{
+    const char *object_name;   // Nome do objeto em g_VirtualScene
+    const SceneObject *object; // O próprio objeto, evitando buscas no dicionário
+    glm::mat4 model;           // Matriz de modelagem do objeto
+    glm::mat4 normal_matrix;   // Transposta da inversa de "model" (veja ComputeDerivedUniforms())
+    int object_id;             // Identificador do objeto (veja InitMaterials())
+    const Material *material;  // Material do objeto
+    int cell;                  // Sala onde o objeto está (veja InitPortalCells())
+};
+
+// Backends de submissão da lista de desenho. Veja SubmitDrawList().
+enum DrawBackend
+{
+    DRAW_BACKEND_PER_OBJECT = 0, // Uma chamada de desenho por objeto, com variáveis uniform por objeto
+    DRAW_BACKEND_MULTI_DRAW = 1  // Uma chamada glMultiDrawElementsBaseVertex() por lote
+};
+
+// Passadas de desenho da lista de desenho. Com a passada de profundidade
+// ligada (g_DepthPrepass), a lista é desenhada duas vezes: primeiro somente no
+// Z-buffer, e depois com cor e glDepthFunc(GL_EQUAL). Veja SubmitDrawList().
+enum DrawPass
+{
+    DRAW_PASS_DEPTH = 0, // Somente profundidade, com programa mínimo e sem escrita de cor
+    DRAW_PASS_COLOR = 1  // Passada principal
+};
+
+// Tempo gasto por quadro em uma etapa, ou no quadro inteiro (entre chamadas a
+// glfwSwapBuffers()). Veja AccumulateFrameTime().
+struct FrameTimeStats
+{
+    double total_seconds;  // Tempo total acumulado
+    int total_frames;      // Número de quadros em total_seconds
+    double window_seconds; // Tempo acumulado para a média móvel
+    int window_frames;     // Número de quadros em window_seconds
+    double average_ms;     // Média móvel do tempo por quadro, em milissegundos
+};
+
+// Estatísticas de submissão da lista de desenho de um backend.
+struct DrawStats
+{
+    int draw_calls;        // Chamadas de desenho no último quadro
+    size_t triangles;      // Triângulos submetidos no último quadro
+    FrameTimeStats cpu;    // Tempo de CPU gasto em SubmitDrawList()
+};
+
+// Declaração das funções de submissão da lista de desenho. Definidas após main().
+void AddToDrawList(const char *object_name, glm::mat4 model, int object_id, int cell); // Adiciona um objeto à lista de desenho do quadro
+void SubmitDrawList_PerObject(glm::mat4 view, glm::mat4 projection, DrawPass pass, DrawStats &stats);
+void SubmitDrawList_MultiDraw(glm::mat4 view, glm::mat4 projection, DrawPass pass, DrawStats &stats);
+void InitMultiDraw();                                                        // Cria os recursos da submissão em lote
+void PrintDrawBackendBenchmark();                                            // Imprime o tempo de CPU de submissão de cada backend
+void EndLoadPhase(const char *name, double &phase_start_seconds);           // Registra o tempo de uma etapa da carga
+void PrintLoadPhases();                                                      // Imprime o tempo de cada etapa da carga
+double UpdateFrameTimeStats();                                               // Acumula o tempo do quadro que acabou de ser exibido
+void AccumulateFrameTime(FrameTimeStats &stats, double seconds);             // Acumula um tempo nas estatísticas e atualiza a média móvel
+void RequestRedraw();                                                        // Marca a cena como alterada, para que seja redesenhada
+bool SceneNeedsRedraw();                                                     // Verifica se o quadro exibido ainda está correto
+void WaitForRedraw();                                                        // Bloqueia até o próximo evento, sem redesenhar
+bool ConsumeRedrawRequest();                                                 // Verifica e descarta um pedido de redesenho
+
+// Declaração das funções de materiais e permutações de shaders. Definidas após main().
+void InitMaterials();                                                        // Define o material de cada objeto e compila as variantes utilizadas
+ShaderVariant *GetShaderVariant(const Material &material);                   // Retorna a variante de um material, compilando-a se necessário
+void LoadShaderVariant(ShaderVariant &variant);                              // (Re)compila os programas de uma variante
+void CollectShaderPrograms(std::vector<ShaderProgramSource> &programs);      // Lista os programas criados dos arquivos de shaders
+void LookupShaderUniforms();                                                 // Busca os endereços das variáveis uniform de todos os programas
+void LookupVariantUniforms(VariantProgram &program);                         // Busca os endereços das variáveis uniform de uma variante
+const VariantProgram *BindMaterial(const Material *material, bool multi_draw, const glm::mat4 &view, const glm::mat4 &projection, MaterialBinding &binding);
+
+// Declaração das funções de recarga dos shaders em segundo plano. Definidas após main().
+void InitShaderReload();   // Inicia a observação dos arquivos GLSL
+void BeginShaderReload();  // Inicia a recompilação de todos os programas
+void UpdateShaderReload(); // Avança a recompilação, chamada uma vez por quadro
+void CancelShaderReload(); // Descarta uma recompilação em andamento
+
+// Declaração das funções de observação de arquivos. Definidas no arquivo "shaderwatcher.cpp".
+bool ShaderWatcher_Start(const char *directory, const char *extension);
+bool ShaderWatcher_PollChanges(std::vector<std::string> &changed);
+void ShaderWatcher_Stop();
+
+// Estado das consultas de oclusão de um objeto. Veja SubmitOcclusionList().
+struct OcclusionState
+{
+    GLuint queries[2];  // Consultas GL_ANY_SAMPLES_PASSED dos quadros pares e ímpares
+    bool pending[2];    // Consulta emitida e resultado ainda não lido
+    bool occluded;      // Último resultado lido: caixa do objeto oculta
+    int visible_frames; // Número de resultados seguidos com o objeto visível
+};
+
+// Estatísticas das consultas de oclusão.
+struct OcclusionStats
+{
+    int queries;                  // Consultas emitidas no último quadro
+    int skipped;                  // Objetos desenhados sem consulta (visíveis há muito tempo)
+    int occluded;                 // Objetos não desenhados por estarem ocultos
+    unsigned long total_results;  // Resultados lidos desde o início
+    unsigned long total_occluded; // Resultados com o objeto oculto
+};
+
+// Declaração das funções de oclusão por software. Definidas no arquivo "softwareocclusion.cpp".
+void SoftwareOcclusion_Init();
+void SoftwareOcclusion_Shutdown();
+void SoftwareOcclusion_BeginFrame(const glm::mat4 &clip);
+void SoftwareOcclusion_AddOccluder(const glm::mat4 &model, const float *positions, size_t num_vertices);
+void SoftwareOcclusion_Rasterize();
+size_t SoftwareOcclusion_NumTriangles();
+bool SoftwareOcclusion_TestBox(const glm::mat4 &model, glm::vec3 bbox_min, glm::vec3 bbox_max);
+void SoftwareOcclusion_ReadDebugImage(std::vector<unsigned char> &pixels);
+void SoftwareOcclusion_DrawDebug(const unsigned char *pixels, float x0, float y0, float x1, float y1);
+bool IsOccluderMesh(const std::string &name); // Malhas rasterizadas no Z-buffer de oclusão por software
+
+// Declaração das funções de oclusão por hardware. Definidas após main().
+void InitOcclusionQueries();                                                 // Cria a caixa utilizada nas consultas
+bool IsOcclusionCandidate(const DrawCommand &command);                       // Objetos testados com consultas de oclusão
+void SubmitOcclusionList(glm::mat4 view, glm::mat4 projection, DrawStats &stats);
+void PrintOcclusionStats();                                                  // Imprime a taxa de acerto das consultas
+
+// Estatísticas do frustum culling da lista de desenho. Veja CullDrawList().
+struct CullingStats
+{
+    int visible;       // Objetos da lista de desenho possivelmente visíveis no último quadro
+    int culled;        // Objetos descartados no último quadro
+    int visible_cells; // Salas visíveis através dos portais no último quadro
+    int num_cells;     // Número total de salas
+    int occluded;      // Objetos ocultos pela oclusão por software no último quadro
+    int occluder_triangles;     // Triângulos rasterizados pela oclusão por software no último quadro
+    double average_ms;          // Média móvel do tempo de CPU do culling, em milissegundos
+    double software_average_ms; // Média móvel do tempo de CPU da oclusão por software, em milissegundos
+};
+
+// Opções do culling de um quadro, copiadas das variáveis alternadas pelo
+// teclado (g_FrustumCulling, g_PortalCulling, ...) com g_SimulationMutex
+// travado. Veja BuildFramePacket().
+struct CullingOptions
+{
+    bool frustum;
+    bool portals;
+    bool software_occlusion;
+    bool show_occlusion_buffer;
+};
+
+// Declaração das funções de frustum culling. Definidas no arquivo "frustumculling.cpp".
+void FrustumCulling_ExtractPlanes(const glm::mat4 &clip, glm::vec4 planes[6]);
+size_t FrustumCulling_TestBoxes(const glm::vec4 planes[6], const glm::mat4 *models, const glm::vec3 *bbox_min, const glm::vec3 *bbox_max, size_t count, unsigned char *visible);
+void CullDrawList(glm::mat4 view, glm::mat4 projection, glm::vec4 camera_position, const CullingOptions &options); // Remove da lista de desenho os objetos que não podem estar visíveis
+void ComputeDerivedUniforms();                           // Calcula as variáveis uniform derivadas de cada objeto da lista de desenho
+
+// Declaração das funções de visibilidade por portais. Definidas no arquivo "portalculling.cpp".
+int PortalCulling_AddCell(glm::vec3 bbox_min, glm::vec3 bbox_max);
+int PortalCulling_AddPortal(int cell_a, int cell_b, const glm::vec3 *vertices, int num_vertices);
+void PortalCulling_SetPortalOpen(int portal, bool open);
+int PortalCulling_NumCells();
+int PortalCulling_FindCell(glm::vec3 point);
+int PortalCulling_ComputeVisibleCells(glm::vec3 camera_position, const glm::mat4 &clip, unsigned char *visible_cells, glm::vec4 *cell_planes);
+void InitPortalCells(); // Define as salas e portas do nível
+
+// Passadas de renderização com o tempo de GPU medido. Veja "gputimer.cpp".
+enum GpuPass
+{
+    GPU_PASS_PREPASS = 0, // Passada de profundidade (veja SubmitDrawList())
+    GPU_PASS_SCENE = 1,   // Passada principal da cena, incluindo as consultas de oclusão
+    GPU_PASS_TEXT = 2,    // Texto da interface (veja TextRendering_Flush())
+    GPU_PASS_COUNT = 3
+};
+const char *const GPU_PASS_NAMES[GPU_PASS_COUNT] = {"prepass", "scene", "text"};
+
+// Declaração das funções de medição do tempo de GPU. Definidas no arquivo "gputimer.cpp".
+void GpuTimer_Init(int num_passes);
+void GpuTimer_Begin(int pass);
+void GpuTimer_End(int pass);
+void GpuTimer_EndFrame();
+void GpuTimer_SetWaitForResults(bool wait);
+int GpuTimer_Latency();
+bool GpuTimer_IsActive(int pass);
+double GpuTimer_LastMs(int pass);
+double GpuTimer_AverageMs(int pass);
+void GpuTimer_PrintStats(const char *const *names);
+
+// Declaração das funções de estatísticas do tempo por quadro. Definidas no arquivo "framestats.cpp".
+void FrameStats_Init(double budget_ms);
+void FrameStats_AddFrame(double seconds);
+double FrameStats_BudgetMs();
+int FrameStats_Window(double *p50, double *p95, double *p99, double *max_ms, int *over_budget);
+void FrameStats_DrawGraph(float x0, float y0, float x1, float y1);
+void FrameStats_PrintSummary();
+
+// Declaração das funções do contexto OpenGL sem janela. Definidas no arquivo "offscreen.cpp".
+bool Offscreen_Init(int width, int height);
+void *Offscreen_GetProcAddress(const char *name);
+void Offscreen_Shutdown();
+void Offscreen_ReadPixels(int width, int height, std::vector<unsigned char> &pixels);
+bool Offscreen_WritePPM(const char *filename, int width, int height, const std::vector<unsigned char> &pixels);
+
+// Declaração das funções do modo de benchmark. Definidas no arquivo "benchmark.cpp".
+bool Benchmark_LoadScript(const char *filename);
+int Benchmark_Frames();
+int Benchmark_Width();
+int Benchmark_Height();
+int Benchmark_NumStateChanges();
+const char *Benchmark_StateChange(int index, int *frame, int *value);
+void Benchmark_Camera(int frame, glm::vec4 &position, glm::vec4 &look_at);
+void Benchmark_RecordLoadPhase(const char *name, double seconds);
+void Benchmark_RecordFrame(int frame, double frame_seconds, double cpu_seconds, int draw_calls, size_t triangles, int objects);
+void Benchmark_RecordGpuTimes(int frame, const double *pass_ms, int num_passes);
+bool Benchmark_WriteResults(const char *prefix, const char *const *pass_names, int num_passes);
+
+// Declaração das funções do teste de regressão. Definidas no arquivo "regression.cpp".
+bool Regression_LoadScript(const char *filename);
+int Regression_Width();
+int Regression_Height();
+int Regression_Frames();
+int Regression_Runs();
+int Regression_NumStateChanges();
+const char *Regression_StateChange(int index, int *value);
+int Regression_NumPoses();
+const char *Regression_Pose(int index, glm::vec4 &position, glm::vec4 &look_at);
+void Regression_Begin(bool &update);
+bool Regression_CheckPose(int index, const std::vector<unsigned char> &pixels, double frame_ms, int draw_calls, size_t triangles, bool update);
+bool Regression_End(bool update);
+
+// Declaração das funções de gravação e reprodução da entrada. Definidas no arquivo "inputrecord.cpp".
+bool InputRecord_Start(const char *filename, int width, int height);
+bool InputRecord_IsActive();
+void InputRecord_Key(unsigned long step, int key, int scancode, int action, int mods);
+void InputRecord_MouseButton(unsigned long step, int button, int action, int mods, double xpos, double ypos);
+void InputRecord_CursorPos(unsigned long step, double xpos, double ypos);
+void InputRecord_Scroll(unsigned long step, double xoffset, double yoffset);
+void InputRecord_Stop(unsigned long step, unsigned int checksum);
+bool InputReplay_Load(const char *filename);
+void InputReplay_Size(int *width, int *height);
+unsigned long InputReplay_EndStep();
+bool InputReplay_Checksum(unsigned int *checksum);
+void InputReplay_DispatchEvents(GLFWwindow *window, unsigned long step);
+void InputReplay_CursorPos(double *xpos, double *ypos);
+
+// Declaração das funções do cache de programas de GPU. Definidas no arquivo "programcache.cpp".
+void ProgramCache_Init(const char *directory);
+void ProgramCache_PrepareLink(GLuint program_id);
+GLuint ProgramCache_Load(const std::string &vertex_source, const std::string &fragment_source);
+void ProgramCache_Store(const std::string &vertex_source, const std::string &fragment_source, GLuint program_id);
+void ProgramCache_PrintStats();
+
+// Pacote de um quadro: tudo o que a renderização precisa para desenhar um
+// quadro, produzido pela simulação (veja ProduceFramePacket()). Um pacote
+// publicado não é mais alterado; a thread de renderização apenas o lê.
+struct FramePacket
+{
+    glm::mat4 view;                          // Matriz da câmera
+    glm::mat4 projection;                    // Matriz de projeção
+    glm::vec4 camera_position;               // Posição da câmera em coordenadas globais
+    std::vector<DrawCommand> draw_list;      // Objetos que sobreviveram ao culling, com as variáveis uniform derivadas
+    bool end_game;                           // O jogador chegou ao troféu
+    CullingOptions culling;                  // Opções do culling deste quadro
+    std::string projection_text;             // Textos da interface gerados pela simulação
+    std::string culling_text;
+    std::string software_occlusion_text;
+    std::vector<unsigned char> occlusion_image; // Z-buffer da oclusão por software (vazio se não exibido)
 };
 
-float p_seconds = (float)glfwGetTime();
+// Declaração das funções da separação entre simulação e renderização. Definidas após main().
+bool ProduceFramePacket(FramePacket &packet);                                // Avança a simulação e produz o pacote do próximo quadro
+void PublishFramePacket();                                                   // Publica o pacote escrito pela simulação
+const FramePacket *AcquireFramePacket();                                     // Retorna o pacote publicado mais recente, se ainda não lido
+void StartSimulationThread();                                                // Passa a simulação para uma thread própria
+void StopSimulationThread();                                                 // Termina a thread de simulação
+void SubmitDrawList(const FramePacket &packet);                              // Desenha todos os objetos da lista de desenho do pacote
+void RunMainLoop(GLFWwindow *window);                                        // Laço principal, até o usuário fechar a janela
+void RenderFrame(GLFWwindow *window, const FramePacket &packet);             // Desenha o quadro de um pacote, com a interface
+bool RunBenchmark(const char *output_prefix);                                // Executa o roteiro de benchmark carregado
+bool RunReplay(GLFWwindow *window);                                          // Reproduz a gravação da entrada carregada
+void DumpFrame(int frame);                                                   // Grava a imagem do quadro, se pedido ("--dump-frames")
+bool RunRegression(bool update);                                             // Executa o teste de regressão carregado
+bool SetBenchmarkVariable(const char *name, int value, bool check_only);     // Força uma variável do jogo pelo nome
+void TextRendering_ShowProjection(GLFWwindow *window, const FramePacket &packet);
+void TextRendering_ShowDrawStats(GLFWwindow *window, const FramePacket &packet);
+
+float p_seconds = (float)GetTimeSeconds();
 float seconds;
 float ellapsed_s;
 
@@ -204,26 +605,169 @@ bool g_KeyPressedS = false;
 bool g_KeyPressedA = false;
 bool g_KeyPressedD = false;
 
+// Escalonamento dos quadros: a cena só é redesenhada quando algo muda. Veja
+// SceneNeedsRedraw(). Um pedido de redesenho (RequestRedraw()) vale por
+// REDRAW_SETTLE_FRAMES quadros, pois as consultas de oclusão (veja
+// SubmitOcclusionList()) só revelam um objeto que deixou de estar oculto com
+// um quadro de atraso.
+const int REDRAW_SETTLE_FRAMES = 3;
+int g_RedrawFrames = REDRAW_SETTLE_FRAMES;
+bool g_AnimatedObjectVisible = false; // Algum objeto animado sobreviveu ao culling no último quadro
+double g_FrameStartSeconds = 0.0;     // Início do quadro atual (veja UpdateFrameTimeStats())
+
+// Tempo máximo de espera por eventos com a cena parada; recargas de shaders
+// em andamento são verificadas com maior frequência (veja UpdateShaderReload()).
+const double IDLE_WAIT_SECONDS = 0.5;
+const double SHADER_RELOAD_POLL_SECONDS = 1.0 / 60.0;
+
 // Variável que controla o tipo de projeção utilizada: perspectiva ou ortográfica.
 bool g_UsePerspectiveProjection = true;
 
 // Variável que controla se o texto informativo será mostrado na tela.
 bool g_ShowInfoText = true;
 
+// Gravação do trace do profiler de CPU (veja "profiler.h"): com a tecla G,
+// das zonas dos últimos PROFILER_DUMP_SECONDS segundos em "trace.json"; com a
+// opção "--trace <arquivo>", de todas as zonas ainda nos buffers ao terminar.
+const double PROFILER_DUMP_SECONDS = 10.0;
+bool g_ProfilerDumpRequested = false;
+const char *g_TraceFilename = NULL;
+
+// Contexto OpenGL sem janela (veja "offscreen.cpp"), utilizado no modo de
+// benchmark (opção "--benchmark <roteiro>"; veja RunBenchmark()).
+bool g_Offscreen = false;
+
+// Reprodução de uma gravação da entrada (opção "--replay <arquivo>"; veja
+// "inputrecord.cpp" e RunReplay()). Os eventos vêm da gravação, e não da
+// GLFW.
+bool g_InputReplay = false;
+
+// Gravação das imagens desenhadas no benchmark e na reprodução (opções
+// "--dump-frames <prefixo>" e "--dump-interval <n>"), uma a cada
+// g_DumpFramesInterval quadros, em "<prefixo>_<quadro>.ppm". A leitura do
+// framebuffer espera a GPU terminar o quadro: os tempos dos quadros gravados
+// não são representativos.
+const char *g_DumpFramesPrefix = NULL;
+int g_DumpFramesInterval = 1;
+
+// Tamanho do framebuffer, em pixels. Veja FramebufferSizeCallback().
+int g_FramebufferWidth = 800;
+int g_FramebufferHeight = 600;
+
+// Tempo de cada etapa da carga (veja EndLoadPhase()).
+struct LoadPhase
+{
+    const char *name;
+    double seconds;
+};
+std::vector<LoadPhase> g_LoadPhases;
+
 // Variáveis que definem um programa de GPU (shaders). Veja função LoadShadersFromFiles().
-GLuint vertex_shader_id;
-GLuint fragment_shader_id;
 GLuint program_id = 0;
 GLint model_uniform;
 GLint view_uniform;
 GLint projection_uniform;
-GLint object_id_uniform;
-GLint bbox_min_uniform;
-GLint bbox_max_uniform;
 
 // Número de texturas carregadas pela função LoadTextureImage()
 GLuint g_NumLoadedTextures = 0;
 
+// Amostradores das texturas: g_ClampSampler limita as coordenadas de textura
+// às bordas da imagem, e g_RepeatSampler repete a imagem na direção S, para
+// que a costura das coordenadas esféricas possa ultrapassar U = 1 (veja
+// GenerateTextureCoordinates()). Cada material escolhe um deles em
+// BindMaterial().
+GLuint g_ClampSampler = 0;
+GLuint g_RepeatSampler = 0;
+
+// Lista de objetos do quadro sendo montado pela simulação (veja
+// BuildFramePacket()), e a cópia da lista do pacote sendo desenhado, a qual
+// a submissão reordena e divide (veja SubmitDrawList()).
+std::vector<DrawCommand> g_DrawList;
+std::vector<DrawCommand> g_SubmitList;
+
+// Posição da câmera em coordenadas globais no quadro sendo desenhado (a
+// origem do sistema de coordenadas da câmera, transformada pela inversa de
+// "view"). Calculada uma vez por quadro em BuildFramePacket().
+glm::vec4 g_DrawCameraPosition;
+
+// Backend de submissão da lista de desenho, alternado com a tecla M.
+DrawBackend g_DrawBackend = DRAW_BACKEND_PER_OBJECT;
+DrawStats g_DrawStats[2];
+
+// Materiais da cena e, para cada "object_id", o índice do seu material em
+// g_Materials (-1 se o objeto não possui material). Veja InitMaterials().
+std::vector<Material> g_Materials;
+std::vector<int> g_ObjectMaterials;
+
+// Variantes dos shaders já compiladas, indexadas pelo hash do seu conjunto de
+// "#define". Veja GetShaderVariant().
+std::map<unsigned long long, ShaderVariant> g_ShaderVariants;
+
+// Recursos da submissão em lote. Veja SubmitDrawList_MultiDraw().
+GLuint g_DrawDataBuffer;
+GLuint g_DrawDataTexture;
+bool g_HasShaderDrawParameters = false;
+const int DRAW_DATA_TEXELS = 8;          // Texels RGBA por objeto no "texture buffer" (veja shader_vertex.glsl)
+const GLuint DRAW_DATA_TEXTURE_UNIT = 30; // Unidade de textura do "texture buffer"
+
+// Passada de profundidade, alternada com a tecla E. Os programas de GPU da
+// passada são os mesmos shaders compilados com "#define DEPTH_ONLY". O tempo
+// por quadro é acumulado separadamente com e sem a passada, para comparação.
+bool g_DepthPrepass = false;
+FrameTimeStats g_FrameTimeStats[2];
+
+// Tempo de CPU da thread de renderização por quadro, do início do quadro até
+// glfwSwapBuffers(), para comparação com o tempo de GPU (veja "gputimer.cpp").
+FrameTimeStats g_RenderCpuStats;
+GLuint program_depth_id = 0;
+GLint depth_model_uniform;
+GLint depth_view_uniform;
+GLint depth_projection_uniform;
+GLuint program_multidraw_depth_id = 0;
+GLint multidraw_depth_view_uniform;
+GLint multidraw_depth_projection_uniform;
+GLint multidraw_depth_draw_offset_uniform;
+
+// Constantes e funções de KHR_parallel_shader_compile, ausentes do carregador
+// GLAD deste projeto. Com esta extensão, glCompileShader() e glLinkProgram()
+// retornam imediatamente e a compilação prossegue em threads do driver.
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+typedef void (APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+
+// Programas sendo recompilados em segundo plano. Veja UpdateShaderReload().
+std::vector<PendingShaderProgram> g_PendingShaderPrograms;
+bool g_HasParallelShaderCompile = false;
+
+// Frustum culling da lista de desenho, alternado com a tecla C, e culling
+// por portais, alternado com a tecla V.
+bool g_FrustumCulling = true;
+bool g_PortalCulling = true;
+CullingStats g_CullingStats;
+
+// Salas (células) do nível, na ordem em que são criadas em InitPortalCells(),
+// e os portais correspondentes às duas portas.
+#define ROOM1 0
+#define ROOM2 1
+#define ROOM3 2
+int g_Door1Portal;
+int g_Door2Portal;
+
+// Oclusão por software, alternada com a tecla K, e visualização do seu
+// Z-buffer, alternada com a tecla B. Veja "softwareocclusion.cpp".
+bool g_SoftwareOcclusion = false;
+bool g_ShowOcclusionBuffer = false;
+
+// Consultas de oclusão por hardware dos objetos pesados, alternadas com a
+// tecla Q. Veja SubmitOcclusionList().
+bool g_OcclusionQueries = true;
+std::vector<DrawCommand> g_OcclusionList;
+std::map<std::pair<const SceneObject *, int>, OcclusionState> g_OcclusionStates;
+OcclusionStats g_OcclusionStats;
+unsigned int g_OcclusionFrame = 0;
+const size_t OCCLUSION_MIN_TRIANGLES = 10000; // Objetos com menos triângulos são sempre desenhados
+const int OCCLUSION_TRUSTED_FRAMES = 30;      // Objetos visíveis por mais quadros deixam de ser testados a cada quadro
+const float OCCLUSION_CAMERA_MARGIN = 0.2f;   // Distância mínima da câmera à caixa para emitir a consulta
+
 bool isDoor1Open()
 {
     return !lever1act && lever2act && !lever3act && lever4act && lever5act && !lever6act && !lever7act;
@@ -234,64 +778,263 @@ bool isDoor2Open()
     return woodenChairRotation % 4 == 1 && woodenZ1Rotation % 10 == 5 && woodenZ2Rotation % 10 == 0 && woodenZ3Rotation % 10 == 5;
 }
 
+// As portas, uma vez abertas, não fecham mais. Chamada sempre que as
+// alavancas ou as peças mudam (veja KeyCallback()), junto com a mudança: o
+// estado das portas depende somente dos eventos de entrada, e não de quando
+// os quadros são montados.
+void UpdateDoorState()
+{
+    if (isDoor1Open())
+        door1open = true;
+    if (isDoor2Open())
+        door2open = true;
+}
+
 float bezierAux = 0.0f;
 int bezierAux2 = 0;
 
+// Simulação em passo fixo: a câmera, o teste de colisão e as animações avançam
+// em passos de SIMULATION_STEP_SECONDS, independentemente da taxa de quadros.
+// O estado atual da simulação são as variáveis globais (g_camX, bezierAux,
+// g_GlobeAngle, ...); o estado do passo anterior é guardado em
+// g_SimulationPrevious, e cada quadro desenha a interpolação entre os dois.
+// Veja UpdateSimulation().
+struct SimulationState
+{
+    glm::vec4 camera_position; // Posição da câmera livre (g_camX, g_camY, g_camZ)
+    float bezier_t;            // Parâmetro da curva da esfera de dica (bezierAux)
+    float globe_angle;         // Rotação do globo (g_GlobeAngle)
+};
+
+const double SIMULATION_STEP_SECONDS = 1.0 / 120.0;
+
+// Tempo máximo simulado por quadro. Após uma pausa longa (por exemplo, a
+// carga dos shaders), a simulação não tenta recuperar todo o tempo perdido.
+const double SIMULATION_MAX_FRAME_SECONDS = 0.25;
+
+float g_GlobeAngle = 0.0f;
+SimulationState g_SimulationPrevious;
+double g_SimulationAccumulator = 0.0;
+
+// Passos executados desde o início do programa. É o relógio dos eventos
+// gravados e reproduzidos (veja "inputrecord.cpp").
+unsigned long g_SimulationStepCount = 0;
+
+void SimulationStep(float dt);                             // Avança a simulação em um passo fixo
+SimulationState CurrentSimulationState();                  // Estado atual da simulação
+unsigned int SimulationChecksum();                         // Soma de verificação do estado do jogo
+SimulationState UpdateSimulation(double frame_seconds);    // Avança a simulação e retorna o estado interpolado a desenhar
+void BuildFramePacket(FramePacket &packet, const SimulationState &state); // Monta a cena de um quadro no estado dado
+void FinishFramePacket(FramePacket &packet);                               // Culling e textos da interface do pacote montado
+
+// Separação entre simulação e renderização. Com g_UseSimulationThread (tecla
+// T), a simulação, a lógica do jogo, a montagem e o culling da lista de
+// desenho rodam em uma thread própria, em passos de SIMULATION_STEP_SECONDS,
+// enquanto a thread principal (a única com o contexto OpenGL e a que recebe
+// os eventos da GLFW) somente desenha; sem ela, os pacotes são produzidos
+// pela thread principal no início de cada quadro. Veja ProduceFramePacket().
+//
+// As variáveis do jogo alteradas pelos callbacks de entrada e lidas pela
+// simulação são protegidas por g_SimulationMutex: os callbacks o travam
+// durante todo o tratamento do evento, e a simulação somente durante os
+// passos e a montagem da cena (veja BuildFramePacket()). O culling e os
+// textos da interface (veja FinishFramePacket()) utilizam apenas o pacote e
+// dados da simulação, e são feitos com o mutex livre, para não bloquear os
+// callbacks da thread principal.
+bool g_UseSimulationThread = true;
+std::thread g_SimulationThread;
+std::atomic<bool> g_SimulationThreadRunning(false);
+std::mutex g_SimulationMutex;
+std::condition_variable g_SimulationWake; // Sinalizada por RequestRedraw(), acorda a simulação parada
+bool g_SimulationIdle = false;            // A cena estava parada no último pacote pedido (veja ProduceFramePacket())
+
+// "Triple buffer" de pacotes entre a simulação e a renderização. A cada
+// instante um pacote pertence à simulação (sendo escrito), um à renderização
+// (sendo desenhado), e o terceiro é o último pacote publicado. Publicar e
+// adquirir um pacote é uma única troca atômica do índice do pacote publicado,
+// sem travas: nenhuma das threads espera pela outra. O bit
+// FRAME_PACKET_FRESH indica que o pacote publicado ainda não foi adquirido.
+FramePacket g_FramePackets[3];
+std::atomic<int> g_FramePacketShared(1);
+int g_FramePacketWrite = 0; // Usado somente por quem produz os pacotes
+int g_FramePacketRead = 2;  // Usado somente pela renderização
+const int FRAME_PACKET_FRESH = 4;
+
+// Quadros que a renderização ainda redesenha com o último pacote adquirido.
+// As consultas de oclusão só revelam um objeto que deixou de estar oculto no
+// quadro seguinte (veja REDRAW_SETTLE_FRAMES), e com a simulação em outra
+// thread pacotes podem ser descartados sem nunca serem desenhados.
+int g_RenderSettleFrames = 0;
+
 int main(int argc, char *argv[])
 {
-    // Inicializamos a biblioteca GLFW, utilizada para criar uma janela do
-    // sistema operacional, onde poderemos renderizar com OpenGL.
-    int success = glfwInit();
-    if (!success)
+    Profiler_SetThreadName("main");
+
+    // Opções da linha de comando. Um argumento que não é uma opção é o nome
+    // de um modelo OBJ adicional, carregado junto com a cena.
+    const char *extra_model_filename = NULL;
+    const char *benchmark_script = NULL;
+    const char *benchmark_output = NULL;
+    const char *record_filename = NULL;
+    const char *replay_filename = NULL;
+    const char *regression_script = NULL;
+    bool update_golden = false;
+    bool headless = false;
+    int size_width = 0, size_height = 0;
+    for (int i = 1; i < argc; ++i)
     {
-        fprintf(stderr, "ERROR: glfwInit() failed.\n");
-        std::exit(EXIT_FAILURE);
+        if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+            g_TraceFilename = argv[++i];
+        else if (strcmp(argv[i], "--benchmark") == 0 && i + 1 < argc)
+            benchmark_script = argv[++i];
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+            benchmark_output = argv[++i];
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+            record_filename = argv[++i];
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+            replay_filename = argv[++i];
+        else if (strcmp(argv[i], "--regression") == 0 && i + 1 < argc)
+            regression_script = argv[++i];
+        else if (strcmp(argv[i], "--update-golden") == 0)
+            update_golden = true;
+        else if (strcmp(argv[i], "--headless") == 0)
+            headless = true;
+        else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+        {
+            if (sscanf(argv[++i], "%dx%d", &size_width, &size_height) != 2 || size_width <= 0 || size_height <= 0)
+            {
+                fprintf(stderr, "ERROR: Invalid size \"%s\" (expected <width>x<height>).\n", argv[i]);
+                std::exit(EXIT_FAILURE);
+            }
+        }
+        else if (strcmp(argv[i], "--dump-frames") == 0 && i + 1 < argc)
+            g_DumpFramesPrefix = argv[++i];
+        else if (strcmp(argv[i], "--dump-interval") == 0 && i + 1 < argc)
+            g_DumpFramesInterval = std::max(atoi(argv[++i]), 1);
+        else
+            extra_model_filename = argv[i];
     }
 
-    // Definimos o callback para impressão de erros da GLFW no terminal
-    glfwSetErrorCallback(ErrorCallback);
+    // Sem janela não há entrada do usuário: somente o benchmark, o teste de
+    // regressão e a reprodução de uma gravação rodam sem janela.
+    if (regression_script != NULL)
+        headless = true;
+    if (headless && replay_filename == NULL && benchmark_script == NULL && regression_script == NULL)
+    {
+        fprintf(stderr, "ERROR: --headless requires --replay <file>.\n");
+        std::exit(EXIT_FAILURE);
+    }
 
-    // Pedimos para utilizar OpenGL versão 3.3 (ou superior)
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    double load_phase_seconds = GetTimeSeconds();
 
-    // Pedimos para utilizar o perfil "core", isto é, utilizaremos somente as
-    // funções modernas de OpenGL.
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    // Tamanho da imagem: o do roteiro de benchmark ou de regressão, o do
+    // framebuffer da gravação reproduzida, ou o pedido pela opção "--size".
+    int window_width = 800, window_height = 600;
+    if (regression_script != NULL)
+    {
+        if (!Regression_LoadScript(regression_script))
+            std::exit(EXIT_FAILURE);
+        window_width = Regression_Width();
+        window_height = Regression_Height();
+    }
+    else if (benchmark_script != NULL)
+    {
+        if (!Benchmark_LoadScript(benchmark_script))
+            std::exit(EXIT_FAILURE);
+        window_width = Benchmark_Width();
+        window_height = Benchmark_Height();
+    }
+    else if (replay_filename != NULL)
+    {
+        if (!InputReplay_Load(replay_filename))
+            std::exit(EXIT_FAILURE);
+        g_InputReplay = true;
+        InputReplay_Size(&window_width, &window_height);
+    }
+    if (size_width > 0)
+    {
+        window_width = size_width;
+        window_height = size_height;
+    }
 
-    // Criamos uma janela do sistema operacional, com 800 colunas e 600 linhas
-    // de pixels, e com título "INF01047 ...".
-    GLFWwindow *window;
-    window = glfwCreateWindow(800, 600, "INF01047 - Trabalho Final 2020/2 - Carlos Santiago & Gabriel Martins", NULL, NULL);
-    if (!window)
+    // O modo de benchmark (veja RunBenchmark()), o teste de regressão e a
+    // opção "--headless" desenham em um contexto sem janela (veja "offscreen.cpp"), e rodam
+    // também em máquinas sem display. A GLFW não é utilizada.
+    GLFWwindow *window = NULL;
+    if (benchmark_script != NULL || headless)
     {
-        glfwTerminate();
-        fprintf(stderr, "ERROR: glfwCreateWindow() failed.\n");
-        std::exit(EXIT_FAILURE);
+        g_Offscreen = true;
+        if (!Offscreen_Init(window_width, window_height))
+            std::exit(EXIT_FAILURE);
+
+        FramebufferSizeCallback(NULL, window_width, window_height);
     }
+    else
+    {
+        // Inicializamos a biblioteca GLFW, utilizada para criar uma janela do
+        // sistema operacional, onde poderemos renderizar com OpenGL.
+        int success = glfwInit();
+        if (!success)
+        {
+            fprintf(stderr, "ERROR: glfwInit() failed.\n");
+            std::exit(EXIT_FAILURE);
+        }
+
+        // Definimos o callback para impressão de erros da GLFW no terminal
+        glfwSetErrorCallback(ErrorCallback);
+
+        // Pedimos para utilizar OpenGL versão 3.3 (ou superior)
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 
-    // Definimos a função de callback que será chamada sempre que o usuário
-    // pressionar alguma tecla do teclado ...
-    glfwSetKeyCallback(window, KeyCallback);
-    // ... ou clicar os botões do mouse ...
-    glfwSetMouseButtonCallback(window, MouseButtonCallback);
-    // ... ou movimentar o cursor do mouse em cima da janela ...
-    glfwSetCursorPosCallback(window, CursorPosCallback);
-    // ... ou rolar a "rodinha" do mouse.
-    glfwSetScrollCallback(window, ScrollCallback);
+        // Pedimos para utilizar o perfil "core", isto é, utilizaremos somente as
+        // funções modernas de OpenGL.
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-    // Indicamos que as chamadas OpenGL deverão renderizar nesta janela
-    glfwMakeContextCurrent(window);
+        // Criamos uma janela do sistema operacional, com 800 colunas e 600 linhas
+        // de pixels, e com título "INF01047 ...".
+        window = glfwCreateWindow(window_width, window_height, "INF01047 - Trabalho Final 2020/2 - Carlos Santiago & Gabriel Martins", NULL, NULL);
+        if (!window)
+        {
+            glfwTerminate();
+            fprintf(stderr, "ERROR: glfwCreateWindow() failed.\n");
+            std::exit(EXIT_FAILURE);
+        }
+
+        // Definimos a função de callback que será chamada sempre que o usuário
+        // pressionar alguma tecla do teclado ...
+        // Na reprodução, os eventos vêm somente da gravação: a entrada do
+        // usuário é ignorada (a janela ainda pode ser fechada).
+        if (!g_InputReplay)
+        {
+            glfwSetKeyCallback(window, KeyCallback);
+            // ... ou clicar os botões do mouse ...
+            glfwSetMouseButtonCallback(window, MouseButtonCallback);
+            // ... ou movimentar o cursor do mouse em cima da janela ...
+            glfwSetCursorPosCallback(window, CursorPosCallback);
+            // ... ou rolar a "rodinha" do mouse.
+            glfwSetScrollCallback(window, ScrollCallback);
+        }
+
+        // Indicamos que as chamadas OpenGL deverão renderizar nesta janela
+        glfwMakeContextCurrent(window);
+
+        // Carregamento de todas funções definidas por OpenGL 3.3, utilizando a
+        // biblioteca GLAD.
+        gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+
+        // Definimos a função de callback que será chamada sempre que a janela for
+        // redimensionada, por consequência alterando o tamanho do "framebuffer"
+        // (região de memória onde são armazenados os pixels da imagem).
+        glfwSetFramebufferSizeCallback(window, FramebufferSizeCallback);
+        FramebufferSizeCallback(window, window_width, window_height); // Forçamos a chamada do callback acima, para definir g_ScreenRatio.
 
-    // Carregamento de todas funções definidas por OpenGL 3.3, utilizando a
-    // biblioteca GLAD.
-    gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+        // Callback chamado quando o conteúdo da janela precisa ser redesenhado
+        // (por exemplo, quando a janela deixa de estar coberta por outra).
+        glfwSetWindowRefreshCallback(window, WindowRefreshCallback);
 
-    // Definimos a função de callback que será chamada sempre que a janela for
-    // redimensionada, por consequência alterando o tamanho do "framebuffer"
-    // (região de memória onde são armazenados os pixels da imagem).
-    glfwSetFramebufferSizeCallback(window, FramebufferSizeCallback);
-    FramebufferSizeCallback(window, 800, 600); // Forçamos a chamada do callback acima, para definir g_ScreenRatio.
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    }
 
     // Imprimimos no terminal informações sobre a GPU do sistema
     const GLubyte *vendor = glGetString(GL_VENDOR);
@@ -301,13 +1044,19 @@ int main(int argc, char *argv[])
 
     printf("GPU: %s, %s, OpenGL %s, GLSL %s\n", vendor, renderer, glversion, glslversion);
 
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    EndLoadPhase("context", load_phase_seconds);
+
+    // Programas de GPU já linkados em execuções anteriores são carregados do
+    // diretório "shadercache", ao lado do executável, sem recompilação.
+    ProgramCache_Init("shadercache");
 
     // Carregamos os shaders de vértices e de fragmentos que serão utilizados
     // para renderização. Veja slides 176-196 do documento Aula_03_Rendering_Pipeline_Grafico.pdf.
     //
     LoadShadersFromFiles();
 
+    EndLoadPhase("shaders", load_phase_seconds);
+
     // Carregamos duas imagens para serem utilizadas como textura
     LoadTextureImage("../../data/tc-earth_daymap_surface.jpg");      // TextureImage0
     LoadTextureImage("../../data/tc-earth_nightmap_citylights.gif"); // TextureImage1
@@ -319,10 +1068,19 @@ int main(int argc, char *argv[])
     LoadTextureImage("../../data/goldTexture.jpg");                  //GoldTexture
     LoadTextureImage("../../data/silverTexture.jpg");                //SilverTexture
 
-    // Construímos a representação de objetos geométricos através de malhas de triângulos
+    EndLoadPhase("textures", load_phase_seconds);
+
+    // Criamos a arena de malhas onde serão armazenados os vértices e índices
+    // de todos os modelos abaixo. Os buffers crescem caso necessário.
+    MeshArena_Init(1 << 19, 1 << 19);
+
+    // Construímos a representação de objetos geométricos através de malhas de triângulos.
+    // Modelos cujo material utiliza coordenadas de textura procedurais têm
+    // estas geradas na carga, substituindo as do arquivo. O gerador de cada
+    // modelo é o "uv_generator" do seu material (veja InitMaterials()).
     ObjModel spheremodel("../../data/sphere.obj");
     ComputeNormals(&spheremodel);
-    BuildTrianglesAndAddToVirtualScene(&spheremodel);
+    BuildTrianglesAndAddToVirtualScene(&spheremodel, UV_GENERATOR_SPHERICAL);
 
     ObjModel planemodel("../../data/plane.obj");
     ComputeNormals(&planemodel);
@@ -334,29 +1092,29 @@ int main(int argc, char *argv[])
 
     ObjModel spiderModel("../../data/spider.obj");
     ComputeNormals(&spiderModel);
-    BuildTrianglesAndAddToVirtualScene(&spiderModel);
+    BuildTrianglesAndAddToVirtualScene(&spiderModel, UV_GENERATOR_PLANAR_XY);
 
-    ObjModel doorModel("../../data/door.obj");
+    ObjModel doorModel("../../data/Door.obj");
     ComputeNormals(&doorModel);
-    BuildTrianglesAndAddToVirtualScene(&doorModel);
+    BuildTrianglesAndAddToVirtualScene(&doorModel, UV_GENERATOR_PLANAR_XY);
 
     ObjModel leverModel("../../data/lever.obj");
     ComputeNormals(&leverModel);
-    BuildTrianglesAndAddToVirtualScene(&leverModel);
+    BuildTrianglesAndAddToVirtualScene(&leverModel, UV_GENERATOR_PLANAR_XY);
 
     ObjModel woodChair("../../data/woodChair.obj");
     ComputeNormals(&woodChair);
-    BuildTrianglesAndAddToVirtualScene(&woodChair);
+    BuildTrianglesAndAddToVirtualScene(&woodChair, UV_GENERATOR_BOX);
 
     ObjModel woodTable("../../data/woodTable.obj");
     ComputeNormals(&woodTable);
-    BuildTrianglesAndAddToVirtualScene(&woodTable);
+    BuildTrianglesAndAddToVirtualScene(&woodTable, UV_GENERATOR_BOX);
 
     ObjModel woodZ("../../data/woodZ.obj");
     ComputeNormals(&woodZ);
-    BuildTrianglesAndAddToVirtualScene(&woodZ);
+    BuildTrianglesAndAddToVirtualScene(&woodZ, UV_GENERATOR_BOX);
 
-    ObjModel oscar("../../data/oscar.obj");
+    ObjModel oscar("../../data/Oscar.obj");
     ComputeNormals(&oscar);
     BuildTrianglesAndAddToVirtualScene(&oscar);
 
@@ -364,24 +1122,44 @@ int main(int argc, char *argv[])
     ComputeNormals(&trophy);
     BuildTrianglesAndAddToVirtualScene(&trophy);
 
-    if (argc > 1)
+    if (extra_model_filename != NULL)
     {
-        ObjModel model(argv[1]);
-        BuildTrianglesAndAddToVirtualScene(&model);
+        ObjModel model(extra_model_filename);
+        BuildTrianglesAndAddToVirtualScene(&model, UV_GENERATOR_PLANAR_XY);
     }
 
+    MeshArena_PrintStats();
+
+    EndLoadPhase("models", load_phase_seconds);
+
+    InitMaterials();
+    InitShaderReload();
+    InitMultiDraw();
+    InitPortalCells();
+    InitOcclusionQueries();
+    SoftwareOcclusion_Init();
+
     glm::mat4 m = Matrix_Identity();
 
     // Inicializamos o código para renderização de texto.
     TextRendering_Init();
 
-    // Buscamos o endereço das variáveis definidas dentro do Vertex Shader.
-    // Utilizaremos estas variáveis para enviar dados para a placa de vídeo
-    // (GPU)! Veja arquivo "shader_vertex.glsl".
-    GLint model_uniform = glGetUniformLocation(program_id, "model");                     // Variável da matriz "model"
-    GLint view_uniform = glGetUniformLocation(program_id, "view");                       // Variável da matriz "view" em shader_vertex.glsl
-    GLint projection_uniform = glGetUniformLocation(program_id, "projection");           // Variável da matriz "projection" em shader_vertex.glsl
-    GLint render_as_black_uniform = glGetUniformLocation(program_id, "render_as_black"); // Variável booleana em shader_vertex.glsl
+    // Criamos as consultas que medem o tempo de GPU de cada passada.
+    GpuTimer_Init(GPU_PASS_COUNT);
+
+    // O orçamento de tempo por quadro é o intervalo de atualização do monitor.
+    const GLFWvidmode *video_mode = window != NULL ? glfwGetVideoMode(glfwGetPrimaryMonitor()) : NULL;
+    int refresh_rate = (video_mode != NULL && video_mode->refreshRate > 0) ? video_mode->refreshRate : 60;
+    FrameStats_Init(1000.0 / refresh_rate);
+
+    ProgramCache_PrintStats();
+
+    EndLoadPhase("scene", load_phase_seconds);
+    PrintLoadPhases();
+
+    // Os endereços das variáveis uniform dos shaders (model_uniform,
+    // view_uniform, etc.) são buscados em LoadShadersFromFiles(), e atualizados
+    // sempre que os shaders são recarregados.
 
     // Habilitamos o Z-buffer. Veja slides 104-116 do documento Aula_09_Projecoes.pdf.
     glEnable(GL_DEPTH_TEST);
@@ -397,629 +1175,2115 @@ int main(int argc, char *argv[])
     glm::mat4 the_model;
     glm::mat4 the_view;
 
-    // Ficamos em loop, renderizando, até que o usuário feche a janela
-    while (!glfwWindowShouldClose(window))
+    // Ficamos em loop, renderizando, até que o usuário feche a janela ou, no
+    // modo de benchmark, no teste de regressão e na reprodução, até o fim do
+    // roteiro ou da gravação.
+    int exit_status = EXIT_SUCCESS;
+    if (regression_script != NULL)
     {
-        // Aqui executamos as operações de renderização
-
-        // Definimos a cor do "fundo" do framebuffer como branco.  Tal cor é
-        // definida como coeficientes RGBA: Red, Green, Blue, Alpha; isto é:
-        // Vermelho, Verde, Azul, Alpha (valor de transparência).
-        // Conversaremos sobre sistemas de cores nas aulas de Modelos de Iluminação.
-        //
-        //           R     G     B     A
-        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-
-        // "Pintamos" todos os pixels do framebuffer com a cor definida acima,
-        // e também resetamos todos os pixels do Z-buffer (depth buffer).
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        // Pedimos para a GPU utilizar o programa de GPU criado acima (contendo
-        // os shaders de vértice e fragmentos).
-        glUseProgram(program_id);
-
-        glm::vec4 cameraPosition_c;
-        glm::vec4 cameraLookAt_l;
-        glm::vec4 cameraViewVector;
-        glm::vec4 cameraUpVector;
-        glm::vec4 cameraPosition_c_x;
-        glm::vec4 cameraLookAt_l_x;
-        glm::vec4 cameraUpVector_x;
-
-        float r = 2.0f;
-        float y = r * sin(g_CameraPhi);
-        float z = r * cos(g_CameraPhi) * cos(g_CameraTheta);
-        float x = r * cos(g_CameraPhi) * sin(g_CameraTheta);
-        float step_size = 2.0f;
-        float g_camX_temp = g_camX; //Distancia X da camera
-        float g_camY_temp = g_camY; // Distancia Y da camera
-        float g_camZ_temp = g_camZ; //Distancia Z da camera
-        glm::vec4 new_pos = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
-        seconds = (float)glfwGetTime();
-        ellapsed_s = seconds - p_seconds;
-
-        if (g_lookAt)
-        {
-            cameraPosition_c_x = glm::vec4(2.0, 3.0, 0.0, 1.0f); // camera da parede apontada fixamente.
-            cameraLookAt_l_x = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
-            cameraUpVector_x = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f); // vetor "up" sendo colocado fixamente sempre olhando para o "céu" (eixo y global).
-        }
-        else
+        if (!RunRegression(update_golden))
+            exit_status = EXIT_FAILURE;
+    }
+    else if (benchmark_script != NULL)
+    {
+        if (!RunBenchmark(benchmark_output))
+            exit_status = EXIT_FAILURE;
+    }
+    else if (g_InputReplay)
+    {
+        if (!RunReplay(window))
+            exit_status = EXIT_FAILURE;
+    }
+    else
+    {
+        // A gravação começa com a cena carregada, antes do primeiro passo
+        // da simulação.
+        if (record_filename != NULL)
         {
-            if (g_KeyPressedS)
-            {
-                g_camX_temp -= ellapsed_s * step_size * sin(g_CameraTheta);
-                g_camZ_temp -= ellapsed_s * step_size * cos(g_CameraTheta);
-            }
-            else if (g_KeyPressedD)
-            {
-                g_camX_temp -= ellapsed_s * step_size * cos(g_CameraPhi) * cos(g_CameraTheta);
-                g_camZ_temp += ellapsed_s * step_size * cos(g_CameraPhi) * sin(g_CameraTheta);
-            }
-            else if (g_KeyPressedW)
-            {
-                g_camX_temp += ellapsed_s * step_size * cos(g_CameraPhi) * sin(g_CameraTheta);
-                g_camZ_temp += ellapsed_s * step_size * cos(g_CameraPhi) * cos(g_CameraTheta);
-            }
-            else if (g_KeyPressedA)
-            {
-                g_camX_temp += ellapsed_s * step_size * cos(g_CameraPhi) * cos(g_CameraTheta);
-                g_camZ_temp -= ellapsed_s * step_size * cos(g_CameraPhi) * sin(g_CameraTheta);
-            }
+            int width, height;
+            glfwGetFramebufferSize(window, &width, &height);
+            if (!InputRecord_Start(record_filename, width, height))
+                std::exit(EXIT_FAILURE);
+        }
 
-            new_pos = glm::vec4(g_camX_temp, g_camY_temp, g_camZ_temp, 1.0f);
-            if (!collisionTest(new_pos))
-            {
-                g_camX = g_camX_temp;
-                g_camY = g_camY_temp;
-                g_camZ = g_camZ_temp;
-            }
+        RunMainLoop(window);
+    }
 
-            cameraPosition_c_x = glm::vec4(g_camX, g_camY, g_camZ, 1.0f);
-            cameraLookAt_l_x = cameraLookAt_l_g;
-            cameraUpVector_x = cameraUpVector_g;
-        }
+    StopSimulationThread();
+
+    // A gravação termina com o estado final da simulação, para a verificação
+    // da reprodução.
+    if (InputRecord_IsActive())
+        InputRecord_Stop(g_SimulationStepCount, SimulationChecksum());
+
+    if (g_TraceFilename != NULL)
+        Profiler_WriteChromeTrace(g_TraceFilename, 0.0);
 
-        // Abaixo definimos as varáveis que efetivamente definem a câmera virtual.
-        // Veja slides 195-227 e 229-234 do documento Aula_08_Sistemas_de_Coordenadas.pdf.
-        cameraPosition_c = cameraPosition_c_x; // Ponto "c", centro da câmera
-        cameraPosition_c_g = cameraPosition_c_x;
-        cameraLookAt_l = cameraLookAt_l_x;                    // Ponto "l", para onde a câmera (look-at) estará sempre olhando
-        cameraViewVector = cameraLookAt_l - cameraPosition_c; // Vetor "view", sentido para onde a câmera está virada
-        cameraUpVector = cameraUpVector_x;                    // Vetor "up" fixado para apontar para o "céu" (eito Y global)
+    PrintDrawBackendBenchmark();
+    FrameStats_PrintSummary();
+    GpuTimer_PrintStats(GPU_PASS_NAMES);
+    PrintOcclusionStats();
 
-        // Computamos a matriz "View" utilizando os parâmetros da câmera para
-        // definir o sistema de coordenadas da câmera.  Veja slides 2-14, 184-190 e 236-242 do documento Aula_08_Sistemas_de_Coordenadas.pdf.
-        glm::mat4 view = Matrix_Camera_View(cameraPosition_c, cameraViewVector, cameraUpVector);
+    SoftwareOcclusion_Shutdown();
+    ShaderWatcher_Stop();
+    CancelShaderReload();
 
-        // Agora computamos a matriz de Projeção.
-        glm::mat4 projection;
+    // Finalizamos o uso dos recursos do sistema operacional
+    if (g_Offscreen)
+        Offscreen_Shutdown();
+    else
+        glfwTerminate();
 
-        p_seconds = seconds;
+    // Fim do programa
+    return exit_status;
+}
 
-        // Note que, no sistema de coordenadas da câmera, os planos near e far
-        // estão no sentido negativo! Veja slides 176-204 do documento Aula_09_Projecoes.pdf.
-        float nearplane = -0.1f;     // Posição do "near plane"
-        float farplane = -10000.0f; // Posição do "far plane"
+// Laço principal do jogo: produz (ou recebe da thread de simulação) e desenha
+// os quadros, e trata os eventos da janela, até que o usuário a feche.
+void RunMainLoop(GLFWwindow *window)
+{
+    g_FrameStartSeconds = GetTimeSeconds();
+    while (!glfwWindowShouldClose(window))
+    {
+        double cpu_start_seconds = GetTimeSeconds();
 
-        if (g_UsePerspectiveProjection)
+        if (g_ProfilerDumpRequested)
         {
-            // Projeção Perspectiva.
-            // Para definição do field of view (FOV), veja slides 205-215 do documento Aula_09_Projecoes.pdf.
-            float field_of_view = M_PI / 2.0f;
-            projection = Matrix_Perspective(field_of_view, g_ScreenRatio, nearplane, farplane);
+            Profiler_WriteChromeTrace("trace.json", PROFILER_DUMP_SECONDS);
+            g_ProfilerDumpRequested = false;
         }
+
+        // Liga ou desliga a thread de simulação (tecla T).
+        if (g_UseSimulationThread)
+            StartSimulationThread();
         else
+            StopSimulationThread();
+
+        // Sem a thread de simulação, produzimos aqui o pacote deste quadro.
+        if (!g_SimulationThreadRunning)
         {
-            // Projeção Ortográfica.
-            // Para definição dos valores l, r, b, t ("left", "right", "bottom", "top"),
-            // PARA PROJEÇÃO ORTOGRÁFICA veja slides 219-224 do documento Aula_09_Projecoes.pdf.
-            // Para simular um "zoom" ortográfico, computamos o valor de "t"
-            // utilizando a variável g_CameraDistance.
-            float t = 1.5f * g_CameraDistance / 2.5f;
-            float b = -t;
-            float r = t * g_ScreenRatio;
-            float l = -r;
-            projection = Matrix_Orthographic(l, r, b, t, nearplane, farplane);
+            bool produced;
+            {
+                std::lock_guard<std::mutex> lock(g_SimulationMutex);
+                produced = ProduceFramePacket(g_FramePackets[g_FramePacketWrite]);
+            }
+            if (produced)
+            {
+                FinishFramePacket(g_FramePackets[g_FramePacketWrite]);
+                PublishFramePacket();
+            }
         }
 
-        glm::mat4 model = Matrix_Identity(); // Transformação identidade de modelagem
-
-        // Enviamos as matrizes "view" e "projection" para a placa de vídeo
-        // (GPU). Veja o arquivo "shader_vertex.glsl", onde estas são
-        // efetivamente aplicadas em todos os pontos.
-        glUniformMatrix4fv(view_uniform, 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(projection_uniform, 1, GL_FALSE, glm::value_ptr(projection));
-
-#define SPHERE 0
-#define BUNNY 1
-#define WALL 2
-#define FLOOR 6
-#define FLOOR2 11
-#define FLOOR3 16
-#define DOOR1 17
-#define DOOR2 18
-#define MAP 19
-#define LEVER1 20
-#define LEVER2 21
-#define LEVER3 22
-#define LEVER4 23
-#define LEVER5 24
-#define LEVER6 25
-#define LEVER7 26
-#define WOODTABLE 27
-#define WOODCHAIR 28
-#define WOODZ1 29
-#define WOODZ2 30
-#define WOODZ3 31
-#define TIPBOARD1 32
-#define TIPBOARD2 33
-#define OSCAR 34
-#define SPIDER1 35
-#define SPIDER2 36
-#define TROPHY 37
-#define ROOF1 38
-#define ROOF2 39
-#define ROOF3 40
-#define TIPSPHERE 41
-
-        if (isDoor1Open())
-        {
-            door1open = true;
-        }
-        if (isDoor2Open())
-        {
-            door2open = true;
-        }
-        // Desenhamos o modelo da esfera
-        model = Matrix_Translate(0.0f, 0.9f, -2.0f) * Matrix_Rotate_Z(0.6f) * Matrix_Rotate_X(0.2f) * Matrix_Rotate_Y(g_AngleY + (float)glfwGetTime() * 0.1f) * Matrix_Scale(0.3f, 0.3f, 0.3f);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, SPHERE);
-        DrawVirtualObject("sphere");
-
-        // Desenhamos a sphera com dica
-        model = bezierTipCurve() * Matrix_Scale(0.1f, 0.1f, 0.1f);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, TIPSPHERE);
-        if (g_lookAt)
-            DrawVirtualObject("sphere");
-
-        //desenhar parede 1
-        model = Matrix_Translate(2.5f, 1.3f, 0.0f) * Matrix_Rotate_X(-M_PI / 2) * Matrix_Rotate_Z(M_PI / 2) * Matrix_Scale(2.5f, 2.5f, 2.3f);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, WALL);
-        DrawVirtualObject("plane");
-
-        // desenhar parede 2
-        model = Matrix_Translate(-2.5f, 1.3f, 0.0f) * Matrix_Rotate_X(-M_PI / 2) * Matrix_Rotate_Z(-M_PI / 2) * Matrix_Scale(2.5f, 2.5f, 2.3f);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, WALL);
-        DrawVirtualObject("plane");
-
-        // desenhar parede 3
-        model = Matrix_Translate(0.0f, 1.3f, 2.5f) * Matrix_Rotate_X(-M_PI / 2) * Matrix_Scale(2.5f, 2.5f, 2.3f);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, WALL);
-        DrawVirtualObject("plane");
-
-        // desenhar parede 4
-        model = Matrix_Translate(-1.0f, 1.3f, -2.5f) * Matrix_Rotate_X(-M_PI / 2) * Matrix_Rotate_Z(M_PI) * Matrix_Scale(2.0f, 2.5f, 2.3f);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, WALL);
-        DrawVirtualObject("plane");
-
-        // desenhar chao
-        model = Matrix_Translate(0.0f, 0.0f, 0.0f) * Matrix_Scale(2.5f, 1.0f, 2.5f);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, FLOOR);
-        DrawVirtualObject("plane");
-
-        // desenhar teto1
-        model = Matrix_Translate(0.0f, 3.6f, 0.0f) * Matrix_Scale(2.5f, 1.0f, 2.5f) * Matrix_Rotate_Z(M_PI);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, ROOF1);
-        DrawVirtualObject("plane");
-
-        // desenhar porta1
-        model = Matrix_Translate(1.85f, 1.0f, -2.5f) * Matrix_Rotate_Y(-M_PI / 2) * Matrix_Scale(0.2f, 0.7f, 0.15f);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, DOOR1);
-        if (!door1open)
+        // Se nenhum pacote novo foi produzido desde o último quadro (nenhuma
+        // entrada do usuário, animação visível ou mudança de estado; veja
+        // SceneNeedsRedraw()), o quadro exibido continua correto: bloqueamos
+        // até o próximo evento, sem consumir CPU nem GPU. A thread de
+        // simulação nos acorda ao publicar um pacote.
+        const FramePacket *packet = AcquireFramePacket();
+        if (packet != NULL)
+        {
+            g_RenderSettleFrames = REDRAW_SETTLE_FRAMES - 1;
+        }
+        else if (g_RenderSettleFrames > 0)
+        {
+            g_RenderSettleFrames -= 1;
+            packet = &g_FramePackets[g_FramePacketRead];
+        }
+        else
         {
-            DrawVirtualObject("door");
-        }
-
-        // desenhar parede 5
-        model = Matrix_Translate(2.5f, 1.3f, -5.0f) * Matrix_Rotate_X(-M_PI / 2) * Matrix_Rotate_Z(M_PI / 2) * Matrix_Scale(2.5f, 2.5f, 2.3f);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, WALL);
-        DrawVirtualObject("plane");
-
-        // desenhar parede 6
-        model = Matrix_Translate(-2.5f, 1.3f, -5.0f) * Matrix_Rotate_X(-M_PI / 2) * Matrix_Rotate_Z(-M_PI / 2) * Matrix_Scale(2.5f, 2.5f, 2.3f);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, WALL);
-        DrawVirtualObject("plane");
-
-        // desenhar parede 7
-        model = Matrix_Translate(-1.0f, 1.3f, -2.5f) * Matrix_Rotate_X(-M_PI / 2) * Matrix_Scale(2.0f, 2.5f, 2.3f);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, WALL);
-        DrawVirtualObject("plane");
-
-        // desenhar parede 8
-        model = Matrix_Translate(1.35f, 1.3f, -7.5f) * Matrix_Rotate_X(-M_PI / 2) * Matrix_Rotate_Z(M_PI) * Matrix_Scale(2.0f, 2.5f, 2.3f);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, WALL);
-        DrawVirtualObject("plane");
-
-        // desenhar chao2
-        model = Matrix_Translate(0.0f, 0.0f, -5.0f) * Matrix_Scale(2.5f, 1.0f, 2.5f);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, FLOOR2);
-        DrawVirtualObject("plane");
-
-        // desenhar teto2
-        model = Matrix_Translate(0.0f, 3.6f, -5.0f) * Matrix_Scale(2.5f, 1.0f, 2.5f) * Matrix_Rotate_Z(M_PI);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, ROOF2);
-        DrawVirtualObject("plane");
-
-        // desenhar porta2
-        model = Matrix_Translate(-1.5f, 1.0f, -7.5f) * Matrix_Rotate_Y(-M_PI / 2) * Matrix_Scale(0.2f, 0.7f, 0.15f);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, DOOR2);
-        if (!door2open)
-        {
-            DrawVirtualObject("door");
-        }
-
-        // desenhar parede 9
-        model = Matrix_Translate(2.5f, 1.3f, -10.0f) * Matrix_Rotate_X(-M_PI / 2) * Matrix_Rotate_Z(M_PI / 2) * Matrix_Scale(2.5f, 2.5f, 2.3f);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, WALL);
-        DrawVirtualObject("plane");
+            WaitForRedraw();
+            continue;
+        }
 
-        // desenhar parede 10
-        model = Matrix_Translate(-2.5f, 1.3f, -10.0f) * Matrix_Rotate_X(-M_PI / 2) * Matrix_Rotate_Z(-M_PI / 2) * Matrix_Scale(2.5f, 2.5f, 2.3f);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, WALL);
-        DrawVirtualObject("plane");
+        PROFILE_ZONE("Frame");
 
-        // desenhar parede 11
-        model = Matrix_Translate(1.35f, 1.3f, -7.5f) * Matrix_Rotate_X(-M_PI / 2) * Matrix_Scale(2.0f, 2.5f, 2.3f);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, WALL);
-        DrawVirtualObject("plane");
+        // Aqui executamos as operações de renderização
+        RenderFrame(window, *packet);
 
-        // desenhar parede 12
-        model = Matrix_Translate(0.0f, 1.3f, -12.5f) * Matrix_Rotate_X(-M_PI / 2) * Matrix_Rotate_Z(M_PI) * Matrix_Scale(2.5f, 2.5f, 2.3f);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, WALL);
-        DrawVirtualObject("plane");
-
-        // desenhar chao3
-        model = Matrix_Translate(0.0f, 0.0f, -10.0f) * Matrix_Scale(2.5f, 1.0f, 2.5f);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, FLOOR2);
-        DrawVirtualObject("plane");
-
-        // desenhar teto3
-        model = Matrix_Translate(0.0f, 3.6f, -10.0f) * Matrix_Scale(2.5f, 1.0f, 2.5f) * Matrix_Rotate_Z(M_PI);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, ROOF3);
-        DrawVirtualObject("plane");
-
-        // desenhar map
-        model = Matrix_Translate(-2.4f, 1.3f, 0.0f) * Matrix_Rotate_X(-M_PI / 2) * Matrix_Rotate_Z(-M_PI / 2) * Matrix_Rotate_Y(M_PI) * Matrix_Scale(2.2f, 1.0f, 1.0f);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, MAP);
-        DrawVirtualObject("plane");
-
-        // desenhar lever1
-        model = Matrix_Translate(-2.4f, 1.9f, 1.3f) * Matrix_Rotate_Z(-M_PI / 2) * Matrix_Scale(0.075f, 0.075f, 0.075f);
-        if (lever1act)
-        {
-            model = model * Matrix_Rotate_Y(M_PI);
-        }
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, LEVER1);
-        DrawVirtualObject("lever");
-
-        // desenhar lever2
-        model = Matrix_Translate(-2.4f, 1.0f, -1.70f) * Matrix_Rotate_Z(-M_PI / 2) * Matrix_Scale(0.075f, 0.075f, 0.075f);
-        if (lever2act)
-        {
-            model = model * Matrix_Rotate_Y(M_PI);
-        }
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, LEVER2);
-        DrawVirtualObject("lever");
-
-        // desenhar lever3
-        model = Matrix_Translate(-2.4f, 1.95f, -1.0f) * Matrix_Rotate_Z(-M_PI / 2) * Matrix_Scale(0.075f, 0.075f, 0.075f);
-        if (lever3act)
-        {
-            model = model * Matrix_Rotate_Y(M_PI);
-        }
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, LEVER3);
-        DrawVirtualObject("lever");
-
-        // desenhar lever4
-        model = Matrix_Translate(-2.4f, 1.5f, -0.95f) * Matrix_Rotate_Z(-M_PI / 2) * Matrix_Scale(0.075f, 0.075f, 0.075f);
-        if (lever4act)
-        {
-            model = model * Matrix_Rotate_Y(M_PI);
-        }
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, LEVER4);
-        DrawVirtualObject("lever");
-
-        // desenhar lever5
-        model = Matrix_Translate(-2.4f, 1.2f, 0.55f) * Matrix_Rotate_Z(-M_PI / 2) * Matrix_Scale(0.075f, 0.075f, 0.075f);
-        if (lever5act)
-        {
-            model = model * Matrix_Rotate_Y(M_PI);
-        }
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, LEVER5);
-        DrawVirtualObject("lever");
-
-        // desenhar 6
-        model = Matrix_Translate(-2.4f, 1.5f, -0.5f) * Matrix_Rotate_Z(-M_PI / 2) * Matrix_Scale(0.075f, 0.075f, 0.075f);
-        if (lever6act)
-        {
-            model = model * Matrix_Rotate_Y(M_PI);
-        }
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, LEVER6);
-        DrawVirtualObject("lever");
-
-        // desenhar lever7
-        model = Matrix_Translate(-2.4f, 1.8f, -0.2f) * Matrix_Rotate_Z(-M_PI / 2) * Matrix_Scale(0.075f, 0.075f, 0.075f);
-        if (lever7act)
-        {
-            model = model * Matrix_Rotate_Y(M_PI);
-        }
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, LEVER7);
-        DrawVirtualObject("lever");
-
-        // desenhar TIPBOARD1
-        model = Matrix_Translate(0.0f, 1.3f, 2.49f) * Matrix_Rotate_X(M_PI / 2) * Matrix_Rotate_Z(M_PI) * Matrix_Scale(1.0f, 1.0f, 1.0f);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, TIPBOARD1);
-        DrawVirtualObject("plane");
-
-        // desenhar WOODTABLE
-        model = Matrix_Translate(-1.0f, 0.3f, -4.0f) * Matrix_Scale(0.175f, 0.175f, 0.175f) * Matrix_Rotate_Y(M_PI / 2);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, WOODTABLE);
-        DrawVirtualObject("woodTable");
-
-        // desenhar WOODTABLE2 mesa em baixo do globo
-        model = Matrix_Translate(0.0f, 0.2f, -2.4f) * Matrix_Scale(0.1f, 0.1f, 0.1f) * Matrix_Rotate_Y(M_PI / 2);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, WOODTABLE);
-        DrawVirtualObject("woodTable");
-
-        // desenhar WOODCHAIR
-        model = Matrix_Translate(-1.0f, 0.0f, -4.0f) * Matrix_Scale(0.135f, 0.135f, 0.135f) * Matrix_Rotate_Y(woodenChairRotation * -M_PI / 2);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, WOODCHAIR);
-        DrawVirtualObject("woodChair");
-
-        // desenhar WOODZ1
-        model = Matrix_Translate(-2.4f, 1.8f, -5.2f) * Matrix_Scale(1.0f, 1.0f, 1.0f) * Matrix_Rotate_X(woodenZ1Rotation * M_PI / 5);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, WOODZ1);
-        DrawVirtualObject("woodZ");
-
-        // desenhar WOODZ2
-        model = Matrix_Translate(-2.4f, 1.5f, -5.4f) * Matrix_Scale(1.0f, 1.0f, 1.0f) * Matrix_Rotate_X(woodenZ2Rotation * M_PI / 5);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, WOODZ2);
-        DrawVirtualObject("woodZ");
-
-        // desenhar WOODZ3
-        model = Matrix_Translate(-2.4f, 1.8f, -5.6f) * Matrix_Scale(1.0f, 1.0f, 1.0f) * Matrix_Rotate_X(woodenZ3Rotation * M_PI / 5);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, WOODZ3);
-        DrawVirtualObject("woodZ");
-
-        // desenhar TIPBOARD2
-        model = Matrix_Translate(2.49f, 1.3f, -5.0f) * Matrix_Rotate_X(-M_PI / 2) * Matrix_Rotate_Z(M_PI / 2) * Matrix_Rotate_Y(M_PI) * Matrix_Scale(1.5f, 0.75f, 0.75f);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, TIPBOARD2);
-        DrawVirtualObject("plane");
-
-        // desenhar OSCAR
-        model = Matrix_Translate(0.0f, 0.0f, -12.0f) * Matrix_Scale(2.5f, 2.5f, 2.5f);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, OSCAR);
-        DrawVirtualObject("oscar");
-
-        // desenhar Spider1
-        model = Matrix_Translate(1.0f, 0.0f, -11.5f) * Matrix_Scale(0.50f, 0.50f, 0.50f) * Matrix_Rotate_Y(-M_PI / 5);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, SPIDER1);
-        DrawVirtualObject("spider");
-
-        // desenhar Spider2
-        model = Matrix_Translate(-1.0f, 0.0f, -11.5f) * Matrix_Scale(0.50f, 0.50f, 0.50f) * Matrix_Rotate_Y(M_PI / 5);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, SPIDER2);
-        DrawVirtualObject("spider");
-
-        // desenhar TROPHY
-        model = Matrix_Translate(0.0f, 0.0f, -11.0f) * Matrix_Scale(0.25f, 0.25f, 0.25f) * Matrix_Rotate_Y(M_PI / 2);
-        glUniformMatrix4fv(model_uniform, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform1i(object_id_uniform, TROPHY);
-        DrawVirtualObject("trophy");
-
-        // Imprimimos na tela os ângulos de Euler que controlam a rotação do
-        // terceiro cubo.
-        TextRendering_ShowEulerAngles(window);
-
-        // Imprimimos na informação sobre a matriz de projeção sendo utilizada.
-        TextRendering_ShowProjection(window);
-
-        // Imprimimos na tela informação sobre o número de quadros renderizados
-        // por segundo (frames per second).
-        TextRendering_ShowFramesPerSecond(window);
+        // As telas de mensagem são estáticas: são desenhadas e exibidas uma
+        // única vez, e o sistema de janelas continua apresentando o mesmo
+        // quadro enquanto esperamos por eventos. Só as redesenhamos quando a
+        // janela pedir (redimensionamento, exposição; veja RequestRedraw()).
+        bool message_drawn = false;
         while (!glfwWindowShouldClose(window) && showControlMessage)
         {
-            //Pintamos tudo de branco e reiniciamos o Z-BUFFER
-            //glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            glUseProgram(program_id);
-
-            PrintFinalMessage(window, "CONTROLS: \n WASD: MOVE CHARACTER\n F: TOGGLE TIP_CAM\n 1234567: TOGGLE LEVERS ON FIRST ROOM \n 2345: CHANGE CHAIR AND WALL PUZZLE POSITION ON SECOND ROOM \n ESC: QUIT GAME", 2.0f);
-
-            glfwSwapBuffers(window);
-            glfwPollEvents();
-        }
-
-        if (endGame)
-            while (!glfwWindowShouldClose(window))
+            if (ConsumeRedrawRequest() || !message_drawn)
             {
                 //Pintamos tudo de branco e reiniciamos o Z-BUFFER
-                glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+                //glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
                 glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
                 glUseProgram(program_id);
 
-                PrintFinalMessage(window, "CONGRATULATIONS! \n YOU'VE FINISHED THE GAME\n Press ESC to close this window", 2.0f);
+                PrintFinalMessage(window, "CONTROLS: \n WASD: MOVE CHARACTER\n F: TOGGLE TIP_CAM\n 1234567: TOGGLE LEVERS ON FIRST ROOM \n 2345: CHANGE CHAIR AND WALL PUZZLE POSITION ON SECOND ROOM \n ESC: QUIT GAME", 2.0f);
+                TextRendering_Flush();
 
                 glfwSwapBuffers(window);
-                glfwPollEvents();
+                message_drawn = true;
             }
+            glfwWaitEvents();
 
-        glfwSwapBuffers(window);
-
-        glfwPollEvents();
-    }
+            // O tempo com a tela de mensagem aberta não pertence a quadro algum.
+            g_FrameStartSeconds = cpu_start_seconds = GetTimeSeconds();
+        }
 
-    // Finalizamos o uso dos recursos do sistema operacional
-    glfwTerminate();
+        if (packet->end_game)
+            while (!glfwWindowShouldClose(window))
+            {
+                if (ConsumeRedrawRequest() || !message_drawn)
+                {
+                    //Pintamos tudo de branco e reiniciamos o Z-BUFFER
+                    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+                    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                    glUseProgram(program_id);
 
-    // Fim do programa
-    return 0;
-}
+                    PrintFinalMessage(window, "CONGRATULATIONS! \n YOU'VE FINISHED THE GAME\n Press ESC to close this window", 2.0f);
+                    TextRendering_Flush();
 
-void PrintFinalMessage(GLFWwindow *window, std::string text, float scale)
-{
-    float pad = TextRendering_LineHeight(window) * scale;
-    float charWidth = TextRendering_CharWidth(window) * scale;
+                    glfwSwapBuffers(window);
+                    message_drawn = true;
+                }
+                glfwWaitEvents();
+            }
 
-    char buffer[200];
-    int lineCount = 0;
-    std::string::size_type lastTokenPos = 0;
-    std::string::size_type nextTokenPos = 0;
-    std::vector<std::string> lines = {};
-    while (nextTokenPos != std::string::npos)
-    {
-        lineCount += 1;
-        lastTokenPos = nextTokenPos;
-        nextTokenPos = text.find_first_of("\n", lastTokenPos + 1);
+        AccumulateFrameTime(g_RenderCpuStats, GetTimeSeconds() - cpu_start_seconds);
+        GpuTimer_EndFrame();
 
-        lines.push_back(text.substr(lastTokenPos, nextTokenPos - lastTokenPos));
-    }
+        {
+            PROFILE_ZONE("SwapBuffers");
+            glfwSwapBuffers(window);
+        }
+        UpdateFrameTimeStats();
 
-    int totalLines = lines.size();
-    int currLine = 0;
-    while (lines.size() > 0)
-    {
-        std::string text = lines[lines.size() - 1];
-        snprintf(buffer, 200, text.c_str());
-        TextRendering_PrintString(window, buffer, text.size() * 0.5 * charWidth * -1, currLine * pad - totalLines * 0.5 * pad, scale);
+        glfwPollEvents();
 
-        currLine += 1;
-        lines.pop_back();
+        // Avançamos a recompilação dos shaders alterados, sem bloquear o quadro.
+        UpdateShaderReload();
     }
 }
 
-// Função que carrega uma imagem para ser utilizada como textura
-void LoadTextureImage(const char *filename)
+// Desenha o quadro do pacote no framebuffer atual: a cena, as visualizações
+// de depuração e o texto da interface. Chamada pelo laço principal e pelo
+// modo de benchmark.
+void RenderFrame(GLFWwindow *window, const FramePacket &packet)
 {
-    printf("Carregando imagem \"%s\"... ", filename);
+    // Definimos a cor do "fundo" do framebuffer como branco.  Tal cor é
+    // definida como coeficientes RGBA: Red, Green, Blue, Alpha; isto é:
+    // Vermelho, Verde, Azul, Alpha (valor de transparência).
+    // Conversaremos sobre sistemas de cores nas aulas de Modelos de Iluminação.
+    //
+    //           R     G     B     A
+    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
 
-    // Primeiro fazemos a leitura da imagem do disco
-    stbi_set_flip_vertically_on_load(true);
-    int width;
-    int height;
-    int channels;
-    unsigned char *data = stbi_load(filename, &width, &height, &channels, 3);
+    // "Pintamos" todos os pixels do framebuffer com a cor definida acima,
+    // e também resetamos todos os pixels do Z-buffer (depth buffer).
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    if (data == NULL)
-    {
-        fprintf(stderr, "ERROR: Cannot open image file \"%s\".\n", filename);
-        std::exit(EXIT_FAILURE);
-    }
+    // Pedimos para a GPU utilizar o programa de GPU criado acima (contendo
+    // os shaders de vértice e fragmentos).
+    glUseProgram(program_id);
 
-    printf("OK (%dx%d).\n", width, height);
+    // Desenhamos todos os objetos da lista de desenho do pacote.
+    SubmitDrawList(packet);
 
-    // Agora criamos objetos na GPU com OpenGL para armazenar a textura
-    GLuint texture_id;
-    GLuint sampler_id;
-    glGenTextures(1, &texture_id);
-    glGenSamplers(1, &sampler_id);
+    // Desenhamos o Z-buffer da oclusão por software no canto inferior
+    // esquerdo da tela.
+    if (!packet.occlusion_image.empty())
+        SoftwareOcclusion_DrawDebug(packet.occlusion_image.data(), -1.0f, -1.0f, -0.4f, -0.4f);
 
-    glSamplerParameteri(sampler_id, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glSamplerParameteri(sampler_id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    // Desenhamos o gráfico do tempo dos últimos quadros no canto inferior
+    // direito da tela.
+    if (g_ShowInfoText)
+        FrameStats_DrawGraph(0.5f, -0.85f, 0.98f, -0.55f);
 
-    // Parâmetros de amostragem da textura.
-    glSamplerParameteri(sampler_id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glSamplerParameteri(sampler_id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    PROFILE_ZONE("Text");
 
-    // Agora enviamos a imagem lida do disco para a GPU
+    // Imprimimos na tela os ângulos de Euler que controlam a rotação do
+    // terceiro cubo.
+    TextRendering_ShowEulerAngles(window);
+
+    // Imprimimos na informação sobre a matriz de projeção sendo utilizada.
+    TextRendering_ShowProjection(window, packet);
+
+    // Imprimimos na tela informação sobre o número de quadros renderizados
+    // por segundo (frames per second).
+    TextRendering_ShowFramesPerSecond(window);
+
+    // Imprimimos na tela as estatísticas de submissão da cena.
+    TextRendering_ShowDrawStats(window, packet);
+
+    // Imprimimos na tela o tempo de GPU de cada passada.
+    TextRendering_ShowGpuTimes(window);
+
+    // Todo o texto acima é desenhado aqui, com uma única chamada de desenho.
+    GpuTimer_Begin(GPU_PASS_TEXT);
+    TextRendering_Flush();
+    GpuTimer_End(GPU_PASS_TEXT);
+}
+
+// Executa o roteiro de benchmark carregado (veja "benchmark.cpp"): desenha
+// Benchmark_Frames() quadros no contexto sem janela, com a câmera no caminho
+// do roteiro e o estado forçado pelo mesmo, e grava os resultados. As
+// animações avançam um passo fixo da simulação por quadro, de modo que todas
+// as execuções desenham exatamente as mesmas imagens. Retorna false se o
+// roteiro é inválido ou os resultados não puderam ser gravados.
+bool RunBenchmark(const char *output_prefix)
+{
+    // Todas as variáveis do roteiro devem existir antes de começar.
+    for (int i = 0; i < Benchmark_NumStateChanges(); ++i)
+    {
+        int frame, value;
+        const char *name = Benchmark_StateChange(i, &frame, &value);
+        if (!SetBenchmarkVariable(name, value, true))
+        {
+            fprintf(stderr, "ERROR: Unknown benchmark variable \"%s\".\n", name);
+            return false;
+        }
+    }
+
+    // Não há "swap chain" nem sincronização vertical no contexto sem janela:
+    // a CPU é limitada pela espera dos resultados das consultas de tempo de
+    // GPU de GpuTimer_Latency() quadros atrás, e todo quadro tem os seus
+    // tempos de GPU.
+    GpuTimer_SetWaitForResults(true);
+    int latency = GpuTimer_Latency();
+    double gpu_ms[GPU_PASS_COUNT];
+
+    g_lookAt = false;
+    int frames = Benchmark_Frames();
+    int next_change = 0;
+    FramePacket &packet = g_FramePackets[g_FramePacketWrite];
+    double start_seconds = GetTimeSeconds();
+    g_FrameStartSeconds = start_seconds;
+
+    // Os últimos "latency" passos somente leem os tempos de GPU pendentes.
+    for (int frame = 0; frame < frames + latency; ++frame)
+    {
+        if (frame < frames)
+        {
+            PROFILE_ZONE("Frame");
+            double cpu_start_seconds = GetTimeSeconds();
+
+            {
+                std::lock_guard<std::mutex> lock(g_SimulationMutex);
+
+                while (next_change < Benchmark_NumStateChanges())
+                {
+                    int change_frame, value;
+                    const char *name = Benchmark_StateChange(next_change, &change_frame, &value);
+                    if (change_frame > frame)
+                        break;
+                    SetBenchmarkVariable(name, value, false);
+                    next_change += 1;
+                }
+                UpdateDoorState();
+
+                // A câmera segue o caminho do roteiro, e não a simulação.
+                glm::vec4 camera_position;
+                Benchmark_Camera(frame, camera_position, cameraLookAt_l_g);
+                g_camX = camera_position.x;
+                g_camY = camera_position.y;
+                g_camZ = camera_position.z;
+
+                SimulationStep((float)SIMULATION_STEP_SECONDS);
+                SimulationState state = CurrentSimulationState();
+                state.camera_position = camera_position;
+                BuildFramePacket(packet, state);
+            }
+            FinishFramePacket(packet);
+
+            RenderFrame(NULL, packet);
+            DumpFrame(frame);
+
+            const DrawStats &stats = g_DrawStats[g_DrawBackend];
+            double cpu_seconds = GetTimeSeconds() - cpu_start_seconds;
+            AccumulateFrameTime(g_RenderCpuStats, cpu_seconds);
+            GpuTimer_EndFrame();
+            glFlush();
+
+            double frame_seconds = UpdateFrameTimeStats();
+            Benchmark_RecordFrame(frame, frame_seconds, cpu_seconds, stats.draw_calls, stats.triangles, (int)packet.draw_list.size());
+        }
+        else
+        {
+            GpuTimer_EndFrame();
+        }
+
+        if (frame >= latency)
+        {
+            for (int pass = 0; pass < GPU_PASS_COUNT; ++pass)
+                gpu_ms[pass] = GpuTimer_IsActive(pass) ? GpuTimer_LastMs(pass) : 0.0;
+            Benchmark_RecordGpuTimes(frame - latency, gpu_ms, GPU_PASS_COUNT);
+        }
+    }
+    glFinish();
+
+    printf("Benchmark: %d quadros em %.2f s\n", frames, GetTimeSeconds() - start_seconds);
+
+    for (size_t i = 0; i < g_LoadPhases.size(); ++i)
+        Benchmark_RecordLoadPhase(g_LoadPhases[i].name, g_LoadPhases[i].seconds);
+
+    return Benchmark_WriteResults(output_prefix, GPU_PASS_NAMES, GPU_PASS_COUNT);
+}
+
+// Reproduz a gravação da entrada carregada (veja "inputrecord.cpp"): a cada
+// quadro, entrega aos callbacks os eventos gravados antes do próximo passo da
+// simulação, executa exatamente um passo e desenha o estado resultante, sem
+// interpolação. Sem sincronização vertical nem espera, a reprodução roda tão
+// rápido quanto possível e percorre exatamente os mesmos estados da sessão
+// gravada, em qualquer máquina. As telas de mensagem não são exibidas.
+// Retorna false se o estado final difere do estado final da gravação.
+bool RunReplay(GLFWwindow *window)
+{
+    // Sem janela ("--headless"), não há "swap chain": a CPU é limitada pela
+    // espera dos resultados das consultas de tempo de GPU, como no benchmark.
+    if (window != NULL)
+        glfwSwapInterval(0);
+    else
+        GpuTimer_SetWaitForResults(true);
+
+    FramePacket &packet = g_FramePackets[g_FramePacketWrite];
+    unsigned long end_step = InputReplay_EndStep();
+    double start_seconds = GetTimeSeconds();
+    g_FrameStartSeconds = start_seconds;
+
+    for (int frame = 0; g_SimulationStepCount < end_step && (window == NULL || !glfwWindowShouldClose(window)); ++frame)
+    {
+        PROFILE_ZONE("Frame");
+        double cpu_start_seconds = GetTimeSeconds();
+
+        InputReplay_DispatchEvents(window, g_SimulationStepCount);
+        {
+            std::lock_guard<std::mutex> lock(g_SimulationMutex);
+            SimulationStep((float)SIMULATION_STEP_SECONDS);
+            BuildFramePacket(packet, CurrentSimulationState());
+        }
+        FinishFramePacket(packet);
+
+        RenderFrame(window, packet);
+        DumpFrame(frame);
+
+        AccumulateFrameTime(g_RenderCpuStats, GetTimeSeconds() - cpu_start_seconds);
+        GpuTimer_EndFrame();
+
+        if (window != NULL)
+        {
+            PROFILE_ZONE("SwapBuffers");
+            glfwSwapBuffers(window);
+        }
+        else
+        {
+            glFlush();
+        }
+        UpdateFrameTimeStats();
+
+        if (window != NULL)
+            glfwPollEvents();
+    }
+
+    if (g_SimulationStepCount < end_step)
+    {
+        printf("Reprodução interrompida no passo %lu de %lu\n", g_SimulationStepCount, end_step);
+        return true;
+    }
+
+    // Os eventos do último passo (por exemplo, a tecla ESC).
+    InputReplay_DispatchEvents(window, g_SimulationStepCount);
+
+    printf("Reprodução: %lu passos em %.2f s\n", end_step, GetTimeSeconds() - start_seconds);
+
+    unsigned int checksum = SimulationChecksum();
+    unsigned int expected;
+    if (!InputReplay_Checksum(&expected))
+        return true;
+    if (checksum != expected)
+    {
+        fprintf(stderr, "ERROR: Replay diverged from the recording (final state checksum %08x, expected %08x).\n", checksum, expected);
+        return false;
+    }
+    printf("Reprodução: estado final idêntico ao da gravação (%08x)\n", checksum);
+    return true;
+}
+
+// Executa o teste de regressão carregado (veja "regression.cpp"): para cada
+// pose do roteiro, desenha Regression_Runs() vezes Regression_Frames()
+// quadros com a câmera na pose, esperando a GPU terminar cada um, e verifica
+// a imagem do último quadro, a menor das medianas do tempo por quadro de
+// cada execução e as contagens do último quadro. Os primeiros
+// quadros de cada pose também servem para estabilizar as consultas de
+// oclusão, cujos resultados chegam um quadro depois. Com "update", ou se as
+// referências ainda não existem, grava as referências. Retorna false se
+// alguma pose falhou.
+bool RunRegression(bool update)
+{
+    {
+        std::lock_guard<std::mutex> lock(g_SimulationMutex);
+        for (int i = 0; i < Regression_NumStateChanges(); ++i)
+        {
+            int value;
+            const char *name = Regression_StateChange(i, &value);
+            if (!SetBenchmarkVariable(name, value, false))
+            {
+                fprintf(stderr, "ERROR: Unknown regression variable \"%s\".\n", name);
+                return false;
+            }
+        }
+        UpdateDoorState();
+
+        // O texto da interface mostra tempos, diferentes a cada execução, e
+        // as animações ficam paradas (não há passos da simulação): as
+        // imagens dependem somente da pose e do estado do roteiro.
+        g_ShowInfoText = false;
+        g_lookAt = false;
+    }
+
+    Regression_Begin(update);
+
+    GpuTimer_SetWaitForResults(true);
+    FramePacket &packet = g_FramePackets[g_FramePacketWrite];
+    std::vector<double> frame_ms(Regression_Frames());
+    std::vector<unsigned char> pixels;
+
+    // As execuções percorrem todas as poses em rodízio: uma interferência
+    // passageira (outro processo, o sistema) atinge uma execução de várias
+    // poses, e não todas as execuções de uma mesma pose.
+    std::vector<double> best_ms(Regression_NumPoses());
+    for (int run = 0; run < Regression_Runs(); ++run)
+    {
+        for (int pose = 0; pose < Regression_NumPoses(); ++pose)
+        {
+            glm::vec4 camera_position;
+            Regression_Pose(pose, camera_position, cameraLookAt_l_g);
+
+            for (int frame = 0; frame < Regression_Frames(); ++frame)
+            {
+                PROFILE_ZONE("Frame");
+                double start_seconds = GetTimeSeconds();
+                {
+                    std::lock_guard<std::mutex> lock(g_SimulationMutex);
+                    SimulationState state = CurrentSimulationState();
+                    state.camera_position = camera_position;
+                    BuildFramePacket(packet, state);
+                }
+                FinishFramePacket(packet);
+                RenderFrame(NULL, packet);
+                GpuTimer_EndFrame();
+                glFinish();
+                frame_ms[frame] = 1000.0 * (GetTimeSeconds() - start_seconds);
+            }
+
+            std::sort(frame_ms.begin(), frame_ms.end());
+            double median_ms = frame_ms[frame_ms.size() / 2];
+            if (run == 0 || median_ms < best_ms[pose])
+                best_ms[pose] = median_ms;
+
+            // Na última execução, a pose é verificada.
+            if (run == Regression_Runs() - 1)
+            {
+                const DrawStats &stats = g_DrawStats[g_DrawBackend];
+                Offscreen_ReadPixels(g_FramebufferWidth, g_FramebufferHeight, pixels);
+                Regression_CheckPose(pose, pixels, best_ms[pose], stats.draw_calls, stats.triangles, update);
+            }
+        }
+    }
+
+    return Regression_End(update);
+}
+
+// Grava a imagem do quadro "frame", recém desenhado no framebuffer atual,
+// se pedido pela opção "--dump-frames" (veja g_DumpFramesPrefix).
+void DumpFrame(int frame)
+{
+    if (g_DumpFramesPrefix == NULL || frame % g_DumpFramesInterval != 0)
+        return;
+
+    PROFILE_FUNCTION();
+
+    char filename[1024];
+    snprintf(filename, sizeof(filename), "%s_%06d.ppm", g_DumpFramesPrefix, frame);
+
+    std::vector<unsigned char> pixels;
+    Offscreen_ReadPixels(g_FramebufferWidth, g_FramebufferHeight, pixels);
+    if (!Offscreen_WritePPM(filename, g_FramebufferWidth, g_FramebufferHeight, pixels))
+    {
+        fprintf(stderr, "ERROR: Cannot write \"%s\"; frame dumps disabled.\n", filename);
+        g_DumpFramesPrefix = NULL;
+    }
+}
+
+// Força o valor de uma variável do estado do jogo ou das opções de
+// renderização, pelo nome usado nos roteiros de benchmark:
+//
+//   door1, door2              Portas abertas (1) ou fechadas (0)
+//   lever1 ... lever7         Alavancas da primeira sala
+//   chair, woodz1 ... woodz3  Posições do quebra-cabeça da segunda sala
+//   prepass, multidraw, frustum, portals, occlusion, swocclusion, hud
+//                             Opções alternadas pelas teclas E, M, C, V, Q, K e H
+//
+// Com "check_only", somente verifica se a variável existe. Retorna false se
+// a variável não existe.
+bool SetBenchmarkVariable(const char *name, int value, bool check_only)
+{
+    struct
+    {
+        const char *name;
+        int *variable;
+    } game_variables[] = {
+        {"door1", &door1open}, {"door2", &door2open},
+        {"lever1", &lever1act}, {"lever2", &lever2act}, {"lever3", &lever3act}, {"lever4", &lever4act},
+        {"lever5", &lever5act}, {"lever6", &lever6act}, {"lever7", &lever7act},
+        {"chair", &woodenChairRotation}, {"woodz1", &woodenZ1Rotation}, {"woodz2", &woodenZ2Rotation}, {"woodz3", &woodenZ3Rotation},
+    };
+    struct
+    {
+        const char *name;
+        bool *variable;
+    } options[] = {
+        {"prepass", &g_DepthPrepass}, {"frustum", &g_FrustumCulling}, {"portals", &g_PortalCulling},
+        {"occlusion", &g_OcclusionQueries}, {"swocclusion", &g_SoftwareOcclusion}, {"hud", &g_ShowInfoText},
+    };
+
+    for (size_t i = 0; i < sizeof(game_variables) / sizeof(game_variables[0]); ++i)
+    {
+        if (strcmp(name, game_variables[i].name) != 0)
+            continue;
+        if (!check_only)
+            *game_variables[i].variable = value;
+        return true;
+    }
+    for (size_t i = 0; i < sizeof(options) / sizeof(options[0]); ++i)
+    {
+        if (strcmp(name, options[i].name) != 0)
+            continue;
+        if (!check_only)
+            *options[i].variable = value != 0;
+        return true;
+    }
+    if (strcmp(name, "multidraw") == 0)
+    {
+        if (!check_only)
+            g_DrawBackend = value != 0 ? DRAW_BACKEND_MULTI_DRAW : DRAW_BACKEND_PER_OBJECT;
+        return true;
+    }
+    return false;
+}
+
+// Registra o tempo desde "phase_start_seconds" como o tempo da etapa "name"
+// da carga, e reinicia a contagem para a próxima etapa.
+void EndLoadPhase(const char *name, double &phase_start_seconds)
+{
+    double now_seconds = GetTimeSeconds();
+    LoadPhase phase;
+    phase.name = name;
+    phase.seconds = now_seconds - phase_start_seconds;
+    g_LoadPhases.push_back(phase);
+    phase_start_seconds = now_seconds;
+}
+
+// Imprime no terminal o tempo de cada etapa da carga.
+void PrintLoadPhases()
+{
+    double total_seconds = 0.0;
+    printf("Tempo de carga:");
+    for (size_t i = 0; i < g_LoadPhases.size(); ++i)
+    {
+        printf(" %s %.1f ms,", g_LoadPhases[i].name, 1000.0 * g_LoadPhases[i].seconds);
+        total_seconds += g_LoadPhases[i].seconds;
+    }
+    printf(" total %.1f ms\n", 1000.0 * total_seconds);
+}
+
+// Tempo em segundos desde o início do programa, de um relógio monotônico.
+// Utilizada no lugar de glfwGetTime(), a qual exige a inicialização da GLFW
+// (e portanto de um display; veja "offscreen.cpp").
+double GetTimeSeconds()
+{
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Endereço de uma função OpenGL ausente do carregador GLAD (extensões e
+// versões posteriores à 3.3), do contexto da janela ou do contexto sem janela.
+void *GetGLProcAddress(const char *name)
+{
+    if (g_Offscreen)
+        return Offscreen_GetProcAddress(name);
+    return (void *)glfwGetProcAddress(name);
+}
+
+// Monta a cena de um quadro no estado "state" da simulação: as matrizes da
+// câmera, a lista de desenho (em g_DrawList) e a cópia das variáveis do jogo
+// e das opções lidas depois, sem o mutex, por FinishFramePacket(). Chamada
+// por ProduceFramePacket(), com g_SimulationMutex travado.
+void BuildFramePacket(FramePacket &packet, const SimulationState &state)
+{
+    PROFILE_FUNCTION();
+
+    glm::vec4 cameraPosition_c;
+    glm::vec4 cameraLookAt_l;
+    glm::vec4 cameraViewVector;
+    glm::vec4 cameraUpVector;
+    glm::vec4 cameraPosition_c_x;
+    glm::vec4 cameraLookAt_l_x;
+    glm::vec4 cameraUpVector_x;
+
+    float r = 2.0f;
+    float y = r * sin(g_CameraPhi);
+    float z = r * cos(g_CameraPhi) * cos(g_CameraTheta);
+    float x = r * cos(g_CameraPhi) * sin(g_CameraTheta);
+
+    if (g_lookAt)
+    {
+        cameraPosition_c_x = glm::vec4(2.0, 3.0, 0.0, 1.0f); // camera da parede apontada fixamente.
+        cameraLookAt_l_x = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        cameraUpVector_x = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f); // vetor "up" sendo colocado fixamente sempre olhando para o "céu" (eixo y global).
+    }
+    else
+    {
+        cameraPosition_c_x = state.camera_position;
+        cameraLookAt_l_x = cameraLookAt_l_g;
+        cameraUpVector_x = cameraUpVector_g;
+    }
+
+    // Abaixo definimos as varáveis que efetivamente definem a câmera virtual.
+    // Veja slides 195-227 e 229-234 do documento Aula_08_Sistemas_de_Coordenadas.pdf.
+    cameraPosition_c = cameraPosition_c_x; // Ponto "c", centro da câmera
+    cameraPosition_c_g = cameraPosition_c_x;
+    cameraLookAt_l = cameraLookAt_l_x;                    // Ponto "l", para onde a câmera (look-at) estará sempre olhando
+    cameraViewVector = cameraLookAt_l - cameraPosition_c; // Vetor "view", sentido para onde a câmera está virada
+    cameraUpVector = cameraUpVector_x;                    // Vetor "up" fixado para apontar para o "céu" (eito Y global)
+
+    // Computamos a matriz "View" utilizando os parâmetros da câmera para
+    // definir o sistema de coordenadas da câmera.  Veja slides 2-14, 184-190 e 236-242 do documento Aula_08_Sistemas_de_Coordenadas.pdf.
+    glm::mat4 view = Matrix_Camera_View(cameraPosition_c, cameraViewVector, cameraUpVector);
+
+    // Agora computamos a matriz de Projeção.
+    glm::mat4 projection;
+
+    // Note que, no sistema de coordenadas da câmera, os planos near e far
+    // estão no sentido negativo! Veja slides 176-204 do documento Aula_09_Projecoes.pdf.
+    float nearplane = -0.1f;     // Posição do "near plane"
+    float farplane = -10000.0f; // Posição do "far plane"
+
+    if (g_UsePerspectiveProjection)
+    {
+        // Projeção Perspectiva.
+        // Para definição do field of view (FOV), veja slides 205-215 do documento Aula_09_Projecoes.pdf.
+        float field_of_view = M_PI / 2.0f;
+        projection = Matrix_Perspective(field_of_view, g_ScreenRatio, nearplane, farplane);
+    }
+    else
+    {
+        // Projeção Ortográfica.
+        // Para definição dos valores l, r, b, t ("left", "right", "bottom", "top"),
+        // PARA PROJEÇÃO ORTOGRÁFICA veja slides 219-224 do documento Aula_09_Projecoes.pdf.
+        // Para simular um "zoom" ortográfico, computamos o valor de "t"
+        // utilizando a variável g_CameraDistance.
+        float t = 1.5f * g_CameraDistance / 2.5f;
+        float b = -t;
+        float r = t * g_ScreenRatio;
+        float l = -r;
+        projection = Matrix_Orthographic(l, r, b, t, nearplane, farplane);
+    }
+
+    glm::mat4 model = Matrix_Identity(); // Transformação identidade de modelagem
+
+#define SPHERE 0
+#define BUNNY 1
+#define WALL 2
+#define FLOOR 6
+#define FLOOR2 11
+#define FLOOR3 16
+#define DOOR1 17
+#define DOOR2 18
+#define MAP 19
+#define LEVER1 20
+#define LEVER2 21
+#define LEVER3 22
+#define LEVER4 23
+#define LEVER5 24
+#define LEVER6 25
+#define LEVER7 26
+#define WOODTABLE 27
+#define WOODCHAIR 28
+#define WOODZ1 29
+#define WOODZ2 30
+#define WOODZ3 31
+#define TIPBOARD1 32
+#define TIPBOARD2 33
+#define OSCAR 34
+#define SPIDER1 35
+#define SPIDER2 36
+#define TROPHY 37
+#define ROOF1 38
+#define ROOF2 39
+#define ROOF3 40
+#define TIPSPHERE 41
+
+    PortalCulling_SetPortalOpen(g_Door1Portal, door1open);
+    PortalCulling_SetPortalOpen(g_Door2Portal, door2open);
+
+    // Desenhamos o modelo da esfera
+    model = Matrix_Translate(0.0f, 0.9f, -2.0f) * Matrix_Rotate_Z(0.6f) * Matrix_Rotate_X(0.2f) * Matrix_Rotate_Y(g_AngleY + state.globe_angle) * Matrix_Scale(0.3f, 0.3f, 0.3f);
+    AddToDrawList("sphere", model, SPHERE, ROOM1);
+
+    // Desenhamos a sphera com dica
+    model = bezierTipCurve(state.bezier_t) * Matrix_Scale(0.1f, 0.1f, 0.1f);
+    if (g_lookAt)
+        AddToDrawList("sphere", model, TIPSPHERE, ROOM1);
+
+    //desenhar parede 1
+    model = Matrix_Translate(2.5f, 1.3f, 0.0f) * Matrix_Rotate_X(-M_PI / 2) * Matrix_Rotate_Z(M_PI / 2) * Matrix_Scale(2.5f, 2.5f, 2.3f);
+    AddToDrawList("plane", model, WALL, ROOM1);
+
+    // desenhar parede 2
+    model = Matrix_Translate(-2.5f, 1.3f, 0.0f) * Matrix_Rotate_X(-M_PI / 2) * Matrix_Rotate_Z(-M_PI / 2) * Matrix_Scale(2.5f, 2.5f, 2.3f);
+    AddToDrawList("plane", model, WALL, ROOM1);
+
+    // desenhar parede 3
+    model = Matrix_Translate(0.0f, 1.3f, 2.5f) * Matrix_Rotate_X(-M_PI / 2) * Matrix_Scale(2.5f, 2.5f, 2.3f);
+    AddToDrawList("plane", model, WALL, ROOM1);
+
+    // desenhar parede 4
+    model = Matrix_Translate(-1.0f, 1.3f, -2.5f) * Matrix_Rotate_X(-M_PI / 2) * Matrix_Rotate_Z(M_PI) * Matrix_Scale(2.0f, 2.5f, 2.3f);
+    AddToDrawList("plane", model, WALL, ROOM1);
+
+    // desenhar chao
+    model = Matrix_Translate(0.0f, 0.0f, 0.0f) * Matrix_Scale(2.5f, 1.0f, 2.5f);
+    AddToDrawList("plane", model, FLOOR, ROOM1);
+
+    // desenhar teto1
+    model = Matrix_Translate(0.0f, 3.6f, 0.0f) * Matrix_Scale(2.5f, 1.0f, 2.5f) * Matrix_Rotate_Z(M_PI);
+    AddToDrawList("plane", model, ROOF1, ROOM1);
+
+    // desenhar porta1
+    model = Matrix_Translate(1.85f, 1.0f, -2.5f) * Matrix_Rotate_Y(-M_PI / 2) * Matrix_Scale(0.2f, 0.7f, 0.15f);
+    if (!door1open)
+    {
+        AddToDrawList("door", model, DOOR1, ROOM1);
+    }
+
+    // desenhar parede 5
+    model = Matrix_Translate(2.5f, 1.3f, -5.0f) * Matrix_Rotate_X(-M_PI / 2) * Matrix_Rotate_Z(M_PI / 2) * Matrix_Scale(2.5f, 2.5f, 2.3f);
+    AddToDrawList("plane", model, WALL, ROOM2);
+
+    // desenhar parede 6
+    model = Matrix_Translate(-2.5f, 1.3f, -5.0f) * Matrix_Rotate_X(-M_PI / 2) * Matrix_Rotate_Z(-M_PI / 2) * Matrix_Scale(2.5f, 2.5f, 2.3f);
+    AddToDrawList("plane", model, WALL, ROOM2);
+
+    // desenhar parede 7
+    model = Matrix_Translate(-1.0f, 1.3f, -2.5f) * Matrix_Rotate_X(-M_PI / 2) * Matrix_Scale(2.0f, 2.5f, 2.3f);
+    AddToDrawList("plane", model, WALL, ROOM2);
+
+    // desenhar parede 8
+    model = Matrix_Translate(1.35f, 1.3f, -7.5f) * Matrix_Rotate_X(-M_PI / 2) * Matrix_Rotate_Z(M_PI) * Matrix_Scale(2.0f, 2.5f, 2.3f);
+    AddToDrawList("plane", model, WALL, ROOM2);
+
+    // desenhar chao2
+    model = Matrix_Translate(0.0f, 0.0f, -5.0f) * Matrix_Scale(2.5f, 1.0f, 2.5f);
+    AddToDrawList("plane", model, FLOOR2, ROOM2);
+
+    // desenhar teto2
+    model = Matrix_Translate(0.0f, 3.6f, -5.0f) * Matrix_Scale(2.5f, 1.0f, 2.5f) * Matrix_Rotate_Z(M_PI);
+    AddToDrawList("plane", model, ROOF2, ROOM2);
+
+    // desenhar porta2
+    model = Matrix_Translate(-1.5f, 1.0f, -7.5f) * Matrix_Rotate_Y(-M_PI / 2) * Matrix_Scale(0.2f, 0.7f, 0.15f);
+    if (!door2open)
+    {
+        AddToDrawList("door", model, DOOR2, ROOM2);
+    }
+
+    // desenhar parede 9
+    model = Matrix_Translate(2.5f, 1.3f, -10.0f) * Matrix_Rotate_X(-M_PI / 2) * Matrix_Rotate_Z(M_PI / 2) * Matrix_Scale(2.5f, 2.5f, 2.3f);
+    AddToDrawList("plane", model, WALL, ROOM3);
+
+    // desenhar parede 10
+    model = Matrix_Translate(-2.5f, 1.3f, -10.0f) * Matrix_Rotate_X(-M_PI / 2) * Matrix_Rotate_Z(-M_PI / 2) * Matrix_Scale(2.5f, 2.5f, 2.3f);
+    AddToDrawList("plane", model, WALL, ROOM3);
+
+    // desenhar parede 11
+    model = Matrix_Translate(1.35f, 1.3f, -7.5f) * Matrix_Rotate_X(-M_PI / 2) * Matrix_Scale(2.0f, 2.5f, 2.3f);
+    AddToDrawList("plane", model, WALL, ROOM3);
+
+    // desenhar parede 12
+    model = Matrix_Translate(0.0f, 1.3f, -12.5f) * Matrix_Rotate_X(-M_PI / 2) * Matrix_Rotate_Z(M_PI) * Matrix_Scale(2.5f, 2.5f, 2.3f);
+    AddToDrawList("plane", model, WALL, ROOM3);
+
+    // desenhar chao3
+    model = Matrix_Translate(0.0f, 0.0f, -10.0f) * Matrix_Scale(2.5f, 1.0f, 2.5f);
+    AddToDrawList("plane", model, FLOOR2, ROOM3);
+
+    // desenhar teto3
+    model = Matrix_Translate(0.0f, 3.6f, -10.0f) * Matrix_Scale(2.5f, 1.0f, 2.5f) * Matrix_Rotate_Z(M_PI);
+    AddToDrawList("plane", model, ROOF3, ROOM3);
+
+    // desenhar map
+    model = Matrix_Translate(-2.4f, 1.3f, 0.0f) * Matrix_Rotate_X(-M_PI / 2) * Matrix_Rotate_Z(-M_PI / 2) * Matrix_Rotate_Y(M_PI) * Matrix_Scale(2.2f, 1.0f, 1.0f);
+    AddToDrawList("plane", model, MAP, ROOM1);
+
+    // desenhar lever1
+    model = Matrix_Translate(-2.4f, 1.9f, 1.3f) * Matrix_Rotate_Z(-M_PI / 2) * Matrix_Scale(0.075f, 0.075f, 0.075f);
+    if (lever1act)
+    {
+        model = model * Matrix_Rotate_Y(M_PI);
+    }
+    AddToDrawList("lever", model, LEVER1, ROOM1);
+
+    // desenhar lever2
+    model = Matrix_Translate(-2.4f, 1.0f, -1.70f) * Matrix_Rotate_Z(-M_PI / 2) * Matrix_Scale(0.075f, 0.075f, 0.075f);
+    if (lever2act)
+    {
+        model = model * Matrix_Rotate_Y(M_PI);
+    }
+    AddToDrawList("lever", model, LEVER2, ROOM1);
+
+    // desenhar lever3
+    model = Matrix_Translate(-2.4f, 1.95f, -1.0f) * Matrix_Rotate_Z(-M_PI / 2) * Matrix_Scale(0.075f, 0.075f, 0.075f);
+    if (lever3act)
+    {
+        model = model * Matrix_Rotate_Y(M_PI);
+    }
+    AddToDrawList("lever", model, LEVER3, ROOM1);
+
+    // desenhar lever4
+    model = Matrix_Translate(-2.4f, 1.5f, -0.95f) * Matrix_Rotate_Z(-M_PI / 2) * Matrix_Scale(0.075f, 0.075f, 0.075f);
+    if (lever4act)
+    {
+        model = model * Matrix_Rotate_Y(M_PI);
+    }
+    AddToDrawList("lever", model, LEVER4, ROOM1);
+
+    // desenhar lever5
+    model = Matrix_Translate(-2.4f, 1.2f, 0.55f) * Matrix_Rotate_Z(-M_PI / 2) * Matrix_Scale(0.075f, 0.075f, 0.075f);
+    if (lever5act)
+    {
+        model = model * Matrix_Rotate_Y(M_PI);
+    }
+    AddToDrawList("lever", model, LEVER5, ROOM1);
+
+    // desenhar 6
+    model = Matrix_Translate(-2.4f, 1.5f, -0.5f) * Matrix_Rotate_Z(-M_PI / 2) * Matrix_Scale(0.075f, 0.075f, 0.075f);
+    if (lever6act)
+    {
+        model = model * Matrix_Rotate_Y(M_PI);
+    }
+    AddToDrawList("lever", model, LEVER6, ROOM1);
+
+    // desenhar lever7
+    model = Matrix_Translate(-2.4f, 1.8f, -0.2f) * Matrix_Rotate_Z(-M_PI / 2) * Matrix_Scale(0.075f, 0.075f, 0.075f);
+    if (lever7act)
+    {
+        model = model * Matrix_Rotate_Y(M_PI);
+    }
+    AddToDrawList("lever", model, LEVER7, ROOM1);
+
+    // desenhar TIPBOARD1
+    model = Matrix_Translate(0.0f, 1.3f, 2.49f) * Matrix_Rotate_X(M_PI / 2) * Matrix_Rotate_Z(M_PI) * Matrix_Scale(1.0f, 1.0f, 1.0f);
+    AddToDrawList("plane", model, TIPBOARD1, ROOM1);
+
+    // desenhar WOODTABLE
+    model = Matrix_Translate(-1.0f, 0.3f, -4.0f) * Matrix_Scale(0.175f, 0.175f, 0.175f) * Matrix_Rotate_Y(M_PI / 2);
+    AddToDrawList("woodTable", model, WOODTABLE, ROOM2);
+
+    // desenhar WOODTABLE2 mesa em baixo do globo
+    model = Matrix_Translate(0.0f, 0.2f, -2.4f) * Matrix_Scale(0.1f, 0.1f, 0.1f) * Matrix_Rotate_Y(M_PI / 2);
+    AddToDrawList("woodTable", model, WOODTABLE, ROOM1);
+
+    // desenhar WOODCHAIR
+    model = Matrix_Translate(-1.0f, 0.0f, -4.0f) * Matrix_Scale(0.135f, 0.135f, 0.135f) * Matrix_Rotate_Y(woodenChairRotation * -M_PI / 2);
+    AddToDrawList("woodChair", model, WOODCHAIR, ROOM2);
+
+    // desenhar WOODZ1
+    model = Matrix_Translate(-2.4f, 1.8f, -5.2f) * Matrix_Scale(1.0f, 1.0f, 1.0f) * Matrix_Rotate_X(woodenZ1Rotation * M_PI / 5);
+    AddToDrawList("woodZ", model, WOODZ1, ROOM2);
+
+    // desenhar WOODZ2
+    model = Matrix_Translate(-2.4f, 1.5f, -5.4f) * Matrix_Scale(1.0f, 1.0f, 1.0f) * Matrix_Rotate_X(woodenZ2Rotation * M_PI / 5);
+    AddToDrawList("woodZ", model, WOODZ2, ROOM2);
+
+    // desenhar WOODZ3
+    model = Matrix_Translate(-2.4f, 1.8f, -5.6f) * Matrix_Scale(1.0f, 1.0f, 1.0f) * Matrix_Rotate_X(woodenZ3Rotation * M_PI / 5);
+    AddToDrawList("woodZ", model, WOODZ3, ROOM2);
+
+    // desenhar TIPBOARD2
+    model = Matrix_Translate(2.49f, 1.3f, -5.0f) * Matrix_Rotate_X(-M_PI / 2) * Matrix_Rotate_Z(M_PI / 2) * Matrix_Rotate_Y(M_PI) * Matrix_Scale(1.5f, 0.75f, 0.75f);
+    AddToDrawList("plane", model, TIPBOARD2, ROOM2);
+
+    // desenhar OSCAR
+    model = Matrix_Translate(0.0f, 0.0f, -12.0f) * Matrix_Scale(2.5f, 2.5f, 2.5f);
+    AddToDrawList("oscar", model, OSCAR, ROOM3);
+
+    // desenhar Spider1
+    model = Matrix_Translate(1.0f, 0.0f, -11.5f) * Matrix_Scale(0.50f, 0.50f, 0.50f) * Matrix_Rotate_Y(-M_PI / 5);
+    AddToDrawList("spider", model, SPIDER1, ROOM3);
+
+    // desenhar Spider2
+    model = Matrix_Translate(-1.0f, 0.0f, -11.5f) * Matrix_Scale(0.50f, 0.50f, 0.50f) * Matrix_Rotate_Y(M_PI / 5);
+    AddToDrawList("spider", model, SPIDER2, ROOM3);
+
+    // desenhar TROPHY
+    model = Matrix_Translate(0.0f, 0.0f, -11.0f) * Matrix_Scale(0.25f, 0.25f, 0.25f) * Matrix_Rotate_Y(M_PI / 2);
+    AddToDrawList("trophy", model, TROPHY, ROOM3);
+
+    packet.view = view;
+    packet.projection = projection;
+    packet.camera_position = Matrix_Inverse(view)[3];
+
+    packet.end_game = endGame;
+
+    packet.projection_text = g_UsePerspectiveProjection ? "Perspective" : "Orthographic";
+
+    packet.culling.frustum = g_FrustumCulling;
+    packet.culling.portals = g_PortalCulling;
+    packet.culling.software_occlusion = g_SoftwareOcclusion;
+    packet.culling.show_occlusion_buffer = g_ShowOcclusionBuffer;
+}
+
+// Termina o pacote montado por BuildFramePacket(): o culling da lista de
+// desenho, as variáveis uniform derivadas e os textos da interface. Chamada
+// pela mesma thread, após liberar g_SimulationMutex.
+void FinishFramePacket(FramePacket &packet)
+{
+    PROFILE_FUNCTION();
+
+    // Variáveis uniform derivadas são calculadas na CPU, ao invés de uma vez
+    // por vértice ou fragmento nos shaders: a posição da câmera uma vez por
+    // quadro (veja BuildFramePacket()), e a matriz das normais uma vez por
+    // objeto que sobreviveu ao culling.
+    CullDrawList(packet.view, packet.projection, packet.camera_position, packet.culling);
+    ComputeDerivedUniforms();
+
+    // Objetos animados visíveis exigem o redesenho contínuo da cena (veja
+    // SceneNeedsRedraw()); ocultos pelo culling, a cena pode ficar parada.
+    // Somente a thread que produz os pacotes lê esta variável.
+    g_AnimatedObjectVisible = false;
+    for (size_t i = 0; i < g_DrawList.size(); ++i)
+        if (g_DrawList[i].object_id == SPHERE || g_DrawList[i].object_id == TIPSPHERE)
+            g_AnimatedObjectVisible = true;
+
+    // A lista é trocada com a do pacote, e ambas mantêm a sua memória entre quadros.
+    packet.draw_list.swap(g_DrawList);
+    g_DrawList.clear();
+
+    // Objetos visíveis e descartados pelo culling, e salas visíveis através das
+    // portas (veja CullDrawList()). [F] indica frustum culling ligado, [P]
+    // culling por portais ligado.
+    char buffer[80];
+    snprintf(buffer, 80, "culling [%c%c]: %d visible %d culled %d/%d rooms %.3f ms",
+             packet.culling.frustum ? 'F' : '-', packet.culling.portals ? 'P' : '-',
+             g_CullingStats.visible, g_CullingStats.culled,
+             g_CullingStats.visible_cells, g_CullingStats.num_cells, g_CullingStats.average_ms);
+    packet.culling_text = buffer;
+
+    if (packet.culling.software_occlusion)
+        snprintf(buffer, 80, "sw occlusion: %d tris %d hidden %.3f ms",
+                 g_CullingStats.occluder_triangles, g_CullingStats.occluded, g_CullingStats.software_average_ms);
+    else
+        snprintf(buffer, 80, "sw occlusion: off");
+    packet.software_occlusion_text = buffer;
+
+    // O Z-buffer da oclusão por software é reescrito a cada quadro pela
+    // simulação; a renderização desenha a cópia do pacote.
+    if (packet.culling.software_occlusion && packet.culling.show_occlusion_buffer)
+        SoftwareOcclusion_ReadDebugImage(packet.occlusion_image);
+    else
+        packet.occlusion_image.clear();
+}
+
+void PrintFinalMessage(GLFWwindow *window, std::string text, float scale)
+{
+    // As linhas da última mensagem, e um texto com posicionamento guardado
+    // (veja TextRendering_PrintLayout()) para cada uma. A mensagem só é
+    // dividida novamente quando muda.
+    static std::string cached_text;
+    static std::vector<std::string> lines;
+    static std::vector<int> layouts;
+
+    if (text != cached_text || lines.empty())
+    {
+        cached_text = text;
+        lines.clear();
+
+        std::string::size_type lastTokenPos = 0;
+        std::string::size_type nextTokenPos = 0;
+        while (nextTokenPos != std::string::npos)
+        {
+            lastTokenPos = nextTokenPos;
+            nextTokenPos = text.find_first_of("\n", lastTokenPos + 1);
+
+            lines.push_back(text.substr(lastTokenPos, nextTokenPos - lastTokenPos));
+        }
+
+        while (layouts.size() < lines.size())
+            layouts.push_back(TextRendering_NewLayout());
+    }
+
+    float pad = TextRendering_LineHeight(window) * scale;
+    float charWidth = TextRendering_CharWidth(window) * scale;
+
+    int totalLines = lines.size();
+    for (int currLine = 0; currLine < totalLines; ++currLine)
+    {
+        const std::string &line = lines[totalLines - 1 - currLine];
+        TextRendering_PrintLayout(window, layouts[currLine], line, line.size() * 0.5 * charWidth * -1, currLine * pad - totalLines * 0.5 * pad, scale);
+    }
+}
+
+// Cria um amostrador de textura com filtragem trilinear, e com "wrap_s" na
+// direção S e GL_CLAMP_TO_EDGE na direção T.
+static GLuint CreateTextureSampler(GLint wrap_s)
+{
+    GLuint sampler_id;
+    glGenSamplers(1, &sampler_id);
+
+    glSamplerParameteri(sampler_id, GL_TEXTURE_WRAP_S, wrap_s);
+    glSamplerParameteri(sampler_id, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glSamplerParameteri(sampler_id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glSamplerParameteri(sampler_id, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    return sampler_id;
+}
+
+// Função que carrega uma imagem para ser utilizada como textura
+void LoadTextureImage(const char *filename)
+{
+    PROFILE_FUNCTION();
+    printf("Carregando imagem \"%s\"... ", filename);
+
+    // Primeiro fazemos a leitura da imagem do disco
+    stbi_set_flip_vertically_on_load(true);
+    int width;
+    int height;
+    int channels;
+    unsigned char *data = stbi_load(filename, &width, &height, &channels, 3);
+
+    if (data == NULL)
+    {
+        fprintf(stderr, "ERROR: Cannot open image file \"%s\".\n", filename);
+        std::exit(EXIT_FAILURE);
+    }
+
+    printf("OK (%dx%d).\n", width, height);
+
+    // Agora criamos objetos na GPU com OpenGL para armazenar a textura. Os
+    // amostradores são compartilhados por todas as texturas.
+    GLuint texture_id;
+    glGenTextures(1, &texture_id);
+
+    if (g_ClampSampler == 0)
+    {
+        g_ClampSampler = CreateTextureSampler(GL_CLAMP_TO_EDGE);
+        g_RepeatSampler = CreateTextureSampler(GL_REPEAT);
+    }
+
+    // Agora enviamos a imagem lida do disco para a GPU
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
     glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
     glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
     glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
 
-    GLuint textureunit = g_NumLoadedTextures;
-    glActiveTexture(GL_TEXTURE0 + textureunit);
-    glBindTexture(GL_TEXTURE_2D, texture_id);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    glBindSampler(textureunit, sampler_id);
+    GLuint textureunit = g_NumLoadedTextures;
+    glActiveTexture(GL_TEXTURE0 + textureunit);
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glBindSampler(textureunit, g_ClampSampler);
+
+    stbi_image_free(data);
+
+    g_NumLoadedTextures += 1;
+}
+
+// Adiciona um objeto de g_VirtualScene à lista de desenho do quadro atual,
+// com sua matriz de modelagem e o identificador do seu material ("object_id"
+// em "shader_fragment.glsl"). Os objetos são efetivamente desenhados por
+// SubmitDrawList().
+void AddToDrawList(const char *object_name, glm::mat4 model, int object_id, int cell)
+{
+    DrawCommand command;
+    command.object_name = object_name;
+    command.object = &g_VirtualScene.at(object_name);
+    command.model = model;
+    command.object_id = object_id;
+    command.material = &g_Materials[g_ObjectMaterials[object_id]];
+    command.cell = cell;
+    g_DrawList.push_back(command);
+}
+
+// Define as salas do nível como células, e as aberturas das portas como
+// portais entre elas (veja "portalculling.cpp"). As salas ocupam
+// x em [-2.5, 2.5] e são empilhadas ao longo do eixo -Z; cada porta é a
+// abertura na parede entre duas salas, com altura igual à das paredes.
+void InitPortalCells()
+{
+    PortalCulling_AddCell(glm::vec3(-2.5f, -1.0f, -2.5f), glm::vec3(2.5f, 3.6f, 2.5f));   // ROOM1
+    PortalCulling_AddCell(glm::vec3(-2.5f, -1.0f, -7.5f), glm::vec3(2.5f, 3.6f, -2.5f));  // ROOM2
+    PortalCulling_AddCell(glm::vec3(-2.5f, -1.0f, -12.5f), glm::vec3(2.5f, 3.6f, -7.5f)); // ROOM3
+
+    // Abertura da porta 1: entre o fim da parede 4 (x = 1.0) e a parede 1.
+    glm::vec3 door1[4] = {
+        glm::vec3(1.0f, 0.0f, -2.5f),
+        glm::vec3(2.5f, 0.0f, -2.5f),
+        glm::vec3(2.5f, 3.6f, -2.5f),
+        glm::vec3(1.0f, 3.6f, -2.5f)};
+    g_Door1Portal = PortalCulling_AddPortal(ROOM1, ROOM2, door1, 4);
+
+    // Abertura da porta 2: entre a parede 6 e o início da parede 8 (x = -0.65).
+    glm::vec3 door2[4] = {
+        glm::vec3(-2.5f, 0.0f, -7.5f),
+        glm::vec3(-0.65f, 0.0f, -7.5f),
+        glm::vec3(-0.65f, 3.6f, -7.5f),
+        glm::vec3(-2.5f, 3.6f, -7.5f)};
+    g_Door2Portal = PortalCulling_AddPortal(ROOM2, ROOM3, door2, 4);
+}
+
+// Retorna true para as malhas utilizadas como oclusores na oclusão por
+// software: superfícies grandes e opacas (paredes, chão, teto e portas).
+bool IsOccluderMesh(const std::string &name)
+{
+    return name == "plane" || name == "door";
+}
+
+// Desenha todos os objetos da lista de desenho do pacote, já reduzida pelo
+// culling (veja FinishFramePacket()), utilizando o backend de submissão
+// selecionado em g_DrawBackend. O tempo de CPU gasto aqui (essencialmente o
+// custo das chamadas ao driver OpenGL) é acumulado em g_DrawStats para
+// comparação entre os backends.
+void SubmitDrawList(const FramePacket &packet)
+{
+    PROFILE_FUNCTION();
+
+    DrawStats &stats = g_DrawStats[g_DrawBackend];
+    stats.draw_calls = 0;
+    stats.triangles = 0;
+
+    const glm::mat4 &view = packet.view;
+    const glm::mat4 &projection = packet.projection;
+    g_DrawCameraPosition = packet.camera_position;
+
+    double start_seconds = GetTimeSeconds();
+
+    // Objetos pesados são retirados da lista e desenhados por último, com
+    // consultas de oclusão, após os demais objetos preencherem o Z-buffer.
+    g_SubmitList.clear();
+    for (size_t i = 0; i < packet.draw_list.size(); ++i)
+    {
+        if (g_OcclusionQueries && IsOcclusionCandidate(packet.draw_list[i]))
+            g_OcclusionList.push_back(packet.draw_list[i]);
+        else
+            g_SubmitList.push_back(packet.draw_list[i]);
+    }
+
+    // Passada de profundidade: a lista é desenhada somente no Z-buffer, e a
+    // passada principal sombreia apenas os fragmentos visíveis (GL_EQUAL),
+    // evitando executar o Fragment Shader completo em superfícies ocultas.
+    if (g_DepthPrepass)
+    {
+        GpuTimer_Begin(GPU_PASS_PREPASS);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        if (g_DrawBackend == DRAW_BACKEND_MULTI_DRAW)
+            SubmitDrawList_MultiDraw(view, projection, DRAW_PASS_DEPTH, stats);
+        else
+            SubmitDrawList_PerObject(view, projection, DRAW_PASS_DEPTH, stats);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        GpuTimer_End(GPU_PASS_PREPASS);
+
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+    }
+
+    GpuTimer_Begin(GPU_PASS_SCENE);
+    if (g_DrawBackend == DRAW_BACKEND_MULTI_DRAW)
+        SubmitDrawList_MultiDraw(view, projection, DRAW_PASS_COLOR, stats);
+    else
+        SubmitDrawList_PerObject(view, projection, DRAW_PASS_COLOR, stats);
+
+    if (g_DepthPrepass)
+    {
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+    }
+
+    if (g_OcclusionQueries)
+        SubmitOcclusionList(view, projection, stats);
+    GpuTimer_End(GPU_PASS_SCENE);
+
+    AccumulateFrameTime(stats.cpu, GetTimeSeconds() - start_seconds);
+}
+
+// Calcula as variáveis uniform derivadas da matriz de modelagem de cada objeto
+// da lista de desenho: a matriz das normais, transposta da inversa de "model",
+// antes calculada no Vertex Shader para cada vértice. Veja Matrix_Normal().
+void ComputeDerivedUniforms()
+{
+    for (size_t i = 0; i < g_DrawList.size(); ++i)
+        g_DrawList[i].normal_matrix = Matrix_Normal(g_DrawList[i].model);
+}
+
+// Remove da lista de desenho os objetos que não podem estar visíveis: os
+// objetos de salas não alcançáveis pela câmera através das portas abertas
+// (veja "portalculling.cpp" e InitPortalCells()), e os objetos cuja bounding
+// box, transformada pela sua matriz de modelagem, está inteiramente fora do
+// frustum da sua sala, reduzido pelas portas através das quais a mesma é vista
+// (veja "frustumculling.cpp"). A ordem dos objetos restantes é preservada.
+void CullDrawList(glm::mat4 view, glm::mat4 projection, glm::vec4 camera_position, const CullingOptions &options)
+{
+    PROFILE_FUNCTION();
+
+    static std::vector<size_t> order;
+    static std::vector<size_t> cell_first;
+    static std::vector<glm::mat4> models;
+    static std::vector<glm::vec3> bbox_min;
+    static std::vector<glm::vec3> bbox_max;
+    static std::vector<unsigned char> visible;
+    static std::vector<unsigned char> keep;
+    static std::vector<unsigned char> visible_cells;
+    static std::vector<glm::vec4> cell_planes;
+    static FrameTimeStats culling_time;
+    static FrameTimeStats software_time;
+
+    size_t count = g_DrawList.size();
+    size_t num_cells = PortalCulling_NumCells();
+
+    double start_seconds = GetTimeSeconds();
+
+    glm::mat4 clip = projection * view;
+
+    // Salas visíveis e o frustum de cada uma delas. Sem o culling por portais,
+    // todas as salas são vistas pelo frustum completo da câmera.
+    visible_cells.resize(num_cells);
+    cell_planes.resize(6 * num_cells);
+    if (options.portals)
+    {
+        g_CullingStats.visible_cells = PortalCulling_ComputeVisibleCells(glm::vec3(camera_position), clip, visible_cells.data(), cell_planes.data());
+    }
+    else
+    {
+        glm::vec4 planes[6];
+        FrustumCulling_ExtractPlanes(clip, planes);
+        for (size_t c = 0; c < num_cells; ++c)
+        {
+            visible_cells[c] = 1;
+            std::copy(planes, planes + 6, &cell_planes[6 * c]);
+        }
+        g_CullingStats.visible_cells = (int)num_cells;
+    }
+    g_CullingStats.num_cells = (int)num_cells;
+
+    // Agrupamos os objetos por sala (counting sort), de forma que os objetos
+    // de cada sala sejam testados em lote contra o frustum da mesma.
+    cell_first.assign(num_cells + 1, 0);
+    for (size_t i = 0; i < count; ++i)
+        cell_first[g_DrawList[i].cell + 1] += 1;
+    for (size_t c = 0; c < num_cells; ++c)
+        cell_first[c + 1] += cell_first[c];
+
+    order.resize(count);
+    models.resize(count);
+    bbox_min.resize(count);
+    bbox_max.resize(count);
+    visible.resize(count);
+    keep.resize(count);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t k = cell_first[g_DrawList[i].cell]++;
+        order[k] = i;
+        models[k] = g_DrawList[i].model;
+        bbox_min[k] = g_DrawList[i].object->bbox_min;
+        bbox_max[k] = g_DrawList[i].object->bbox_max;
+    }
+
+    // Após o laço acima, cell_first[c] aponta para o fim do grupo da sala c.
+    size_t first = 0;
+    for (size_t c = 0; c < num_cells; ++c)
+    {
+        size_t last = cell_first[c];
+        if (!visible_cells[c])
+            std::fill(visible.begin() + first, visible.begin() + last, 0);
+        else if (options.frustum)
+            FrustumCulling_TestBoxes(&cell_planes[6 * c], &models[first], &bbox_min[first], &bbox_max[first], last - first, &visible[first]);
+        else
+            std::fill(visible.begin() + first, visible.begin() + last, 1);
+        first = last;
+    }
+
+    for (size_t k = 0; k < count; ++k)
+        keep[order[k]] = visible[k];
+
+    size_t num_visible = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (keep[i])
+            g_DrawList[num_visible++] = g_DrawList[i];
+    }
+    g_DrawList.resize(num_visible);
+
+    // Oclusão por software: os oclusores restantes são rasterizados, e os
+    // demais objetos são testados contra o Z-buffer resultante.
+    g_CullingStats.occluded = 0;
+    g_CullingStats.occluder_triangles = 0;
+    double software_seconds = 0.0;
+    if (options.software_occlusion)
+    {
+        double software_start_seconds = GetTimeSeconds();
+
+        SoftwareOcclusion_BeginFrame(clip);
+        for (size_t i = 0; i < g_DrawList.size(); ++i)
+        {
+            const std::vector<float> &positions = g_DrawList[i].object->occluder_positions;
+            if (!positions.empty())
+                SoftwareOcclusion_AddOccluder(g_DrawList[i].model, positions.data(), positions.size() / 3);
+        }
+        SoftwareOcclusion_Rasterize();
+
+        size_t last = 0;
+        for (size_t i = 0; i < g_DrawList.size(); ++i)
+        {
+            const DrawCommand &command = g_DrawList[i];
+            if (command.object->occluder_positions.empty() &&
+                !SoftwareOcclusion_TestBox(command.model, command.object->bbox_min, command.object->bbox_max))
+                continue;
+            g_DrawList[last++] = command;
+        }
+        g_CullingStats.occluded = (int)(g_DrawList.size() - last);
+        g_CullingStats.occluder_triangles = (int)SoftwareOcclusion_NumTriangles();
+        g_DrawList.resize(last);
+        num_visible = last;
+
+        software_seconds = GetTimeSeconds() - software_start_seconds;
+    }
+
+    g_CullingStats.visible = (int)num_visible;
+    g_CullingStats.culled = (int)(count - num_visible);
+
+    // A média da oclusão por software inclui os quadros sem a mesma.
+    AccumulateFrameTime(culling_time, GetTimeSeconds() - start_seconds);
+    AccumulateFrameTime(software_time, software_seconds);
+    g_CullingStats.average_ms = culling_time.average_ms;
+    g_CullingStats.software_average_ms = software_time.average_ms;
+}
+
+// Ordem dos objetos no desenho por objeto: objetos que utilizam a mesma
+// variante dos shaders, e dentro dela o mesmo material, ficam contíguos.
+static bool DrawCommandMaterialOrder(const DrawCommand *a, const DrawCommand *b)
+{
+    if (a->material->variant != b->material->variant)
+        return a->material->variant < b->material->variant;
+    return a->material < b->material;
+}
+
+// Backend de submissão original: uma chamada de desenho por objeto, precedida
+// do envio de "model" e da AABB do objeto como variáveis uniform. Os objetos
+// são agrupados por material, e cada grupo utiliza o programa especializado
+// do seu material (veja BindMaterial()).
+void SubmitDrawList_PerObject(glm::mat4 view, glm::mat4 projection, DrawPass pass, DrawStats &stats)
+{
+    // Na passada de profundidade não há material: somente a matriz "model" é
+    // enviada, e os objetos são desenhados diretamente do VAO da arena.
+    if (pass == DRAW_PASS_DEPTH)
+    {
+        glUseProgram(program_depth_id);
+        glUniformMatrix4fv(depth_view_uniform, 1, GL_FALSE, glm::value_ptr(view));
+        glUniformMatrix4fv(depth_projection_uniform, 1, GL_FALSE, glm::value_ptr(projection));
+        glBindVertexArray(MeshArena_VertexArrayObject());
+
+        for (size_t i = 0; i < g_SubmitList.size(); ++i)
+        {
+            const DrawCommand &command = g_SubmitList[i];
+            const SceneObject &object = *command.object;
+
+            glUniformMatrix4fv(depth_model_uniform, 1, GL_FALSE, glm::value_ptr(command.model));
+            glDrawElementsBaseVertex(object.rendering_mode, object.num_indices, GL_UNSIGNED_INT,
+                                     (void *)(object.first_index * sizeof(GLuint)), object.base_vertex);
+
+            stats.draw_calls += 1;
+            stats.triangles += object.num_indices / 3;
+        }
+
+        glBindVertexArray(0);
+        return;
+    }
+
+    static std::vector<const DrawCommand *> sorted;
+    sorted.resize(g_SubmitList.size());
+    for (size_t i = 0; i < g_SubmitList.size(); ++i)
+        sorted[i] = &g_SubmitList[i];
+    std::stable_sort(sorted.begin(), sorted.end(), DrawCommandMaterialOrder);
+
+    MaterialBinding binding = {NULL, NULL};
+    glBindVertexArray(MeshArena_VertexArrayObject());
+
+    for (size_t i = 0; i < sorted.size(); ++i)
+    {
+        const DrawCommand &command = *sorted[i];
+        const SceneObject &object = *command.object;
+
+        // As matrizes "view" e "projection" são enviadas por BindMaterial()
+        // sempre que o programa de GPU é trocado.
+        const VariantProgram *program = BindMaterial(command.material, false, view, projection, binding);
+
+        glUniformMatrix4fv(program->model_uniform, 1, GL_FALSE, glm::value_ptr(command.model));
+        glUniformMatrix4fv(program->normal_matrix_uniform, 1, GL_FALSE, glm::value_ptr(command.normal_matrix));
+        glDrawElementsBaseVertex(object.rendering_mode, object.num_indices, GL_UNSIGNED_INT,
+                                 (void *)(object.first_index * sizeof(GLuint)), object.base_vertex);
+
+        stats.draw_calls += 1;
+        stats.triangles += object.num_indices / 3;
+    }
+
+    glBindVertexArray(0);
+}
+
+// Ordem dos objetos na submissão em lote: objetos com o mesmo modo de
+// rasterização e o mesmo material formam um lote, e dentro do lote objetos
+// que compartilham a mesma malha ficam contíguos.
+static bool DrawCommandBatchOrder(const DrawCommand *a, const DrawCommand *b)
+{
+    if (a->object->rendering_mode != b->object->rendering_mode)
+        return a->object->rendering_mode < b->object->rendering_mode;
+    if (a->material != b->material)
+        return DrawCommandMaterialOrder(a, b);
+    return a->object < b->object;
+}
+
+// Backend de submissão em lote. Como todas as malhas estão na arena de malhas
+// (mesmo VAO e mesmo formato de vértices), todos os objetos de um mesmo
+// material compartilham o mesmo estado OpenGL. Os parâmetros de cada objeto
+// (matrizes "model" e das normais) são escritos em um "texture buffer" e cada
+// lote é desenhado com uma única chamada glMultiDrawElementsBaseVertex(), onde
+// o Vertex Shader identifica o objeto através de gl_DrawIDARB.
+//
+// Caso o driver não suporte GL_ARB_shader_draw_parameters, o identificador é
+// emulado com instancing: cada sequência de objetos de mesma malha é desenhada
+// com glDrawElementsInstancedBaseVertex(), e o objeto é identificado por
+// "draw_offset + gl_InstanceID". Veja "shader_vertex.glsl".
+void SubmitDrawList_MultiDraw(glm::mat4 view, glm::mat4 projection, DrawPass pass, DrawStats &stats)
+{
+    // Vetores estáticos mantém sua memória entre quadros, evitando alocações.
+    static std::vector<const DrawCommand *> sorted;
+    static std::vector<float> draw_data;
+    static std::vector<GLsizei> counts;
+    static std::vector<const void *> offsets;
+    static std::vector<GLint> base_vertices;
+
+    size_t num_draws = g_SubmitList.size();
+    if (num_draws == 0)
+        return;
+
+    sorted.resize(num_draws);
+    for (size_t i = 0; i < num_draws; ++i)
+        sorted[i] = &g_SubmitList[i];
+    std::stable_sort(sorted.begin(), sorted.end(), DrawCommandBatchOrder);
+
+    // Escrevemos os parâmetros de cada objeto, na ordem de submissão, com
+    // DRAW_DATA_TEXELS texels RGBA por objeto. Veja "shader_vertex.glsl".
+    // Com a passada de profundidade ligada, os dados enviados por ela servem
+    // também para a passada principal, pois a ordem dos objetos é a mesma.
+    bool upload_draw_data = (pass == DRAW_PASS_DEPTH || !g_DepthPrepass);
+    draw_data.resize(upload_draw_data ? num_draws * DRAW_DATA_TEXELS * 4 : 0);
+    for (size_t i = 0; upload_draw_data && i < num_draws; ++i)
+    {
+        const DrawCommand &command = *sorted[i];
+        float *texels = &draw_data[i * DRAW_DATA_TEXELS * 4];
+
+        const float *model = glm::value_ptr(command.model);
+        std::copy(model, model + 16, texels);
+
+        const float *normal_matrix = glm::value_ptr(command.normal_matrix);
+        std::copy(normal_matrix, normal_matrix + 16, texels + 16);
+    }
+
+    // "Orfanamos" o buffer antes de escrever nele, para que o driver não
+    // precise esperar a GPU terminar de ler os dados do quadro anterior.
+    if (upload_draw_data)
+    {
+        glBindBuffer(GL_TEXTURE_BUFFER, g_DrawDataBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, draw_data.size() * sizeof(float), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, draw_data.size() * sizeof(float), draw_data.data());
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    glActiveTexture(GL_TEXTURE0 + DRAW_DATA_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, g_DrawDataTexture);
+
+    // A passada de profundidade não tem material: um único programa desenha
+    // todos os objetos, e os lotes são separados somente pelo modo de
+    // rasterização. Na passada principal cada material forma um lote.
+    GLint draw_offset_uniform = multidraw_depth_draw_offset_uniform;
+    MaterialBinding binding = {NULL, NULL};
+    if (pass == DRAW_PASS_DEPTH)
+    {
+        glUseProgram(program_multidraw_depth_id);
+        glUniformMatrix4fv(multidraw_depth_view_uniform, 1, GL_FALSE, glm::value_ptr(view));
+        glUniformMatrix4fv(multidraw_depth_projection_uniform, 1, GL_FALSE, glm::value_ptr(projection));
+    }
+
+    glBindVertexArray(MeshArena_VertexArrayObject());
+
+    size_t batch_begin = 0;
+    while (batch_begin < num_draws)
+    {
+        GLenum mode = sorted[batch_begin]->object->rendering_mode;
+        const Material *material = sorted[batch_begin]->material;
+
+        size_t batch_end = batch_begin + 1;
+        while (batch_end < num_draws && sorted[batch_end]->object->rendering_mode == mode &&
+               (pass == DRAW_PASS_DEPTH || sorted[batch_end]->material == material))
+            ++batch_end;
+
+        if (pass == DRAW_PASS_COLOR)
+            draw_offset_uniform = BindMaterial(material, true, view, projection, binding)->draw_offset_uniform;
+
+        if (g_HasShaderDrawParameters)
+        {
+            counts.clear();
+            offsets.clear();
+            base_vertices.clear();
+            for (size_t i = batch_begin; i < batch_end; ++i)
+            {
+                const SceneObject *object = sorted[i]->object;
+                counts.push_back(object->num_indices);
+                offsets.push_back((const void *)(object->first_index * sizeof(GLuint)));
+                base_vertices.push_back(object->base_vertex);
+                stats.triangles += object->num_indices / 3;
+            }
+
+            glUniform1i(draw_offset_uniform, batch_begin);
+            glMultiDrawElementsBaseVertex(mode, counts.data(), GL_UNSIGNED_INT, offsets.data(), counts.size(), base_vertices.data());
+            stats.draw_calls += 1;
+        }
+        else
+        {
+            size_t run_begin = batch_begin;
+            while (run_begin < batch_end)
+            {
+                const SceneObject *object = sorted[run_begin]->object;
+
+                size_t run_end = run_begin + 1;
+                while (run_end < batch_end && sorted[run_end]->object == object)
+                    ++run_end;
+
+                glUniform1i(draw_offset_uniform, run_begin);
+                glDrawElementsInstancedBaseVertex(
+                    mode,
+                    object->num_indices,
+                    GL_UNSIGNED_INT,
+                    (void *)(object->first_index * sizeof(GLuint)),
+                    run_end - run_begin,
+                    object->base_vertex);
+                stats.draw_calls += 1;
+                stats.triangles += (run_end - run_begin) * (object->num_indices / 3);
+
+                run_begin = run_end;
+            }
+        }
+
+        batch_begin = batch_end;
+    }
 
-    stbi_image_free(data);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
 
-    g_NumLoadedTextures += 1;
+// Cria o "texture buffer" com os parâmetros de cada objeto utilizado por
+// SubmitDrawList_MultiDraw().
+void InitMultiDraw()
+{
+    glGenBuffers(1, &g_DrawDataBuffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, g_DrawDataBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, DRAW_DATA_TEXELS * 4 * sizeof(float), NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    glGenTextures(1, &g_DrawDataTexture);
+    glActiveTexture(GL_TEXTURE0 + DRAW_DATA_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, g_DrawDataTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, g_DrawDataBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+    g_HasShaderDrawParameters = HasOpenGLExtension("GL_ARB_shader_draw_parameters");
+    printf("Submissão em lote: %s\n", g_HasShaderDrawParameters
+                                          ? "glMultiDrawElementsBaseVertex (GL_ARB_shader_draw_parameters)"
+                                          : "glDrawElementsInstancedBaseVertex (emulação de gl_DrawID)");
+}
+
+// Verifica se o driver OpenGL suporta a extensão "name".
+bool HasOpenGLExtension(const char *name)
+{
+    GLint num_extensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &num_extensions);
+    for (GLint i = 0; i < num_extensions; ++i)
+    {
+        const char *extension = (const char *)glGetStringi(GL_EXTENSIONS, i);
+        if (extension != NULL && strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+// Cria a malha da caixa utilizada como "proxy" nas consultas de oclusão: o
+// cubo unitário [0,1]^3, adicionado à arena de malhas e a g_VirtualScene com
+// o nome "occlusion_box". Veja SubmitOcclusionList().
+void InitOcclusionQueries()
+{
+    const float positions[8][3] = {
+        {0.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 0.0f}, {0.0f, 1.0f, 0.0f},
+        {0.0f, 0.0f, 1.0f}, {1.0f, 0.0f, 1.0f}, {1.0f, 1.0f, 1.0f}, {0.0f, 1.0f, 1.0f}};
+    const GLuint indices[36] = {
+        0, 2, 1, 0, 3, 2, // z = 0
+        4, 5, 6, 4, 6, 7, // z = 1
+        0, 4, 7, 0, 7, 3, // x = 0
+        1, 2, 6, 1, 6, 5, // x = 1
+        0, 1, 5, 0, 5, 4, // y = 0
+        3, 7, 6, 3, 6, 2  // y = 1
+    };
+
+    // Somente a posição é utilizada; normais e coordenadas de textura são nulas.
+    std::vector<float> vertex_coefficients;
+    for (int i = 0; i < 8; ++i)
+    {
+        vertex_coefficients.push_back(positions[i][0]); // X
+        vertex_coefficients.push_back(positions[i][1]); // Y
+        vertex_coefficients.push_back(positions[i][2]); // Z
+        vertex_coefficients.push_back(1.0f);            // W
+        vertex_coefficients.insert(vertex_coefficients.end(), 6, 0.0f);
+    }
+
+    size_t first_vertex = MeshArena_AllocVertices(8);
+    size_t first_index = MeshArena_AllocIndices(36);
+    MeshArena_UploadVertices(first_vertex, 8, vertex_coefficients.data());
+    MeshArena_UploadIndices(first_index, 36, indices);
+
+    SceneObject box;
+    box.name = "occlusion_box";
+    box.first_index = first_index;
+    box.num_indices = 36;
+    box.base_vertex = (GLint)first_vertex;
+    box.rendering_mode = GL_TRIANGLES;
+    box.vertex_array_object_id = MeshArena_VertexArrayObject();
+    box.bbox_min = glm::vec3(0.0f, 0.0f, 0.0f);
+    box.bbox_max = glm::vec3(1.0f, 1.0f, 1.0f);
+    g_VirtualScene[box.name] = box;
 }
 
-// Função que desenha um objeto armazenado em g_VirtualScene. Veja definição
-// dos objetos na função BuildTrianglesAndAddToVirtualScene().
-void DrawVirtualObject(const char *object_name)
-{
-    // "Ligamos" o VAO. Informamos que queremos utilizar os atributos de
-    // vértices apontados pelo VAO criado pela função BuildTrianglesAndAddToVirtualScene(). Veja
-    // comentários detalhados dentro da definição de BuildTrianglesAndAddToVirtualScene().
-    glBindVertexArray(g_VirtualScene[object_name].vertex_array_object_id);
-
-    // Setamos as variáveis "bbox_min" e "bbox_max" do fragment shader
-    // com os parâmetros da axis-aligned bounding box (AABB) do modelo.
-    glm::vec3 bbox_min = g_VirtualScene[object_name].bbox_min;
-    glm::vec3 bbox_max = g_VirtualScene[object_name].bbox_max;
-    glUniform4f(bbox_min_uniform, bbox_min.x, bbox_min.y, bbox_min.z, 1.0f);
-    glUniform4f(bbox_max_uniform, bbox_max.x, bbox_max.y, bbox_max.z, 1.0f);
-
-    // Pedimos para a GPU rasterizar os vértices dos eixos XYZ
-    // apontados pelo VAO como linhas. Veja a definição de
-    // g_VirtualScene[""] dentro da função BuildTrianglesAndAddToVirtualScene(), e veja
-    // a documentação da função glDrawElements() em
-    // http://docs.gl/gl3/glDrawElements.
-    glDrawElements(
-        g_VirtualScene[object_name].rendering_mode,
-        g_VirtualScene[object_name].num_indices,
-        GL_UNSIGNED_INT,
-        (void *)(g_VirtualScene[object_name].first_index * sizeof(GLuint)));
-
-    // "Desligamos" o VAO, evitando assim que operações posteriores venham a
-    // alterar o mesmo. Isso evita bugs.
+// Retorna true se o objeto deve passar pelo teste de oclusão por hardware:
+// somente malhas com muitos triângulos, cujo custo de desenho compensa o custo
+// da consulta.
+bool IsOcclusionCandidate(const DrawCommand &command)
+{
+    return command.object->num_indices / 3 >= OCCLUSION_MIN_TRIANGLES;
+}
+
+// Desenha os objetos pesados de g_OcclusionList com consultas de oclusão por
+// hardware. Deve ser chamada após o desenho dos demais objetos (os
+// oclusores), com o Z-buffer já preenchido pelos mesmos.
+//
+// Para cada objeto, a sua bounding box é desenhada (sem escrita de cor e de
+// profundidade) dentro de uma consulta GL_ANY_SAMPLES_PASSED. O resultado é
+// lido pela CPU somente no quadro seguinte, e apenas se já estiver
+// disponível, de forma que a CPU nunca espera pela GPU. Com esse resultado:
+//
+//  - objetos ocultos no quadro anterior não são desenhados; apenas a sua caixa
+//    é testada novamente (um objeto que volta a ficar visível aparece com um
+//    quadro de atraso);
+//  - os demais objetos são desenhados dentro de glBeginConditionalRender() com
+//    a consulta do quadro atual, e a GPU descarta o desenho se a caixa estiver
+//    oculta e o resultado já estiver pronto (GL_QUERY_NO_WAIT);
+//  - objetos visíveis há OCCLUSION_TRUSTED_FRAMES quadros seguidos são
+//    desenhados sem consulta, sendo testados novamente só a cada
+//    OCCLUSION_TRUSTED_FRAMES quadros.
+void SubmitOcclusionList(glm::mat4 view, glm::mat4 projection, DrawStats &stats)
+{
+    static std::vector<OcclusionState *> states;
+    static std::vector<bool> queried;
+
+    g_OcclusionFrame += 1;
+    int slot = g_OcclusionFrame % 2;
+    int previous_slot = 1 - slot;
+
+    g_OcclusionStats.queries = 0;
+    g_OcclusionStats.skipped = 0;
+    g_OcclusionStats.occluded = 0;
+
+    glm::vec3 camera_position = glm::vec3(g_DrawCameraPosition);
+
+    size_t count = g_OcclusionList.size();
+    states.resize(count);
+    queried.resize(count);
+
+    // Leitura dos resultados do quadro anterior e decisão de cada objeto.
+    for (size_t i = 0; i < count; ++i)
+    {
+        const DrawCommand &command = g_OcclusionList[i];
+        OcclusionState &state = g_OcclusionStates[std::make_pair(command.object, command.object_id)];
+        states[i] = &state;
+
+        if (state.queries[0] == 0)
+        {
+            glGenQueries(2, state.queries);
+            state.pending[0] = state.pending[1] = false;
+            state.occluded = false;
+            state.visible_frames = 0;
+        }
+
+        if (state.pending[previous_slot])
+        {
+            GLuint available = 0;
+            glGetQueryObjectuiv(state.queries[previous_slot], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available)
+            {
+                GLuint any_samples_passed = 0;
+                glGetQueryObjectuiv(state.queries[previous_slot], GL_QUERY_RESULT, &any_samples_passed);
+                state.pending[previous_slot] = false;
+                state.occluded = (any_samples_passed == 0);
+                state.visible_frames = state.occluded ? 0 : state.visible_frames + 1;
+
+                g_OcclusionStats.total_results += 1;
+                if (state.occluded)
+                    g_OcclusionStats.total_occluded += 1;
+            }
+        }
+
+        // Uma consulta de dois quadros atrás que ainda não terminou é descartada.
+        state.pending[slot] = false;
+
+        // Câmera dentro (ou muito próxima) da caixa: as faces da caixa podem
+        // ser recortadas pelo near plane, e o resultado da consulta não é
+        // confiável. O objeto é desenhado sem consulta.
+        glm::vec3 center = 0.5f * (command.object->bbox_min + command.object->bbox_max);
+        glm::vec3 extent = 0.5f * (command.object->bbox_max - command.object->bbox_min);
+        glm::vec3 world_center = glm::vec3(command.model * glm::vec4(center, 1.0f));
+        glm::vec3 world_extent = glm::abs(glm::vec3(command.model[0])) * extent.x + glm::abs(glm::vec3(command.model[1])) * extent.y + glm::abs(glm::vec3(command.model[2])) * extent.z;
+        glm::vec3 distance = glm::abs(camera_position - world_center) - world_extent;
+        bool camera_inside = distance.x < OCCLUSION_CAMERA_MARGIN && distance.y < OCCLUSION_CAMERA_MARGIN && distance.z < OCCLUSION_CAMERA_MARGIN;
+
+        if (camera_inside)
+        {
+            queried[i] = false;
+            state.occluded = false;
+        }
+        else if (state.visible_frames >= OCCLUSION_TRUSTED_FRAMES && (g_OcclusionFrame + i) % OCCLUSION_TRUSTED_FRAMES != 0)
+        {
+            queried[i] = false;
+            g_OcclusionStats.skipped += 1;
+        }
+        else
+        {
+            queried[i] = true;
+            g_OcclusionStats.queries += 1;
+        }
+    }
+
+    // As caixas são desenhadas com o programa da passada de profundidade,
+    // pois nenhuma cor é calculada.
+    glUseProgram(program_depth_id);
+    glUniformMatrix4fv(depth_view_uniform, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(depth_projection_uniform, 1, GL_FALSE, glm::value_ptr(projection));
+
+    const SceneObject &box = g_VirtualScene.at("occlusion_box");
+    glBindVertexArray(MeshArena_VertexArrayObject());
+
+    // Desenho das caixas, sem escrita no framebuffer. O Backface Culling é
+    // desligado pois matrizes de modelagem com determinante negativo invertem
+    // a orientação das faces da caixa.
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    glDisable(GL_CULL_FACE);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (!queried[i])
+            continue;
+
+        const DrawCommand &command = g_OcclusionList[i];
+        glm::vec3 bbox_min = command.object->bbox_min;
+        glm::vec3 size = command.object->bbox_max - command.object->bbox_min;
+        glm::mat4 box_model = command.model * Matrix_Translate(bbox_min.x, bbox_min.y, bbox_min.z) * Matrix_Scale(size.x, size.y, size.z);
+
+        glUniformMatrix4fv(depth_model_uniform, 1, GL_FALSE, glm::value_ptr(box_model));
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, states[i]->queries[slot]);
+        glDrawElementsBaseVertex(box.rendering_mode, box.num_indices, GL_UNSIGNED_INT,
+                                 (void *)(box.first_index * sizeof(GLuint)), box.base_vertex);
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+        states[i]->pending[slot] = true;
+
+        stats.draw_calls += 1;
+    }
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(GL_TRUE);
+    glEnable(GL_CULL_FACE);
+
+    // Desenho dos objetos, cada um com o programa do seu material.
+    MaterialBinding binding = {NULL, NULL};
+    for (size_t i = 0; i < count; ++i)
+    {
+        const DrawCommand &command = g_OcclusionList[i];
+        const SceneObject &object = *command.object;
+
+        if (queried[i] && states[i]->occluded)
+        {
+            g_OcclusionStats.occluded += 1;
+            continue;
+        }
+
+        const VariantProgram *program = BindMaterial(command.material, false, view, projection, binding);
+        glUniformMatrix4fv(program->model_uniform, 1, GL_FALSE, glm::value_ptr(command.model));
+        glUniformMatrix4fv(program->normal_matrix_uniform, 1, GL_FALSE, glm::value_ptr(command.normal_matrix));
+
+        if (queried[i])
+            glBeginConditionalRender(states[i]->queries[slot], GL_QUERY_NO_WAIT);
+        glDrawElementsBaseVertex(object.rendering_mode, object.num_indices, GL_UNSIGNED_INT,
+                                 (void *)(object.first_index * sizeof(GLuint)), object.base_vertex);
+        if (queried[i])
+            glEndConditionalRender();
+
+        stats.draw_calls += 1;
+        stats.triangles += command.object->num_indices / 3;
+    }
+
     glBindVertexArray(0);
+    g_OcclusionList.clear();
+}
+
+// Imprime no terminal a taxa de acerto das consultas de oclusão: a fração dos
+// resultados lidos em que o objeto estava oculto.
+void PrintOcclusionStats()
+{
+    if (g_OcclusionStats.total_results == 0)
+        return;
+
+    printf("Consultas de oclusão: %lu resultados, %lu ocultos (taxa de acerto %.1f%%)\n",
+           g_OcclusionStats.total_results, g_OcclusionStats.total_occluded,
+           100.0 * g_OcclusionStats.total_occluded / g_OcclusionStats.total_results);
+}
+
+// Imprime no terminal o tempo médio de CPU gasto na submissão da lista de
+// desenho por cada backend utilizado durante a execução, e o tempo médio por
+// quadro exibido na janela. Cada tabela só é impressa se algum quadro foi
+// medido (sem janela, no benchmark, na reprodução e no teste de regressão,
+// não há quadros exibidos).
+void PrintDrawBackendBenchmark()
+{
+    const char *names[] = {"per-object", "multi-draw"};
+    if (g_DrawStats[0].cpu.total_frames > 0 || g_DrawStats[1].cpu.total_frames > 0)
+        printf("Tempo de CPU na submissão da lista de desenho:\n");
+    for (int backend = 0; backend < 2; ++backend)
+    {
+        const DrawStats &stats = g_DrawStats[backend];
+        if (stats.cpu.total_frames == 0)
+            continue;
+        printf("  %-10s %8.4f ms/quadro (%d quadros, %d chamadas de desenho por quadro)\n",
+               names[backend], 1000.0 * stats.cpu.total_seconds / stats.cpu.total_frames,
+               stats.cpu.total_frames, stats.draw_calls);
+    }
+
+    if (g_FrameTimeStats[0].total_frames == 0 && g_FrameTimeStats[1].total_frames == 0)
+        return;
+
+    const char *prepass_names[] = {"sem passada de profundidade", "com passada de profundidade"};
+    printf("Tempo médio por quadro:\n");
+    for (int prepass = 0; prepass < 2; ++prepass)
+    {
+        const FrameTimeStats &stats = g_FrameTimeStats[prepass];
+        if (stats.total_frames == 0)
+            continue;
+        printf("  %-28s %8.4f ms/quadro (%d quadros)\n",
+               prepass_names[prepass], 1000.0 * stats.total_seconds / stats.total_frames, stats.total_frames);
+    }
+}
+
+// Acumula o tempo desde a última chamada (isto é, o tempo total do quadro
+// que acabou de ser exibido por glfwSwapBuffers()) nas estatísticas do modo
+// atual da passada de profundidade. Retorna o tempo do quadro, em segundos.
+double UpdateFrameTimeStats()
+{
+    double now_seconds = GetTimeSeconds();
+    double frame_seconds = now_seconds - g_FrameStartSeconds;
+    g_FrameStartSeconds = now_seconds;
+
+    AccumulateFrameTime(g_FrameTimeStats[g_DepthPrepass], frame_seconds);
+    FrameStats_AddFrame(frame_seconds);
+    return frame_seconds;
+}
+
+// Acumula "seconds", o tempo de um quadro, nas estatísticas "stats". A média
+// móvel exibida na tela é atualizada a cada 60 quadros.
+void AccumulateFrameTime(FrameTimeStats &stats, double seconds)
+{
+    stats.total_seconds += seconds;
+    stats.total_frames += 1;
+    stats.window_seconds += seconds;
+    stats.window_frames += 1;
+
+    if (stats.window_frames == 60)
+    {
+        stats.average_ms = 1000.0 * stats.window_seconds / stats.window_frames;
+        stats.window_seconds = 0.0;
+        stats.window_frames = 0;
+    }
+}
+
+// Pede o redesenho da cena. Chamada pelos callbacks de entrada e da janela, e
+// sempre que o estado do jogo muda fora deles, sempre com g_SimulationMutex
+// travado. Acorda a thread de simulação, caso esteja parada.
+void RequestRedraw()
+{
+    g_RedrawFrames = REDRAW_SETTLE_FRAMES;
+    g_SimulationWake.notify_one();
+}
+
+// Verifica se houve um pedido de redesenho, descartando-o. Utilizada pelas
+// telas de mensagem, as quais não dependem da simulação.
+bool ConsumeRedrawRequest()
+{
+    std::lock_guard<std::mutex> lock(g_SimulationMutex);
+    bool requested = g_RedrawFrames > 0;
+    g_RedrawFrames = 0;
+    return requested;
+}
+
+// Verifica se o quadro exibido precisa ser substituído: houve um pedido de
+// redesenho, a câmera está se movendo (teclas WASD pressionadas) ou algum
+// objeto animado (o globo girando, a esfera de dica percorrendo a curva de
+// Bézier) estava visível no último quadro.
+bool SceneNeedsRedraw()
+{
+    bool moving = !g_lookAt && (g_KeyPressedW || g_KeyPressedA || g_KeyPressedS || g_KeyPressedD);
+    return g_RedrawFrames > 0 || moving || g_AnimatedObjectVisible;
+}
+
+// Espera, sem um pacote novo a desenhar, pelo próximo evento: entrada do
+// usuário, da janela, da thread de simulação (veja SimulationThreadLoop()) ou
+// da thread de observação dos shaders (veja "shaderwatcher.cpp").
+void WaitForRedraw()
+{
+    glfwWaitEventsTimeout(g_PendingShaderPrograms.empty() ? IDLE_WAIT_SECONDS : SHADER_RELOAD_POLL_SECONDS);
+    UpdateShaderReload();
+
+    // O tempo parado não pertence a quadro algum: não deve entrar nas
+    // estatísticas de tempo por quadro (nem na simulação; veja
+    // ProduceFramePacket()).
+    g_FrameStartSeconds = GetTimeSeconds();
+}
+
+// Produz o pacote do próximo quadro: avança a simulação pelo tempo decorrido
+// desde a chamada anterior e monta a cena no estado interpolado. Retorna
+// false, sem alterar o pacote, se o quadro exibido continua correto (veja
+// SceneNeedsRedraw()). Chamada com g_SimulationMutex travado, pela thread de
+// simulação ou, sem ela, pela thread principal a cada quadro; o pacote é
+// terminado por FinishFramePacket(), após liberar o mutex.
+bool ProduceFramePacket(FramePacket &packet)
+{
+    seconds = (float)GetTimeSeconds();
+    ellapsed_s = seconds - p_seconds;
+    p_seconds = seconds;
+
+    if (!SceneNeedsRedraw())
+    {
+        g_SimulationIdle = true;
+        return false;
+    }
+    if (g_RedrawFrames > 0)
+        g_RedrawFrames -= 1;
+
+    // O tempo em que a cena ficou parada, ou coberta pelas telas de
+    // mensagem, não desloca a câmera nem as animações.
+    if (g_SimulationIdle || showControlMessage || endGame)
+        ellapsed_s = 0.0f;
+    g_SimulationIdle = false;
+
+    // Avançamos a simulação pelo tempo decorrido, e desenhamos o estado
+    // interpolado entre os dois últimos passos.
+    SimulationState state = UpdateSimulation(ellapsed_s);
+    BuildFramePacket(packet, state);
+    return true;
+}
+
+// Publica o pacote g_FramePackets[g_FramePacketWrite], recém escrito, e passa
+// a escrever no pacote publicado anteriormente (caso não tenha sido
+// adquirido, ele é descartado).
+void PublishFramePacket()
+{
+    int previous = g_FramePacketShared.exchange(g_FramePacketWrite | FRAME_PACKET_FRESH, std::memory_order_acq_rel);
+    g_FramePacketWrite = previous & 3;
+}
+
+// Retorna o pacote publicado mais recente, o qual passa a pertencer à
+// renderização até a próxima chamada, ou NULL se nenhum pacote foi publicado
+// desde a chamada anterior.
+const FramePacket *AcquireFramePacket()
+{
+    // Somente a simulação altera o pacote publicado, e sempre com o bit
+    // FRAME_PACKET_FRESH: se ele está ligado, continuará ligado na troca.
+    if (!(g_FramePacketShared.load(std::memory_order_acquire) & FRAME_PACKET_FRESH))
+        return NULL;
+
+    int previous = g_FramePacketShared.exchange(g_FramePacketRead, std::memory_order_acq_rel);
+    g_FramePacketRead = previous & 3;
+    return &g_FramePackets[g_FramePacketRead];
+}
+
+// Laço da thread de simulação: produz um pacote a cada SIMULATION_STEP_SECONDS
+// enquanto a cena estiver mudando, e espera por um pedido de redesenho
+// (RequestRedraw()) com a cena parada.
+static void SimulationThreadLoop()
+{
+    Profiler_SetThreadName("simulation");
+
+    std::chrono::steady_clock::time_point next_step = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::duration step = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(SIMULATION_STEP_SECONDS));
+
+    std::unique_lock<std::mutex> lock(g_SimulationMutex);
+    while (g_SimulationThreadRunning)
+    {
+        if (!ProduceFramePacket(g_FramePackets[g_FramePacketWrite]))
+        {
+            g_SimulationWake.wait(lock);
+            next_step = std::chrono::steady_clock::now();
+            continue;
+        }
+        lock.unlock();
+
+        FinishFramePacket(g_FramePackets[g_FramePacketWrite]);
+
+        // A thread principal pode estar bloqueada esperando por eventos
+        // (veja WaitForRedraw()); glfwPostEmptyEvent() pode ser chamada de
+        // qualquer thread.
+        PublishFramePacket();
+        glfwPostEmptyEvent();
+
+        // Se a produção atrasou mais de um passo, não tentamos recuperar.
+        next_step += step;
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (next_step < now)
+            next_step = now;
+        std::this_thread::sleep_until(next_step);
+
+        lock.lock();
+    }
+}
+
+void StartSimulationThread()
+{
+    if (g_SimulationThreadRunning)
+        return;
+
+    g_SimulationThreadRunning = true;
+    g_SimulationThread = std::thread(SimulationThreadLoop);
+}
+
+void StopSimulationThread()
+{
+    if (!g_SimulationThreadRunning)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(g_SimulationMutex);
+        g_SimulationThreadRunning = false;
+        g_SimulationWake.notify_one();
+    }
+    g_SimulationThread.join();
 }
 
 // Função que carrega os shaders de vértices e de fragmentos que serão
@@ -1045,41 +3309,313 @@ void LoadShadersFromFiles()
     //       |
     //       o-- shader_fragment.glsl
     //
-    vertex_shader_id = LoadShader_Vertex("../../src/shader_vertex.glsl");
-    fragment_shader_id = LoadShader_Fragment("../../src/shader_fragment.glsl");
+    std::vector<ShaderProgramSource> programs;
+    CollectShaderPrograms(programs);
 
-    // Deletamos o programa de GPU anterior, caso ele exista.
-    if (program_id != 0)
-        glDeleteProgram(program_id);
+    for (size_t i = 0; i < programs.size(); ++i)
+    {
+        // Deletamos o programa de GPU anterior, caso ele exista.
+        GLuint &program = *programs[i].program_id;
+        if (program != 0)
+            glDeleteProgram(program);
+
+        // Criamos um programa de GPU utilizando os shaders acima.
+        program = LoadGpuProgram("../../src/shader_vertex.glsl", programs[i].vertex_defines.c_str(),
+                                 "../../src/shader_fragment.glsl", programs[i].fragment_defines.c_str());
+    }
 
-    // Criamos um programa de GPU utilizando os shaders carregados acima.
-    program_id = CreateGpuProgram(vertex_shader_id, fragment_shader_id);
+    LookupShaderUniforms();
+}
+
+// Lista todos os programas de GPU criados a partir dos arquivos de shaders:
+// o programa padrão, os da passada de profundidade e os de cada variante já
+// utilizada pelos materiais (veja GetShaderVariant()), para que uma recarga
+// dos shaders atualize todos eles.
+void CollectShaderPrograms(std::vector<ShaderProgramSource> &programs)
+{
+    ShaderProgramSource source;
+
+    source.program_id = &program_id;
+    source.vertex_defines = "";
+    source.fragment_defines = "";
+    programs.push_back(source);
+
+    // Programas da passada de profundidade (veja SubmitDrawList()): com
+    // "#define DEPTH_ONLY" o Fragment Shader não calcula cor alguma.
+    source.program_id = &program_depth_id;
+    source.vertex_defines = "";
+    source.fragment_defines = "#define DEPTH_ONLY\n";
+    programs.push_back(source);
+
+    source.program_id = &program_multidraw_depth_id;
+    source.vertex_defines = "#define MULTI_DRAW\n";
+    source.fragment_defines = "#define MULTI_DRAW\n#define DEPTH_ONLY\n";
+    programs.push_back(source);
+
+    for (std::map<unsigned long long, ShaderVariant>::iterator it = g_ShaderVariants.begin(); it != g_ShaderVariants.end(); ++it)
+    {
+        ShaderVariant &variant = it->second;
 
-    // Buscamos o endereço das variáveis definidas dentro do Vertex Shader.
+        source.program_id = &variant.program.program_id;
+        source.vertex_defines = variant.defines;
+        source.fragment_defines = variant.defines;
+        programs.push_back(source);
+
+        source.program_id = &variant.multidraw.program_id;
+        source.vertex_defines = "#define MULTI_DRAW\n" + variant.defines;
+        source.fragment_defines = "#define MULTI_DRAW\n" + variant.defines;
+        programs.push_back(source);
+    }
+}
+
+// Busca o endereço das variáveis definidas dentro dos shaders de todos os
+// programas listados por CollectShaderPrograms(). Deve ser chamada sempre que
+// os programas são recriados.
+void LookupShaderUniforms()
+{
     // Utilizaremos estas variáveis para enviar dados para a placa de vídeo
     // (GPU)! Veja arquivo "shader_vertex.glsl" e "shader_fragment.glsl".
     model_uniform = glGetUniformLocation(program_id, "model");           // Variável da matriz "model"
     view_uniform = glGetUniformLocation(program_id, "view");             // Variável da matriz "view" em shader_vertex.glsl
     projection_uniform = glGetUniformLocation(program_id, "projection"); // Variável da matriz "projection" em shader_vertex.glsl
-    object_id_uniform = glGetUniformLocation(program_id, "object_id");   // Variável "object_id" em shader_fragment.glsl
-    bbox_min_uniform = glGetUniformLocation(program_id, "bbox_min");
-    bbox_max_uniform = glGetUniformLocation(program_id, "bbox_max");
 
-    // Variáveis em "shader_fragment.glsl" para acesso das imagens de textura
-    glUseProgram(program_id);
-    glUniform1i(glGetUniformLocation(program_id, "TextureImage0"), 0);
-    glUniform1i(glGetUniformLocation(program_id, "TextureImage1"), 1);
-    glUniform1i(glGetUniformLocation(program_id, "WallTexture"), 2);
-    glUniform1i(glGetUniformLocation(program_id, "FloorTexture"), 3);
-    glUniform1i(glGetUniformLocation(program_id, "OakWoodTexture"), 4);
-    glUniform1i(glGetUniformLocation(program_id, "Tip1Texture"), 5);
-    glUniform1i(glGetUniformLocation(program_id, "Tip2Texture"), 6);
-    glUniform1i(glGetUniformLocation(program_id, "GoldTexture"), 7);
-    glUniform1i(glGetUniformLocation(program_id, "SilverTexture"), 8);
+    depth_model_uniform = glGetUniformLocation(program_depth_id, "model");
+    depth_view_uniform = glGetUniformLocation(program_depth_id, "view");
+    depth_projection_uniform = glGetUniformLocation(program_depth_id, "projection");
+
+    multidraw_depth_view_uniform = glGetUniformLocation(program_multidraw_depth_id, "view");
+    multidraw_depth_projection_uniform = glGetUniformLocation(program_multidraw_depth_id, "projection");
+    multidraw_depth_draw_offset_uniform = glGetUniformLocation(program_multidraw_depth_id, "draw_offset");
+
+    glUseProgram(program_multidraw_depth_id);
+    glUniform1i(glGetUniformLocation(program_multidraw_depth_id, "draw_data"), DRAW_DATA_TEXTURE_UNIT);
+    glUseProgram(0);
+
+    for (std::map<unsigned long long, ShaderVariant>::iterator it = g_ShaderVariants.begin(); it != g_ShaderVariants.end(); ++it)
+    {
+        LookupVariantUniforms(it->second.program);
+        LookupVariantUniforms(it->second.multidraw);
+    }
+}
+
+// Cria um material com os parâmetros dados e retorna o seu índice em
+// g_Materials. "texture0" e "texture1" são unidades de textura, ou -1.
+static int AddMaterial(MaterialLighting lighting, bool point_light, GLint texture0, GLint texture1)
+{
+    Material material;
+    material.lighting = lighting;
+    material.point_light = point_light;
+    material.num_textures = (texture0 < 0) ? 0 : (texture1 < 0) ? 1 : 2;
+    material.texture_units[0] = texture0;
+    material.texture_units[1] = texture1;
+    material.uv_generator = UV_GENERATOR_NONE;
+    material.Kd = glm::vec3(0.0f, 0.0f, 0.0f);
+    material.Ks = glm::vec3(0.0f, 0.0f, 0.0f);
+    material.Ka = glm::vec3(0.0f, 0.0f, 0.0f);
+    material.q = 1.0f;
+    material.variant = NULL;
+
+    g_Materials.push_back(material);
+    return (int)g_Materials.size() - 1;
+}
+
+// Define o material de cada objeto da cena (os "object_id" definidos em
+// main()) e compila uma variante dos shaders para cada combinação de
+// parâmetros utilizada. Objetos com materiais idênticos compartilham o mesmo
+// material, e portanto o mesmo lote na submissão em lote.
+void InitMaterials()
+{
+    // Unidades de textura, na ordem das chamadas a LoadTextureImage() em main().
+    const GLint NO_TEXTURE = -1;
+    const GLint EARTH_DAY_TEXTURE = 0;
+    const GLint EARTH_NIGHT_TEXTURE = 1;
+    const GLint WALL_TEXTURE = 2;
+    const GLint FLOOR_TEXTURE = 3;
+    const GLint OAK_WOOD_TEXTURE = 4;
+    const GLint TIP1_TEXTURE = 5;
+    const GLint TIP2_TEXTURE = 6;
+    const GLint SILVER_TEXTURE = 8;
+
+    int earth = AddMaterial(MATERIAL_LIGHTING_LAMBERT, false, EARTH_DAY_TEXTURE, EARTH_NIGHT_TEXTURE);
+    int tip_sphere = AddMaterial(MATERIAL_LIGHTING_LAMBERT, false, FLOOR_TEXTURE, NO_TEXTURE);
+    g_Materials[earth].uv_generator = UV_GENERATOR_SPHERICAL;
+    g_Materials[tip_sphere].uv_generator = UV_GENERATOR_SPHERICAL;
+    int earth_planar = AddMaterial(MATERIAL_LIGHTING_LAMBERT, false, EARTH_DAY_TEXTURE, NO_TEXTURE);
+    int lever = AddMaterial(MATERIAL_LIGHTING_LAMBERT, true, EARTH_DAY_TEXTURE, NO_TEXTURE);
+    int wood = AddMaterial(MATERIAL_LIGHTING_LAMBERT, false, OAK_WOOD_TEXTURE, NO_TEXTURE);
+    int spider = AddMaterial(MATERIAL_LIGHTING_LAMBERT, false, SILVER_TEXTURE, NO_TEXTURE);
+    g_Materials[earth_planar].uv_generator = UV_GENERATOR_PLANAR_XY;
+    g_Materials[lever].uv_generator = UV_GENERATOR_PLANAR_XY;
+    g_Materials[spider].uv_generator = UV_GENERATOR_PLANAR_XY;
+
+    // As peças de madeira têm faces em todas as direções: a projeção no plano
+    // XY esticaria a textura nas faces laterais.
+    g_Materials[wood].uv_generator = UV_GENERATOR_BOX;
+    int wall = AddMaterial(MATERIAL_LIGHTING_UNLIT, true, WALL_TEXTURE, NO_TEXTURE);
+    int floor = AddMaterial(MATERIAL_LIGHTING_UNLIT, true, FLOOR_TEXTURE, NO_TEXTURE);
+    int roof = AddMaterial(MATERIAL_LIGHTING_UNLIT, true, SILVER_TEXTURE, NO_TEXTURE);
+    int map = AddMaterial(MATERIAL_LIGHTING_UNLIT, true, EARTH_DAY_TEXTURE, NO_TEXTURE);
+    int tip1 = AddMaterial(MATERIAL_LIGHTING_UNLIT, true, TIP1_TEXTURE, NO_TEXTURE);
+    int tip2 = AddMaterial(MATERIAL_LIGHTING_UNLIT, true, TIP2_TEXTURE, NO_TEXTURE);
+
+    int gold = AddMaterial(MATERIAL_LIGHTING_BLINN_PHONG, false, NO_TEXTURE, NO_TEXTURE);
+    g_Materials[gold].Kd = glm::vec3(0.8f, 0.8784f, 0.0941f);    // Refletancia difusa
+    g_Materials[gold].Ks = glm::vec3(0.8784f, 0.6941f, 0.0941f); // Refletancia especular
+    g_Materials[gold].Ka = glm::vec3(0.5098f, 0.5451f, 0.1804f); // Refletancia ambiente
+    g_Materials[gold].q = 90.0f;
+
+    g_ObjectMaterials.assign(TIPSPHERE + 1, -1);
+    for (int id = WALL; id <= FLOOR3; ++id)
+        g_ObjectMaterials[id] = wall;
+
+    g_ObjectMaterials[SPHERE] = earth;
+    g_ObjectMaterials[TIPSPHERE] = tip_sphere;
+    g_ObjectMaterials[BUNNY] = earth_planar;
+    g_ObjectMaterials[DOOR1] = earth_planar;
+    g_ObjectMaterials[DOOR2] = earth_planar;
+    g_ObjectMaterials[FLOOR] = floor;
+    g_ObjectMaterials[FLOOR2] = floor;
+    g_ObjectMaterials[FLOOR3] = floor;
+    g_ObjectMaterials[ROOF1] = roof;
+    g_ObjectMaterials[ROOF2] = roof;
+    g_ObjectMaterials[ROOF3] = roof;
+    g_ObjectMaterials[MAP] = map;
+    g_ObjectMaterials[TIPBOARD1] = tip1;
+    g_ObjectMaterials[TIPBOARD2] = tip2;
+    g_ObjectMaterials[OSCAR] = gold;
+    g_ObjectMaterials[TROPHY] = gold;
+    g_ObjectMaterials[SPIDER1] = spider;
+    g_ObjectMaterials[SPIDER2] = spider;
+    for (int id = LEVER1; id <= LEVER7; ++id)
+        g_ObjectMaterials[id] = lever;
+    for (int id = WOODTABLE; id <= WOODZ3; ++id)
+        g_ObjectMaterials[id] = wood;
+
+    for (size_t i = 0; i < g_Materials.size(); ++i)
+        g_Materials[i].variant = GetShaderVariant(g_Materials[i]);
+
+    printf("Materiais: %d materiais, %d variantes dos shaders\n", (int)g_Materials.size(), (int)g_ShaderVariants.size());
+}
+
+// Retorna a variante dos shaders especializada para o material: os shaders
+// compilados somente com o código de iluminação e texturas do material. Variantes são compiladas uma única vez, na primeira
+// vez em que são pedidas, e guardadas em g_ShaderVariants indexadas pelo hash
+// (FNV-1a de 64 bits) do seu conjunto de "#define".
+ShaderVariant *GetShaderVariant(const Material &material)
+{
+    static const char *lighting_defines[] = {"", "#define LIGHTING_LAMBERT\n", "#define LIGHTING_BLINN_PHONG\n"};
+
+    std::string defines = lighting_defines[material.lighting];
+    if (material.point_light)
+        defines += "#define POINT_LIGHT\n";
+
+    char texture_count[32];
+    snprintf(texture_count, sizeof(texture_count), "#define TEXTURE_COUNT %d\n", material.num_textures);
+    defines += texture_count;
+
+    unsigned long long hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < defines.size(); ++i)
+    {
+        hash ^= (unsigned char)defines[i];
+        hash *= 1099511628211ULL;
+    }
+
+    std::map<unsigned long long, ShaderVariant>::iterator it = g_ShaderVariants.find(hash);
+    if (it != g_ShaderVariants.end())
+    {
+        if (it->second.defines != defines)
+            throw std::runtime_error("Colisão de hash entre variantes dos shaders.");
+        return &it->second;
+    }
+
+    ShaderVariant &variant = g_ShaderVariants[hash];
+    variant.defines = defines;
+    variant.program.program_id = 0;
+    variant.multidraw.program_id = 0;
+    LoadShaderVariant(variant);
+    return &variant;
+}
+
+// Cria o programa de GPU de "shader_vertex.glsl" e "shader_fragment.glsl"
+// compilados com "defines", e busca os endereços das suas variáveis uniform.
+static void LoadVariantProgram(const std::string &defines, VariantProgram &program)
+{
+    if (program.program_id != 0)
+        glDeleteProgram(program.program_id);
+
+    program.program_id = LoadGpuProgram("../../src/shader_vertex.glsl", defines.c_str(), "../../src/shader_fragment.glsl", defines.c_str());
+
+    LookupVariantUniforms(program);
+}
 
+// Busca os endereços das variáveis uniform do programa de uma variante.
+void LookupVariantUniforms(VariantProgram &program)
+{
+    program.model_uniform = glGetUniformLocation(program.program_id, "model");
+    program.normal_matrix_uniform = glGetUniformLocation(program.program_id, "normal_matrix");
+    program.view_uniform = glGetUniformLocation(program.program_id, "view");
+    program.projection_uniform = glGetUniformLocation(program.program_id, "projection");
+    program.draw_offset_uniform = glGetUniformLocation(program.program_id, "draw_offset");
+    program.camera_position_uniform = glGetUniformLocation(program.program_id, "camera_position");
+    program.texture_uniforms[0] = glGetUniformLocation(program.program_id, "texture0");
+    program.texture_uniforms[1] = glGetUniformLocation(program.program_id, "texture1");
+    program.kd_uniform = glGetUniformLocation(program.program_id, "Kd");
+    program.ks_uniform = glGetUniformLocation(program.program_id, "Ks");
+    program.ka_uniform = glGetUniformLocation(program.program_id, "Ka");
+    program.q_uniform = glGetUniformLocation(program.program_id, "q");
+
+    glUseProgram(program.program_id);
+    glUniform1i(glGetUniformLocation(program.program_id, "draw_data"), DRAW_DATA_TEXTURE_UNIT);
     glUseProgram(0);
 }
 
+// (Re)compila os dois programas de uma variante: o do desenho por objeto e o
+// da submissão em lote (veja SubmitDrawList_MultiDraw()), o qual lê os
+// parâmetros de cada objeto de um "texture buffer".
+void LoadShaderVariant(ShaderVariant &variant)
+{
+    LoadVariantProgram(variant.defines, variant.program);
+    LoadVariantProgram("#define MULTI_DRAW\n" + variant.defines, variant.multidraw);
+}
+
+// Ativa o programa da variante do material, caso seja diferente do programa
+// ativo, enviando as matrizes "view" e "projection" e a posição da câmera; e envia os parâmetros do
+// material, caso seja diferente do anterior. As unidades de textura são
+// compartilhadas entre materiais, então o amostrador de cada unidade é
+// escolhido pelo material: GL_REPEAT somente para as coordenadas esféricas. Retorna o programa ativo, para
+// o envio dos parâmetros de cada objeto.
+const VariantProgram *BindMaterial(const Material *material, bool multi_draw, const glm::mat4 &view, const glm::mat4 &projection, MaterialBinding &binding)
+{
+    const VariantProgram *program = multi_draw ? &material->variant->multidraw : &material->variant->program;
+
+    if (program != binding.program)
+    {
+        glUseProgram(program->program_id);
+        glUniformMatrix4fv(program->view_uniform, 1, GL_FALSE, glm::value_ptr(view));
+        glUniformMatrix4fv(program->projection_uniform, 1, GL_FALSE, glm::value_ptr(projection));
+        glUniform4fv(program->camera_position_uniform, 1, glm::value_ptr(g_DrawCameraPosition));
+        binding.program = program;
+        binding.material = NULL;
+    }
+
+    if (material != binding.material)
+    {
+        GLuint sampler_id = material->uv_generator == UV_GENERATOR_SPHERICAL ? g_RepeatSampler : g_ClampSampler;
+        for (int i = 0; i < material->num_textures; ++i)
+        {
+            glUniform1i(program->texture_uniforms[i], material->texture_units[i]);
+            glBindSampler(material->texture_units[i], sampler_id);
+        }
+        glUniform3fv(program->kd_uniform, 1, glm::value_ptr(material->Kd));
+        glUniform3fv(program->ks_uniform, 1, glm::value_ptr(material->Ks));
+        glUniform3fv(program->ka_uniform, 1, glm::value_ptr(material->Ka));
+        glUniform1f(program->q_uniform, material->q);
+        binding.material = material;
+    }
+
+    return program;
+}
+
 // Função que pega a matriz M e guarda a mesma no topo da pilha
 void PushMatrix(glm::mat4 M)
 {
@@ -1104,6 +3640,8 @@ void PopMatrix(glm::mat4 &M)
 // especificadas dentro do arquivo ".obj"
 void ComputeNormals(ObjModel *model)
 {
+    PROFILE_FUNCTION();
+
     if (!model->attrib.normals.empty())
         return;
 
@@ -1164,16 +3702,15 @@ void ComputeNormals(ObjModel *model)
 }
 
 // Constrói triângulos para futura renderização a partir de um ObjModel.
-void BuildTrianglesAndAddToVirtualScene(ObjModel *model)
+// Os vértices e índices do modelo são copiados para blocos reservados dentro
+// da arena global de malhas (veja mesharena.cpp).
+void BuildTrianglesAndAddToVirtualScene(ObjModel *model, UVGenerator uv_generator)
 {
-    GLuint vertex_array_object_id;
-    glGenVertexArrays(1, &vertex_array_object_id);
-    glBindVertexArray(vertex_array_object_id);
+    PROFILE_FUNCTION();
 
     std::vector<GLuint> indices;
-    std::vector<float> model_coefficients;
-    std::vector<float> normal_coefficients;
-    std::vector<float> texture_coefficients;
+    std::vector<float> vertex_coefficients; // Atributos intercalados: posição (4), normal (4) e textura (2)
+    std::vector<SceneObject> objects;
 
     for (size_t shape = 0; shape < model->shapes.size(); ++shape)
     {
@@ -1200,10 +3737,10 @@ void BuildTrianglesAndAddToVirtualScene(ObjModel *model)
                 const float vy = model->attrib.vertices[3 * idx.vertex_index + 1];
                 const float vz = model->attrib.vertices[3 * idx.vertex_index + 2];
                 //printf("tri %d vert %d = (%.2f, %.2f, %.2f)\n", (int)triangle, (int)vertex, vx, vy, vz);
-                model_coefficients.push_back(vx);   // X
-                model_coefficients.push_back(vy);   // Y
-                model_coefficients.push_back(vz);   // Z
-                model_coefficients.push_back(1.0f); // W
+                vertex_coefficients.push_back(vx);   // X
+                vertex_coefficients.push_back(vy);   // Y
+                vertex_coefficients.push_back(vz);   // Z
+                vertex_coefficients.push_back(1.0f); // W
 
                 bbox_min.x = std::min(bbox_min.x, vx);
                 bbox_min.y = std::min(bbox_min.y, vy);
@@ -1212,92 +3749,172 @@ void BuildTrianglesAndAddToVirtualScene(ObjModel *model)
                 bbox_max.y = std::max(bbox_max.y, vy);
                 bbox_max.z = std::max(bbox_max.z, vz);
 
+                // Todos os vértices da arena possuem o mesmo formato, então
+                // atributos ausentes no arquivo ".obj" são preenchidos com zero.
+                float nx = 0.0f, ny = 0.0f, nz = 0.0f;
                 if (idx.normal_index != -1)
                 {
-                    const float nx = model->attrib.normals[3 * idx.normal_index + 0];
-                    const float ny = model->attrib.normals[3 * idx.normal_index + 1];
-                    const float nz = model->attrib.normals[3 * idx.normal_index + 2];
-                    normal_coefficients.push_back(nx);   // X
-                    normal_coefficients.push_back(ny);   // Y
-                    normal_coefficients.push_back(nz);   // Z
-                    normal_coefficients.push_back(0.0f); // W
+                    nx = model->attrib.normals[3 * idx.normal_index + 0];
+                    ny = model->attrib.normals[3 * idx.normal_index + 1];
+                    nz = model->attrib.normals[3 * idx.normal_index + 2];
                 }
+                vertex_coefficients.push_back(nx);   // X
+                vertex_coefficients.push_back(ny);   // Y
+                vertex_coefficients.push_back(nz);   // Z
+                vertex_coefficients.push_back(0.0f); // W
 
+                float u = 0.0f, v = 0.0f;
                 if (idx.texcoord_index != -1)
                 {
-                    const float u = model->attrib.texcoords[2 * idx.texcoord_index + 0];
-                    const float v = model->attrib.texcoords[2 * idx.texcoord_index + 1];
-                    texture_coefficients.push_back(u);
-                    texture_coefficients.push_back(v);
+                    u = model->attrib.texcoords[2 * idx.texcoord_index + 0];
+                    v = model->attrib.texcoords[2 * idx.texcoord_index + 1];
                 }
+                vertex_coefficients.push_back(u);
+                vertex_coefficients.push_back(v);
+            }
+        }
+
+        size_t last_index = indices.size() - 1;
+
+        // Coordenadas de textura procedurais dependem somente da posição de
+        // cada vértice e da AABB do objeto, e são calculadas uma única vez
+        // aqui, ao invés de para cada fragmento no Fragment Shader.
+        if (uv_generator != UV_GENERATOR_NONE)
+            GenerateTextureCoordinates(&vertex_coefficients[10 * first_index], last_index - first_index + 1, bbox_min, bbox_max, uv_generator);
+
+        SceneObject theobject;
+        theobject.name = model->shapes[shape].name;
+        theobject.first_index = first_index;                  // Primeiro índice (relativo ao modelo, ajustado abaixo)
+        theobject.num_indices = last_index - first_index + 1; // Número de indices
+        theobject.rendering_mode = GL_TRIANGLES;              // Índices correspondem ao tipo de rasterização GL_TRIANGLES.
+        theobject.vertex_array_object_id = MeshArena_VertexArrayObject();
+
+        theobject.bbox_min = bbox_min;
+        theobject.bbox_max = bbox_max;
+
+        objects.push_back(theobject);
+    }
+
+    // Reservamos espaço na arena e copiamos os dados do modelo para a GPU.
+    size_t num_vertices = vertex_coefficients.size() / 10;
+    size_t first_vertex = MeshArena_AllocVertices(num_vertices);
+    size_t first_index = MeshArena_AllocIndices(indices.size());
+    MeshArena_UploadVertices(first_vertex, num_vertices, vertex_coefficients.data());
+    MeshArena_UploadIndices(first_index, indices.size(), indices.data());
+
+    for (size_t i = 0; i < objects.size(); ++i)
+    {
+        // Malhas oclusoras guardam também uma cópia das posições dos seus
+        // vértices na CPU, para a oclusão por software. Os índices de cada
+        // objeto são sequenciais, então cada três vértices formam um triângulo.
+        if (IsOccluderMesh(objects[i].name))
+        {
+            for (size_t v = objects[i].first_index; v < objects[i].first_index + objects[i].num_indices; ++v)
+                objects[i].occluder_positions.insert(objects[i].occluder_positions.end(), &vertex_coefficients[10 * v], &vertex_coefficients[10 * v + 3]);
+        }
+
+        objects[i].first_index += first_index;
+        objects[i].base_vertex = first_vertex;
+
+        g_VirtualScene[objects[i].name] = objects[i];
+    }
+}
+
+// Gera coordenadas de textura procedurais para "num_vertices" vértices
+// consecutivos no formato da arena de malhas (10 floats por vértice: posição,
+// normal e coordenadas de textura; veja BuildTrianglesAndAddToVirtualScene()),
+// a partir da posição de cada vértice no sistema de coordenadas do modelo e da
+// AABB do objeto. Os vértices não são compartilhados entre triângulos, o que
+// permite ajustar cada triângulo individualmente.
+void GenerateTextureCoordinates(float *vertex_coefficients, size_t num_vertices, glm::vec3 bbox_min, glm::vec3 bbox_max, UVGenerator uv_generator)
+{
+    const float pi = 3.14159265358979323846f;
+
+    glm::vec3 bbox_center = (bbox_min + bbox_max) / 2.0f;
+    glm::vec3 bbox_size = glm::max(bbox_max - bbox_min, glm::vec3(1e-6f));
+
+    for (size_t triangle = 0; triangle + 3 <= num_vertices; triangle += 3)
+    {
+        float *vertices[3];
+        glm::vec3 positions[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            vertices[i] = &vertex_coefficients[10 * (triangle + i)];
+            positions[i] = glm::vec3(vertices[i][0], vertices[i][1], vertices[i][2]);
+        }
+
+        float u[3], v[3];
+
+        if (uv_generator == UV_GENERATOR_SPHERICAL)
+        {
+            bool pole[3];
+            for (int i = 0; i < 3; ++i)
+            {
+                glm::vec3 p_vec = glm::normalize(positions[i] - bbox_center);
+                float theta = atan2f(p_vec.x, p_vec.z);
+                float phi = asinf(glm::clamp(p_vec.y, -1.0f, 1.0f));
+                u[i] = (theta + pi) / (2.0f * pi);
+                v[i] = (phi + pi / 2.0f) / pi;
+                pole[i] = fabsf(p_vec.y) > 0.9999f;
+            }
+
+            // Triângulos que cruzam a costura da projeção (theta = +-pi) teriam
+            // U interpolado através de toda a textura; deslocamos os vértices
+            // do lado U ~ 0 para U ~ 1 (a textura repete em S, veja BindMaterial()).
+            float u_min = 1.0f, u_max = 0.0f;
+            for (int i = 0; i < 3; ++i)
+            {
+                if (pole[i])
+                    continue;
+                u_min = std::min(u_min, u[i]);
+                u_max = std::max(u_max, u[i]);
+            }
+            for (int i = 0; i < 3; ++i)
+            {
+                if (!pole[i] && u_max - u_min > 0.5f && u[i] < 0.5f)
+                    u[i] += 1.0f;
+            }
+
+            // Nos polos theta não é definido: utilizamos a média dos demais vértices.
+            for (int i = 0; i < 3; ++i)
+            {
+                if (!pole[i])
+                    continue;
+                int a = (i + 1) % 3;
+                int b = (i + 2) % 3;
+                u[i] = (pole[a] || pole[b]) ? u[pole[a] ? b : a] : (u[a] + u[b]) / 2.0f;
+            }
+        }
+        else if (uv_generator == UV_GENERATOR_BOX)
+        {
+            // Projeção no plano coordenado mais próximo do plano do triângulo.
+            glm::vec3 n = glm::abs(glm::cross(positions[1] - positions[0], positions[2] - positions[0]));
+            int u_axis = 0, v_axis = 1;
+            if (n.x >= n.y && n.x >= n.z)
+                u_axis = 2;
+            else if (n.y >= n.z)
+                v_axis = 2;
+            for (int i = 0; i < 3; ++i)
+            {
+                u[i] = (positions[i][u_axis] - bbox_min[u_axis]) / bbox_size[u_axis];
+                v[i] = (positions[i][v_axis] - bbox_min[v_axis]) / bbox_size[v_axis];
+            }
+        }
+        else
+        {
+            for (int i = 0; i < 3; ++i)
+            {
+                u[i] = (positions[i].x - bbox_min.x) / bbox_size.x;
+                v[i] = (positions[i].y - bbox_min.y) / bbox_size.y;
             }
         }
 
-        size_t last_index = indices.size() - 1;
-
-        SceneObject theobject;
-        theobject.name = model->shapes[shape].name;
-        theobject.first_index = first_index;                  // Primeiro índice
-        theobject.num_indices = last_index - first_index + 1; // Número de indices
-        theobject.rendering_mode = GL_TRIANGLES;              // Índices correspondem ao tipo de rasterização GL_TRIANGLES.
-        theobject.vertex_array_object_id = vertex_array_object_id;
-
-        theobject.bbox_min = bbox_min;
-        theobject.bbox_max = bbox_max;
-
-        g_VirtualScene[model->shapes[shape].name] = theobject;
-    }
-
-    GLuint VBO_model_coefficients_id;
-    glGenBuffers(1, &VBO_model_coefficients_id);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_model_coefficients_id);
-    glBufferData(GL_ARRAY_BUFFER, model_coefficients.size() * sizeof(float), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, model_coefficients.size() * sizeof(float), model_coefficients.data());
-    GLuint location = 0;            // "(location = 0)" em "shader_vertex.glsl"
-    GLint number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
-    glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(location);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    if (!normal_coefficients.empty())
-    {
-        GLuint VBO_normal_coefficients_id;
-        glGenBuffers(1, &VBO_normal_coefficients_id);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO_normal_coefficients_id);
-        glBufferData(GL_ARRAY_BUFFER, normal_coefficients.size() * sizeof(float), NULL, GL_STATIC_DRAW);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, normal_coefficients.size() * sizeof(float), normal_coefficients.data());
-        location = 1;             // "(location = 1)" em "shader_vertex.glsl"
-        number_of_dimensions = 4; // vec4 em "shader_vertex.glsl"
-        glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-        glEnableVertexAttribArray(location);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-    }
-
-    if (!texture_coefficients.empty())
-    {
-        GLuint VBO_texture_coefficients_id;
-        glGenBuffers(1, &VBO_texture_coefficients_id);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO_texture_coefficients_id);
-        glBufferData(GL_ARRAY_BUFFER, texture_coefficients.size() * sizeof(float), NULL, GL_STATIC_DRAW);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, texture_coefficients.size() * sizeof(float), texture_coefficients.data());
-        location = 2;             // "(location = 1)" em "shader_vertex.glsl"
-        number_of_dimensions = 2; // vec2 em "shader_vertex.glsl"
-        glVertexAttribPointer(location, number_of_dimensions, GL_FLOAT, GL_FALSE, 0, 0);
-        glEnableVertexAttribArray(location);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-    }
-
-    GLuint indices_id;
-    glGenBuffers(1, &indices_id);
-
-    // "Ligamos" o buffer. Note que o tipo agora é GL_ELEMENT_ARRAY_BUFFER.
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices_id);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), NULL, GL_STATIC_DRAW);
-    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indices.size() * sizeof(GLuint), indices.data());
-
-    // "Desligamos" o VAO, evitando assim que operações posteriores venham a
-    // alterar o mesmo. Isso evita bugs.
-    glBindVertexArray(0);
+        for (int i = 0; i < 3; ++i)
+        {
+            vertices[i][8] = u[i];
+            vertices[i][9] = v[i];
+        }
+    }
 }
 
 bool collisionTest(glm::vec4 position)
@@ -1334,7 +3951,128 @@ bool collisionTest(glm::vec4 position)
     return false;
 }
 
-glm::mat4 bezierTipCurve() // Usado apenas para as duas curvas da esfera de dica da primeira sala
+// Avança a simulação em um passo de "dt" segundos: move a câmera livre com as
+// teclas WASD pressionadas (respeitando as colisões; veja collisionTest()), e
+// avança as animações da esfera de dica e do globo.
+void SimulationStep(float dt)
+{
+    float step_size = 2.0f;
+    float g_camX_temp = g_camX; //Distancia X da camera
+    float g_camY_temp = g_camY; // Distancia Y da camera
+    float g_camZ_temp = g_camZ; //Distancia Z da camera
+    glm::vec4 new_pos = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+    if (!g_lookAt)
+    {
+        if (g_KeyPressedS)
+        {
+            g_camX_temp -= dt * step_size * sin(g_CameraTheta);
+            g_camZ_temp -= dt * step_size * cos(g_CameraTheta);
+        }
+        else if (g_KeyPressedD)
+        {
+            g_camX_temp -= dt * step_size * cos(g_CameraPhi) * cos(g_CameraTheta);
+            g_camZ_temp += dt * step_size * cos(g_CameraPhi) * sin(g_CameraTheta);
+        }
+        else if (g_KeyPressedW)
+        {
+            g_camX_temp += dt * step_size * cos(g_CameraPhi) * sin(g_CameraTheta);
+            g_camZ_temp += dt * step_size * cos(g_CameraPhi) * cos(g_CameraTheta);
+        }
+        else if (g_KeyPressedA)
+        {
+            g_camX_temp += dt * step_size * cos(g_CameraPhi) * cos(g_CameraTheta);
+            g_camZ_temp -= dt * step_size * cos(g_CameraPhi) * sin(g_CameraTheta);
+        }
+
+        new_pos = glm::vec4(g_camX_temp, g_camY_temp, g_camZ_temp, 1.0f);
+        if (!collisionTest(new_pos))
+        {
+            g_camX = g_camX_temp;
+            g_camY = g_camY_temp;
+            g_camZ = g_camZ_temp;
+        }
+    }
+
+    // A esfera de dica percorre as duas curvas de Bézier (t de 0 a 2) em
+    // vai e vem.
+    if (bezierAux >= 2)
+        bezierAux2 = 1;
+    if (bezierAux <= 0)
+        bezierAux2 = 0;
+
+    if (bezierAux2 == 1)
+        bezierAux -= dt * 0.125;
+    if (bezierAux2 == 0)
+        bezierAux += dt * 0.125;
+
+    g_GlobeAngle += dt * 0.1f;
+
+    g_SimulationStepCount += 1;
+}
+
+// Soma de verificação (FNV-1a) de todo o estado do jogo alterado pelos
+// eventos de entrada e pela simulação. A reprodução de uma gravação deve
+// chegar à mesma soma da gravação, no mesmo passo.
+unsigned int SimulationChecksum()
+{
+    float floats[] = {g_camX, g_camY, g_camZ, g_CameraTheta, g_CameraPhi, g_CameraDistance,
+                      bezierAux, g_GlobeAngle, g_AngleX, g_AngleY, g_AngleZ};
+    int ints[] = {door1open, door2open, lever1act, lever2act, lever3act, lever4act, lever5act, lever6act, lever7act,
+                  woodenChairRotation, woodenZ1Rotation, woodenZ2Rotation, woodenZ3Rotation, bezierAux2,
+                  g_lookAt, endGame, g_KeyPressedW, g_KeyPressedA, g_KeyPressedS, g_KeyPressedD};
+
+    unsigned int hash = 2166136261u;
+    const unsigned char *bytes[2] = {(const unsigned char *)floats, (const unsigned char *)ints};
+    size_t sizes[2] = {sizeof(floats), sizeof(ints)};
+    for (int i = 0; i < 2; ++i)
+        for (size_t j = 0; j < sizes[i]; ++j)
+            hash = (hash ^ bytes[i][j]) * 16777619u;
+    return hash;
+}
+
+SimulationState CurrentSimulationState()
+{
+    SimulationState state;
+    state.camera_position = glm::vec4(g_camX, g_camY, g_camZ, 1.0f);
+    state.bezier_t = bezierAux;
+    state.globe_angle = g_GlobeAngle;
+    return state;
+}
+
+// Acumula "frame_seconds" e executa tantos passos fixos da simulação quantos
+// couberem no tempo acumulado. O tempo restante (menor que um passo) define a
+// fração "alpha" entre o penúltimo e o último passo, e o estado retornado é a
+// interpolação linear entre os dois: assim o movimento é suave a qualquer
+// taxa de quadros, ao custo de até um passo de atraso.
+SimulationState UpdateSimulation(double frame_seconds)
+{
+    static bool initialized = false;
+    if (!initialized)
+    {
+        g_SimulationPrevious = CurrentSimulationState();
+        initialized = true;
+    }
+
+    g_SimulationAccumulator += std::min(frame_seconds, SIMULATION_MAX_FRAME_SECONDS);
+    while (g_SimulationAccumulator >= SIMULATION_STEP_SECONDS)
+    {
+        g_SimulationPrevious = CurrentSimulationState();
+        SimulationStep((float)SIMULATION_STEP_SECONDS);
+        g_SimulationAccumulator -= SIMULATION_STEP_SECONDS;
+    }
+
+    float alpha = (float)(g_SimulationAccumulator / SIMULATION_STEP_SECONDS);
+    SimulationState current = CurrentSimulationState();
+
+    SimulationState state;
+    state.camera_position = g_SimulationPrevious.camera_position + alpha * (current.camera_position - g_SimulationPrevious.camera_position);
+    state.bezier_t = g_SimulationPrevious.bezier_t + alpha * (current.bezier_t - g_SimulationPrevious.bezier_t);
+    state.globe_angle = g_SimulationPrevious.globe_angle + alpha * (current.globe_angle - g_SimulationPrevious.globe_angle);
+    return state;
+}
+
+glm::mat4 bezierTipCurve(float t) // Usado apenas para as duas curvas da esfera de dica da primeira sala; t de 0 a 2 (veja SimulationStep())
 {
     glm::vec3 p0 = glm::vec3(-2.39f, 1.0f, -1.7f);
 
@@ -1348,61 +4086,51 @@ glm::mat4 bezierTipCurve() // Usado apenas para as duas curvas da esfera de dica
 
     glm::vec3 p6 = glm::vec3(-2.39f, 1.2f, 0.55f);
 
-    if (bezierAux >= 2)
-        bezierAux2 = 1;
-    if (bezierAux <= 0)
-        bezierAux2 = 0;
-
-    if (bezierAux2 == 1)
-        bezierAux -= ellapsed_s * 0.125;
-    if (bezierAux2 == 0)
-        bezierAux += ellapsed_s * 0.125;
-
     //curva 1
-    glm::vec3 c_01 = p0 + bezierAux * (p1 - p0);
-    glm::vec3 c_12 = p1 + bezierAux * (p2 - p1);
-    glm::vec3 c_23 = p2 + bezierAux * (p3 - p2);
-    glm::vec3 c_01_12 = c_01 + bezierAux * (c_12 - c_01);
-    glm::vec3 c_12_23 = c_12 + bezierAux * (c_23 - c_12);
-    glm::vec3 c_01_12_23 = c_01_12 + bezierAux * (c_12_23 - c_01_12);
+    glm::vec3 c_01 = p0 + t * (p1 - p0);
+    glm::vec3 c_12 = p1 + t * (p2 - p1);
+    glm::vec3 c_23 = p2 + t * (p3 - p2);
+    glm::vec3 c_01_12 = c_01 + t * (c_12 - c_01);
+    glm::vec3 c_12_23 = c_12 + t * (c_23 - c_12);
+    glm::vec3 c_01_12_23 = c_01_12 + t * (c_12_23 - c_01_12);
 
     //curva 1
-    glm::vec3 c_34 = p3 + (bezierAux - 1) * (p4 - p3);
-    glm::vec3 c_45 = p4 + (bezierAux - 1) * (p5 - p4);
-    glm::vec3 c_56 = p5 + (bezierAux - 1) * (p6 - p5);
-    glm::vec3 c_34_45 = c_34 + (bezierAux - 1) * (c_45 - c_34);
-    glm::vec3 c_45_56 = c_45 + (bezierAux - 1) * (c_56 - c_45);
-    glm::vec3 c_34_45_56 = c_34_45 + (bezierAux - 1) * (c_45_56 - c_34_45);
-
-    if (bezierAux <= 1.000)
+    glm::vec3 c_34 = p3 + (t - 1) * (p4 - p3);
+    glm::vec3 c_45 = p4 + (t - 1) * (p5 - p4);
+    glm::vec3 c_56 = p5 + (t - 1) * (p6 - p5);
+    glm::vec3 c_34_45 = c_34 + (t - 1) * (c_45 - c_34);
+    glm::vec3 c_45_56 = c_45 + (t - 1) * (c_56 - c_45);
+    glm::vec3 c_34_45_56 = c_34_45 + (t - 1) * (c_45_56 - c_34_45);
+
+    if (t <= 1.000)
         return Matrix_Translate(c_01_12_23.x, c_01_12_23.y, c_01_12_23.z);
     else
         return Matrix_Translate(c_34_45_56.x, c_34_45_56.y, c_34_45_56.z);
 }
 
 // Carrega um Vertex Shader de um arquivo GLSL. Veja definição de LoadShader() abaixo.
-GLuint LoadShader_Vertex(const char *filename)
+GLuint LoadShader_Vertex(const char *filename, const char *defines)
 {
     // Criamos um identificador (ID) para este shader, informando que o mesmo
     // será aplicado nos vértices.
     GLuint vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
 
     // Carregamos e compilamos o shader
-    LoadShader(filename, vertex_shader_id);
+    LoadShader(filename, vertex_shader_id, defines);
 
     // Retorna o ID gerado acima
     return vertex_shader_id;
 }
 
 // Carrega um Fragment Shader de um arquivo GLSL . Veja definição de LoadShader() abaixo.
-GLuint LoadShader_Fragment(const char *filename)
+GLuint LoadShader_Fragment(const char *filename, const char *defines)
 {
     // Criamos um identificador (ID) para este shader, informando que o mesmo
     // será aplicado nos fragmentos.
     GLuint fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
 
     // Carregamos e compilamos o shader
-    LoadShader(filename, fragment_shader_id);
+    LoadShader(filename, fragment_shader_id, defines);
 
     // Retorna o ID gerado acima
     return fragment_shader_id;
@@ -1410,7 +4138,15 @@ GLuint LoadShader_Fragment(const char *filename)
 
 // Função auxilar, utilizada pelas duas funções acima. Carrega código de GPU de
 // um arquivo GLSL e faz sua compilação.
-void LoadShader(const char *filename, GLuint shader_id)
+void LoadShader(const char *filename, GLuint shader_id, const char *defines)
+{
+    CompileShader(LoadShaderSource(filename, defines), shader_id, filename);
+}
+
+// Lê o código de GPU de um arquivo GLSL. Caso "defines" não seja NULL, o seu
+// conteúdo (por exemplo "#define MULTI_DRAW\n") é inserido logo após a
+// primeira linha do arquivo, a qual deve conter a diretiva "#version".
+std::string LoadShaderSource(const char *filename, const char *defines)
 {
     // Lemos o arquivo de texto indicado pela variável "filename"
     // e colocamos seu conteúdo em memória, apontado pela variável
@@ -1429,8 +4165,20 @@ void LoadShader(const char *filename, GLuint shader_id)
     std::stringstream shader;
     shader << file.rdbuf();
     std::string str = shader.str();
-    const GLchar *shader_string = str.c_str();
-    const GLint shader_string_length = static_cast<GLint>(str.length());
+    if (defines != NULL && defines[0] != '\0')
+    {
+        std::string::size_type first_line_end = str.find('\n') + 1;
+        str.insert(first_line_end, std::string(defines) + "#line 2\n");
+    }
+    return str;
+}
+
+// Compila o código de GPU "source", lido do arquivo "filename" (utilizado
+// somente nas mensagens de erro), no shader "shader_id".
+void CompileShader(const std::string &source, GLuint shader_id, const char *filename)
+{
+    const GLchar *shader_string = source.c_str();
+    const GLint shader_string_length = static_cast<GLint>(source.length());
 
     // Define o código do shader GLSL, contido na string "shader_string"
     glShaderSource(shader_id, 1, &shader_string, &shader_string_length);
@@ -1438,7 +4186,14 @@ void LoadShader(const char *filename, GLuint shader_id)
     // Compila o código do shader GLSL (em tempo de execução)
     glCompileShader(shader_id);
 
-    // Verificamos se ocorreu algum erro ou "warning" durante a compilação
+    CheckShaderCompilation(shader_id, filename);
+}
+
+// Verificamos se ocorreu algum erro ou "warning" durante a compilação do
+// shader "shader_id", imprimindo o log no terminal. Retorna true se o shader
+// foi compilado com sucesso.
+bool CheckShaderCompilation(GLuint shader_id, const char *filename)
+{
     GLint compiled_ok;
     glGetShaderiv(shader_id, GL_COMPILE_STATUS, &compiled_ok);
 
@@ -1479,6 +4234,8 @@ void LoadShader(const char *filename, GLuint shader_id)
 
     // A chamada "delete" em C++ é equivalente ao "free()" do C
     delete[] log;
+
+    return compiled_ok == GL_TRUE;
 }
 
 // Esta função cria um programa de GPU, o qual contém obrigatoriamente um
@@ -1492,10 +4249,26 @@ GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id)
     glAttachShader(program_id, vertex_shader_id);
     glAttachShader(program_id, fragment_shader_id);
 
-    // Linkagem dos shaders acima ao programa
+    // Linkagem dos shaders acima ao programa, guardando o binário resultante
+    // caso o cache de programas esteja habilitado (veja LoadGpuProgram()).
+    ProgramCache_PrepareLink(program_id);
     glLinkProgram(program_id);
 
-    // Verificamos se ocorreu algum erro durante a linkagem
+    CheckProgramLinking(program_id);
+
+    // Os "Shader Objects" podem ser marcados para deleção após serem linkados
+    glDeleteShader(vertex_shader_id);
+    glDeleteShader(fragment_shader_id);
+
+    // Retornamos o ID gerado acima
+    return program_id;
+}
+
+// Verificamos se ocorreu algum erro durante a linkagem do programa
+// "program_id", imprimindo o log no terminal. Retorna true se o programa foi
+// linkado com sucesso.
+bool CheckProgramLinking(GLuint program_id)
+{
     GLint linked_ok = GL_FALSE;
     glGetProgramiv(program_id, GL_LINK_STATUS, &linked_ok);
 
@@ -1524,24 +4297,244 @@ GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id)
         fprintf(stderr, "%s", output.c_str());
     }
 
-    // Os "Shader Objects" podem ser marcados para deleção após serem linkados
-    glDeleteShader(vertex_shader_id);
-    glDeleteShader(fragment_shader_id);
+    return linked_ok == GL_TRUE;
+}
 
-    // Retornamos o ID gerado acima
+// Cria um programa de GPU a partir dos arquivos GLSL de um Vertex Shader e de
+// um Fragment Shader, com os "#define" dados (veja LoadShaderSource()). O
+// programa é carregado do cache de programas (veja "programcache.cpp") se os
+// mesmos shaders já foram linkados pelo mesmo driver; caso contrário é
+// compilado, e o binário resultante é guardado no cache.
+GLuint LoadGpuProgram(const char *vertex_filename, const char *vertex_defines, const char *fragment_filename, const char *fragment_defines)
+{
+    std::string vertex_source = LoadShaderSource(vertex_filename, vertex_defines);
+    std::string fragment_source = LoadShaderSource(fragment_filename, fragment_defines);
+
+    GLuint program_id = ProgramCache_Load(vertex_source, fragment_source);
+    if (program_id != 0)
+        return program_id;
+
+    GLuint vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
+    CompileShader(vertex_source, vertex_shader_id, vertex_filename);
+
+    GLuint fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
+    CompileShader(fragment_source, fragment_shader_id, fragment_filename);
+
+    program_id = CreateGpuProgram(vertex_shader_id, fragment_shader_id);
+    ProgramCache_Store(vertex_source, fragment_source, program_id);
     return program_id;
 }
 
+// Inicia a observação dos arquivos GLSL em "src/" (veja "shaderwatcher.cpp"),
+// para que os shaders sejam recarregados assim que forem salvos, e habilita a
+// compilação paralela do driver, caso disponível.
+void InitShaderReload()
+{
+    // A versão ARB da extensão é idêntica, com o sufixo ARB na função.
+    bool has_khr = HasOpenGLExtension("GL_KHR_parallel_shader_compile");
+    bool has_arb = HasOpenGLExtension("GL_ARB_parallel_shader_compile");
+    g_HasParallelShaderCompile = has_khr || has_arb;
+    if (g_HasParallelShaderCompile)
+    {
+        // O valor 0xFFFFFFFF deixa a escolha do número de threads ao driver.
+        MaxShaderCompilerThreadsProc glMaxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)GetGLProcAddress(has_khr ? "glMaxShaderCompilerThreadsKHR" : "glMaxShaderCompilerThreadsARB");
+        if (glMaxShaderCompilerThreads != NULL)
+            glMaxShaderCompilerThreads(0xFFFFFFFF);
+    }
+
+    bool watching = ShaderWatcher_Start("../../src", ".glsl");
+
+    printf("Recarga dos shaders: %s, compilação %s\n",
+           watching ? "automática ao salvar \"src/*.glsl\"" : "somente pela tecla R",
+           g_HasParallelShaderCompile ? "paralela (KHR_parallel_shader_compile)" : "de um programa por quadro");
+}
+
+// Inicia a recompilação de todos os programas de GPU a partir dos arquivos de
+// shaders. Os programas em uso continuam sendo utilizados até que todos os
+// novos programas estejam prontos; veja UpdateShaderReload(). Uma
+// recompilação em andamento é descartada e reiniciada com os arquivos atuais.
+void BeginShaderReload()
+{
+    CancelShaderReload();
+
+    // Editores podem remover o arquivo momentaneamente ao salvá-lo.
+    if (!std::ifstream("../../src/shader_vertex.glsl") || !std::ifstream("../../src/shader_fragment.glsl"))
+    {
+        fprintf(stderr, "WARNING: Cannot open shader files, keeping the current programs.\n");
+        return;
+    }
+
+    std::vector<ShaderProgramSource> programs;
+    CollectShaderPrograms(programs);
+
+    g_PendingShaderPrograms.resize(programs.size());
+    for (size_t i = 0; i < programs.size(); ++i)
+    {
+        PendingShaderProgram &pending = g_PendingShaderPrograms[i];
+        pending.target = programs[i].program_id;
+        pending.vertex_source = LoadShaderSource("../../src/shader_vertex.glsl", programs[i].vertex_defines.c_str());
+        pending.fragment_source = LoadShaderSource("../../src/shader_fragment.glsl", programs[i].fragment_defines.c_str());
+        pending.program_id = 0;
+        pending.vertex_shader_id = 0;
+        pending.fragment_shader_id = 0;
+    }
+}
+
+// Inicia a compilação de um programa pendente. Com KHR_parallel_shader_compile
+// as chamadas abaixo retornam imediatamente, e os erros de compilação só são
+// consultados quando o programa estiver pronto (GL_COMPLETION_STATUS_KHR),
+// pois consultá-los antes bloquearia até o fim da compilação.
+static void StartPendingShaderProgram(PendingShaderProgram &pending)
+{
+    pending.program_id = ProgramCache_Load(pending.vertex_source, pending.fragment_source);
+    if (pending.program_id != 0)
+        return;
+
+    const GLchar *vertex_string = pending.vertex_source.c_str();
+    const GLchar *fragment_string = pending.fragment_source.c_str();
+
+    pending.vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(pending.vertex_shader_id, 1, &vertex_string, NULL);
+    glCompileShader(pending.vertex_shader_id);
+
+    pending.fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(pending.fragment_shader_id, 1, &fragment_string, NULL);
+    glCompileShader(pending.fragment_shader_id);
+
+    pending.program_id = glCreateProgram();
+    glAttachShader(pending.program_id, pending.vertex_shader_id);
+    glAttachShader(pending.program_id, pending.fragment_shader_id);
+    ProgramCache_PrepareLink(pending.program_id);
+    glLinkProgram(pending.program_id);
+}
+
+// Avança a recompilação dos shaders; chamada uma vez por quadro. Inicia uma
+// recompilação quando a thread de observação notifica que algum arquivo GLSL
+// foi salvo; inicia a compilação dos programas pendentes (todos de uma vez
+// com compilação paralela, ou um por quadro sem ela, pois neste caso cada
+// compilação bloqueia a thread principal); e, quando todos estiverem prontos,
+// substitui os programas em uso. Se algum shader tiver erros, os programas em
+// uso são mantidos, e a recompilação ocorre novamente no próximo salvamento.
+void UpdateShaderReload()
+{
+    static std::vector<std::string> changed;
+    if (ShaderWatcher_PollChanges(changed))
+    {
+        for (size_t i = 0; i < changed.size(); ++i)
+            printf("Shader alterado: \"%s\"\n", changed[i].c_str());
+        BeginShaderReload();
+    }
+
+    if (g_PendingShaderPrograms.empty())
+        return;
+
+    bool started = false;
+    for (size_t i = 0; i < g_PendingShaderPrograms.size(); ++i)
+    {
+        PendingShaderProgram &pending = g_PendingShaderPrograms[i];
+        if (pending.program_id == 0)
+        {
+            if (started && !g_HasParallelShaderCompile)
+                return;
+            StartPendingShaderProgram(pending);
+            started = true;
+        }
+    }
+
+    if (g_HasParallelShaderCompile)
+    {
+        for (size_t i = 0; i < g_PendingShaderPrograms.size(); ++i)
+        {
+            const PendingShaderProgram &pending = g_PendingShaderPrograms[i];
+            if (pending.vertex_shader_id == 0)
+                continue;
+
+            GLint completed = GL_FALSE;
+            glGetProgramiv(pending.program_id, GL_COMPLETION_STATUS_KHR, &completed);
+            if (completed == GL_FALSE)
+                return;
+        }
+    }
+
+    // Todos os programas estão prontos. Imprimimos somente os erros do
+    // primeiro programa com problemas, já que todos compartilham os mesmos
+    // arquivos.
+    bool ok = true;
+    for (size_t i = 0; i < g_PendingShaderPrograms.size() && ok; ++i)
+    {
+        const PendingShaderProgram &pending = g_PendingShaderPrograms[i];
+        if (pending.vertex_shader_id == 0)
+            continue;
+
+        ok = CheckShaderCompilation(pending.vertex_shader_id, "../../src/shader_vertex.glsl") &&
+             CheckShaderCompilation(pending.fragment_shader_id, "../../src/shader_fragment.glsl") &&
+             CheckProgramLinking(pending.program_id);
+    }
+
+    if (!ok)
+    {
+        fprintf(stderr, "WARNING: Shader reload failed, keeping the current programs.\n");
+        CancelShaderReload();
+        return;
+    }
+
+    for (size_t i = 0; i < g_PendingShaderPrograms.size(); ++i)
+    {
+        PendingShaderProgram &pending = g_PendingShaderPrograms[i];
+        if (pending.vertex_shader_id != 0)
+        {
+            ProgramCache_Store(pending.vertex_source, pending.fragment_source, pending.program_id);
+            glDeleteShader(pending.vertex_shader_id);
+            glDeleteShader(pending.fragment_shader_id);
+        }
+
+        if (*pending.target != 0)
+            glDeleteProgram(*pending.target);
+        *pending.target = pending.program_id;
+    }
+
+    printf("Shaders recarregados! (%d programas)\n", (int)g_PendingShaderPrograms.size());
+    fflush(stdout);
+
+    g_PendingShaderPrograms.clear();
+    LookupShaderUniforms();
+
+    std::lock_guard<std::mutex> lock(g_SimulationMutex);
+    RequestRedraw();
+}
+
+// Descarta os programas de uma recompilação em andamento, mantendo os
+// programas em uso.
+void CancelShaderReload()
+{
+    for (size_t i = 0; i < g_PendingShaderPrograms.size(); ++i)
+    {
+        PendingShaderProgram &pending = g_PendingShaderPrograms[i];
+        if (pending.vertex_shader_id != 0)
+        {
+            glDeleteShader(pending.vertex_shader_id);
+            glDeleteShader(pending.fragment_shader_id);
+        }
+        if (pending.program_id != 0)
+            glDeleteProgram(pending.program_id);
+    }
+    g_PendingShaderPrograms.clear();
+}
+
 // Definição da função que será chamada sempre que a janela do sistema
 // operacional for redimensionada, por consequência alterando o tamanho do
 // "framebuffer" (região de memória onde são armazenados os pixels da imagem).
 void FramebufferSizeCallback(GLFWwindow *window, int width, int height)
 {
+    std::lock_guard<std::mutex> lock(g_SimulationMutex);
+
     // Indicamos que queremos renderizar em toda região do framebuffer. A
     // função "glViewport" define o mapeamento das "normalized device
     // coordinates" (NDC) para "pixel coordinates".  Essa é a operação de
     // "Screen Mapping" ou "Viewport Mapping" vista em aula ({+ViewportMapping2+}).
     glViewport(0, 0, width, height);
+    g_FramebufferWidth = width;
+    g_FramebufferHeight = height;
 
     // Atualizamos também a razão que define a proporção da janela (largura /
     // altura), a qual será utilizada na definição das matrizes de projeção,
@@ -1551,6 +4544,24 @@ void FramebufferSizeCallback(GLFWwindow *window, int width, int height)
     // O cast para float é necessário pois números inteiros são arredondados ao
     // serem divididos!
     g_ScreenRatio = (float)width / height;
+
+    // O texto é posicionado em coordenadas de tela, as quais diferem das
+    // coordenadas do framebuffer em monitores de alta densidade. Sem janela
+    // (veja "offscreen.cpp"), as duas coincidem.
+    int window_width = width, window_height = height;
+    if (window != NULL)
+        glfwGetWindowSize(window, &window_width, &window_height);
+    TextRendering_SetWindowSize(window_width, window_height);
+
+    RequestRedraw();
+}
+
+// Função callback chamada quando o conteúdo da janela foi perdido e precisa
+// ser redesenhado, mesmo sem mudanças na cena.
+void WindowRefreshCallback(GLFWwindow *window)
+{
+    std::lock_guard<std::mutex> lock(g_SimulationMutex);
+    RequestRedraw();
 }
 
 // Variáveis globais que armazenam a última posição do cursor do mouse, para
@@ -1561,6 +4572,16 @@ double g_LastCursorPosX, g_LastCursorPosY;
 // Função callback chamada sempre que o usuário aperta algum dos botões do mouse
 void MouseButtonCallback(GLFWwindow *window, int button, int action, int mods)
 {
+    std::lock_guard<std::mutex> lock(g_SimulationMutex);
+
+    // Na reprodução, a posição do cursor é a gravada com o evento.
+    double xpos, ypos;
+    if (g_InputReplay)
+        InputReplay_CursorPos(&xpos, &ypos);
+    else
+        glfwGetCursorPos(window, &xpos, &ypos);
+    InputRecord_MouseButton(g_SimulationStepCount, button, action, mods, xpos, ypos);
+
     if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS)
     {
         // Se o usuário pressionou o botão esquerdo do mouse, guardamos a
@@ -1568,15 +4589,21 @@ void MouseButtonCallback(GLFWwindow *window, int button, int action, int mods)
         // g_LastCursorPosY.  Também, setamos a variável
         // g_LeftMouseButtonPressed como true, para saber que o usuário está
         // com o botão esquerdo pressionado.
-        glfwGetCursorPos(window, &g_LastCursorPosX, &g_LastCursorPosY);
+        g_LastCursorPosX = xpos;
+        g_LastCursorPosY = ypos;
         g_LeftMouseButtonPressed = !g_LeftMouseButtonPressed;
     }
+
+    RequestRedraw();
 }
 
 // Função callback chamada sempre que o usuário movimentar o cursor do mouse em
 // cima da janela OpenGL.
 void CursorPosCallback(GLFWwindow *window, double xpos, double ypos)
 {
+    std::lock_guard<std::mutex> lock(g_SimulationMutex);
+    InputRecord_CursorPos(g_SimulationStepCount, xpos, ypos);
+
     // Abaixo executamos o seguinte: caso o botão esquerdo do mouse esteja
     // pressionado, computamos quanto que o mouse se movimento desde o último
     // instante de tempo, e usamos esta movimentação para atualizar os
@@ -1586,6 +4613,8 @@ void CursorPosCallback(GLFWwindow *window, double xpos, double ypos)
     if (!g_LeftMouseButtonPressed)
         return;
 
+    RequestRedraw();
+
     // Deslocamento do cursor do mouse em x e y de coordenadas de tela!
     float dx = xpos - g_LastCursorPosX;
     float dy = ypos - g_LastCursorPosY;
@@ -1620,6 +4649,9 @@ void CursorPosCallback(GLFWwindow *window, double xpos, double ypos)
 // Função callback chamada sempre que o usuário movimenta a "rodinha" do mouse.
 void ScrollCallback(GLFWwindow *window, double xoffset, double yoffset)
 {
+    std::lock_guard<std::mutex> lock(g_SimulationMutex);
+    InputRecord_Scroll(g_SimulationStepCount, xoffset, yoffset);
+
     // Atualizamos a distância da câmera para a origem utilizando a
     // movimentação da "rodinha", simulando um ZOOM.
     g_CameraDistance -= 0.1f * yoffset;
@@ -1632,6 +4664,8 @@ void ScrollCallback(GLFWwindow *window, double xoffset, double yoffset)
     const float verysmallnumber = std::numeric_limits<float>::epsilon();
     if (g_CameraDistance < verysmallnumber)
         g_CameraDistance = verysmallnumber;
+
+    RequestRedraw();
 }
 
 // Definição da função que será chamada sempre que o usuário pressionar alguma
@@ -1646,8 +4680,16 @@ void KeyCallback(GLFWwindow *window, int key, int scancode, int action, int mod)
             std::exit(100 + i);
     // ==============
 
+    // O estado do jogo é lido pela thread de simulação (veja g_SimulationMutex).
+    std::lock_guard<std::mutex> lock(g_SimulationMutex);
+    InputRecord_Key(g_SimulationStepCount, key, scancode, action, mod);
+
+    // Qualquer tecla pode alterar o estado do jogo ou da visualização.
+    RequestRedraw();
+
     // Se o usuário pressionar a tecla ESC, fechamos a janela.
-    if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
+    // Sem janela (reprodução com "--headless"), não há o que fechar.
+    if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS && window != NULL)
         glfwSetWindowShouldClose(window, GL_TRUE);
 
     // O código abaixo implementa a seguinte lógica:
@@ -1693,11 +4735,71 @@ void KeyCallback(GLFWwindow *window, int key, int scancode, int action, int mod)
     }
 
     // Se o usuário apertar a tecla R, recarregamos os shaders dos arquivos "shader_fragment.glsl" e "shader_vertex.glsl".
+    // A recompilação ocorre em segundo plano; veja UpdateShaderReload().
     if (key == GLFW_KEY_R && action == GLFW_PRESS)
     {
-        LoadShadersFromFiles();
-        fprintf(stdout, "Shaders recarregados!\n");
-        fflush(stdout);
+        BeginShaderReload();
+    }
+
+    // Se o usuário apertar a tecla M, alternamos entre os backends de submissão
+    // da lista de desenho (um objeto por chamada ou em lote).
+    if (key == GLFW_KEY_M && action == GLFW_PRESS)
+    {
+        g_DrawBackend = (g_DrawBackend == DRAW_BACKEND_PER_OBJECT) ? DRAW_BACKEND_MULTI_DRAW : DRAW_BACKEND_PER_OBJECT;
+    }
+
+    // Se o usuário apertar a tecla C, ligamos/desligamos o frustum culling
+    // da lista de desenho.
+    if (key == GLFW_KEY_C && action == GLFW_PRESS)
+    {
+        g_FrustumCulling = !g_FrustumCulling;
+    }
+
+    // Se o usuário apertar a tecla E, ligamos/desligamos a passada de
+    // profundidade (veja SubmitDrawList()).
+    if (key == GLFW_KEY_E && action == GLFW_PRESS)
+    {
+        g_DepthPrepass = !g_DepthPrepass;
+    }
+
+    // Se o usuário apertar a tecla K, ligamos/desligamos a oclusão por
+    // software, e com a tecla B mostramos/escondemos o seu Z-buffer.
+    if (key == GLFW_KEY_K && action == GLFW_PRESS)
+    {
+        g_SoftwareOcclusion = !g_SoftwareOcclusion;
+    }
+    if (key == GLFW_KEY_B && action == GLFW_PRESS)
+    {
+        g_ShowOcclusionBuffer = !g_ShowOcclusionBuffer;
+    }
+
+    // Se o usuário apertar a tecla Q, ligamos/desligamos as consultas de
+    // oclusão dos objetos pesados.
+    if (key == GLFW_KEY_Q && action == GLFW_PRESS)
+    {
+        g_OcclusionQueries = !g_OcclusionQueries;
+    }
+
+    // Se o usuário apertar a tecla G, gravamos o trace do profiler de CPU
+    // (veja g_ProfilerDumpRequested).
+    if (key == GLFW_KEY_G && action == GLFW_PRESS)
+    {
+        g_ProfilerDumpRequested = true;
+    }
+
+    // Se o usuário apertar a tecla T, ligamos/desligamos a thread de
+    // simulação (veja g_UseSimulationThread). A thread é iniciada ou
+    // terminada pelo laço principal, fora deste callback.
+    if (key == GLFW_KEY_T && action == GLFW_PRESS)
+    {
+        g_UseSimulationThread = !g_UseSimulationThread;
+    }
+
+    // Se o usuário apertar a tecla V, ligamos/desligamos o culling por portais
+    // (salas visíveis através das portas abertas).
+    if (key == GLFW_KEY_V && action == GLFW_PRESS)
+    {
+        g_PortalCulling = !g_PortalCulling;
     }
 
     //Tecla F alterna entre os tipos de câmera (look-at previamente implementada no código original e free-cam implementada através das modificações nesse arquivo main).
@@ -1832,11 +4934,11 @@ void KeyCallback(GLFWwindow *window, int key, int scancode, int action, int mod)
     {
         isCursorEnabled = !isCursorEnabled;
         showControlMessage = !showControlMessage;
-        if (isCursorEnabled)
-            glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
-        else
-            glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+        if (window != NULL)
+            glfwSetInputMode(window, GLFW_CURSOR, isCursorEnabled ? GLFW_CURSOR_NORMAL : GLFW_CURSOR_DISABLED);
     }
+
+    UpdateDoorState();
 }
 
 // Definimos o callback para impressão de erros da GLFW no terminal
@@ -1917,10 +5019,11 @@ void TextRendering_ShowEulerAngles(GLFWwindow *window)
     char buffer[80];
     snprintf(buffer, 80, "Euler Angles rotation matrix = Z(%.2f)*Y(%.2f)*X(%.2f)\n", g_AngleZ, g_AngleY, g_AngleX);
 
-    TextRendering_PrintString(window, "Press Space to Open Controls Window", -1.0f + pad / 10, -1.0f + 2 * pad / 10, 1.0f);
+    static int layout = TextRendering_NewLayout();
+    TextRendering_PrintLayout(window, layout, "Press Space to Open Controls Window", -1.0f + pad / 10, -1.0f + 2 * pad / 10, 1.0f);
 }
-// Escrevemos na tela qual matriz de projeção está sendo utilizada.
-void TextRendering_ShowProjection(GLFWwindow *window)
+// Escrevemos na tela qual matriz de projeção foi utilizada no pacote.
+void TextRendering_ShowProjection(GLFWwindow *window, const FramePacket &packet)
 {
     if (!g_ShowInfoText)
         return;
@@ -1928,10 +5031,8 @@ void TextRendering_ShowProjection(GLFWwindow *window)
     float lineheight = TextRendering_LineHeight(window);
     float charwidth = TextRendering_CharWidth(window);
 
-    if (g_UsePerspectiveProjection)
-        TextRendering_PrintString(window, "Perspective", 1.0f - 13 * charwidth, -1.0f + 2 * lineheight / 10, 1.0f);
-    else
-        TextRendering_PrintString(window, "Orthographic", 1.0f - 13 * charwidth, -1.0f + 2 * lineheight / 10, 1.0f);
+    static int layout = TextRendering_NewLayout();
+    TextRendering_PrintLayout(window, layout, packet.projection_text, 1.0f - 13 * charwidth, -1.0f + 2 * lineheight / 10, 1.0f);
 }
 
 // Escrevemos na tela o número de quadros renderizados por segundo (frames per
@@ -1943,22 +5044,28 @@ void TextRendering_ShowFramesPerSecond(GLFWwindow *window)
 
     // Variáveis estáticas (static) mantém seus valores entre chamadas
     // subsequentes da função!
-    static float old_seconds = (float)glfwGetTime();
+    static float old_seconds = (float)GetTimeSeconds();
     static int ellapsed_frames = 0;
-    static char buffer[20] = "?? fps";
+    static char buffer[120] = "?? fps";
     static int numchars = 7;
 
     ellapsed_frames += 1;
 
     // Recuperamos o número de segundos que passou desde a execução do programa
-    float seconds = (float)glfwGetTime();
+    float seconds = (float)GetTimeSeconds();
 
     // Número de segundos desde o último cálculo do fps
     float ellapsed_seconds = seconds - old_seconds;
 
     if (ellapsed_seconds > 1.0f)
     {
-        numchars = snprintf(buffer, 20, "%.2f fps", ellapsed_frames / ellapsed_seconds);
+        // Junto da média, os percentis e o máximo do tempo dos últimos quadros,
+        // e quantos deles ficaram acima do orçamento (veja "framestats.cpp").
+        double p50, p95, p99, max_ms;
+        int over_budget;
+        FrameStats_Window(&p50, &p95, &p99, &max_ms, &over_budget);
+        numchars = snprintf(buffer, 120, "%.2f fps, p50 %.1f p95 %.1f p99 %.1f max %.1f ms, %d > %.1f ms",
+                            ellapsed_frames / ellapsed_seconds, p50, p95, p99, max_ms, over_budget, FrameStats_BudgetMs());
 
         old_seconds = seconds;
         ellapsed_frames = 0;
@@ -1967,7 +5074,87 @@ void TextRendering_ShowFramesPerSecond(GLFWwindow *window)
     float lineheight = TextRendering_LineHeight(window);
     float charwidth = TextRendering_CharWidth(window);
 
-    TextRendering_PrintString(window, buffer, 1.0f - (numchars + 1) * charwidth, 1.0f - lineheight, 1.0f);
+    static int layout = TextRendering_NewLayout();
+    TextRendering_PrintLayout(window, layout, buffer, 1.0f - (numchars + 1) * charwidth, 1.0f - lineheight, 1.0f);
+}
+
+// Escrevemos na tela o backend de submissão da cena, o número de chamadas de
+// desenho e de triângulos do último quadro, e o tempo médio de CPU gasto na
+// submissão (veja SubmitDrawList()), seguidos das estatísticas de culling do
+// pacote.
+void TextRendering_ShowDrawStats(GLFWwindow *window, const FramePacket &packet)
+{
+    if (!g_ShowInfoText)
+        return;
+
+    // Textos com posicionamento guardado, um por linha (veja
+    // TextRendering_PrintLayout()).
+    static int layouts[4] = {TextRendering_NewLayout(), TextRendering_NewLayout(), TextRendering_NewLayout(), TextRendering_NewLayout()};
+
+    const DrawStats &stats = g_DrawStats[g_DrawBackend];
+
+    char buffer[80];
+    int numchars = snprintf(buffer, 80, "%s%s%s: %d draws %luk tris %.3f ms, frame %.2f ms",
+                            g_DrawBackend == DRAW_BACKEND_MULTI_DRAW ? "multi-draw" : "per-object",
+                            g_DepthPrepass ? "+prepass" : "",
+                            g_SimulationThreadRunning ? "+sim thread" : "",
+                            stats.draw_calls, (unsigned long)(stats.triangles / 1000), stats.cpu.average_ms,
+                            g_FrameTimeStats[g_DepthPrepass].average_ms);
+
+    float lineheight = TextRendering_LineHeight(window);
+    float charwidth = TextRendering_CharWidth(window);
+
+    TextRendering_PrintLayout(window, layouts[0], buffer, 1.0f - (numchars + 1) * charwidth, 1.0f - 2 * lineheight, 1.0f);
+
+    // Culling do pacote (veja FinishFramePacket()).
+    numchars = (int)packet.culling_text.size();
+    TextRendering_PrintLayout(window, layouts[1], packet.culling_text, 1.0f - (numchars + 1) * charwidth, 1.0f - 3 * lineheight, 1.0f);
+
+    // Consultas de oclusão do último quadro e taxa de acerto acumulada (veja
+    // SubmitOcclusionList()).
+    if (g_OcclusionQueries)
+    {
+        double hit_rate = g_OcclusionStats.total_results > 0 ? 100.0 * g_OcclusionStats.total_occluded / g_OcclusionStats.total_results : 0.0;
+        numchars = snprintf(buffer, 80, "occlusion: %d queries %d skipped %d hidden (%.0f%% hits)",
+                            g_OcclusionStats.queries, g_OcclusionStats.skipped, g_OcclusionStats.occluded, hit_rate);
+    }
+    else
+        numchars = snprintf(buffer, 80, "occlusion: off");
+
+    TextRendering_PrintLayout(window, layouts[2], buffer, 1.0f - (numchars + 1) * charwidth, 1.0f - 4 * lineheight, 1.0f);
+
+    // Oclusão por software (veja CullDrawList()).
+    numchars = (int)packet.software_occlusion_text.size();
+    TextRendering_PrintLayout(window, layouts[3], packet.software_occlusion_text, 1.0f - (numchars + 1) * charwidth, 1.0f - 5 * lineheight, 1.0f);
+}
+
+// Escrevemos na tela a média móvel do tempo de GPU de cada passada medida
+// (veja "gputimer.cpp") e do tempo de CPU da thread de renderização por
+// quadro. Se a soma dos tempos de GPU se aproxima do tempo do quadro e o
+// tempo de CPU é menor, o quadro é limitado pela GPU; caso contrário, pela CPU.
+void TextRendering_ShowGpuTimes(GLFWwindow *window)
+{
+    if (!g_ShowInfoText)
+        return;
+
+    static int layout = TextRendering_NewLayout();
+
+    char buffer[120];
+    int numchars = snprintf(buffer, sizeof(buffer), "gpu:");
+    double gpu_total_ms = 0.0;
+    for (int pass = 0; pass < GPU_PASS_COUNT; ++pass)
+    {
+        if (!GpuTimer_IsActive(pass))
+            continue;
+        gpu_total_ms += GpuTimer_AverageMs(pass);
+        numchars += snprintf(buffer + numchars, sizeof(buffer) - numchars, " %s %.2f", GPU_PASS_NAMES[pass], GpuTimer_AverageMs(pass));
+    }
+    numchars += snprintf(buffer + numchars, sizeof(buffer) - numchars, " = %.2f ms, cpu %.2f ms", gpu_total_ms, g_RenderCpuStats.average_ms);
+
+    float lineheight = TextRendering_LineHeight(window);
+    float charwidth = TextRendering_CharWidth(window);
+
+    TextRendering_PrintLayout(window, layout, buffer, 1.0f - (numchars + 1) * charwidth, 1.0f - 6 * lineheight, 1.0f);
 }
 
 // Função para debugging: imprime no terminal todas informações de um modelo
@@ -0,0 +1,268 @@
+// Arena global de malhas: um único VBO (com atributos intercalados) e um único
+// IBO, compartilhados por todos os objetos da cena virtual. Cada chamada de
+// BuildTrianglesAndAddToVirtualScene() (veja main.cpp) reserva um bloco de
+// vértices e um bloco de índices dentro destes buffers através de um
+// sub-alocador "first-fit", e todos os objetos são desenhados através de um
+// único VAO com glDrawElementsBaseVertex().
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include <glad/glad.h>
+
+#include "utils.h"
+
+// Formato de cada vértice dentro do VBO da arena (10 floats, 40 bytes):
+//
+//    [ X Y Z W | NX NY NZ NW | U V ]
+//       (0)         (1)       (2)      <-- "location" em "shader_vertex.glsl"
+//
+const GLsizei MESH_ARENA_VERTEX_FLOATS = 10;
+const GLsizei MESH_ARENA_VERTEX_STRIDE = MESH_ARENA_VERTEX_FLOATS * sizeof(float);
+
+// Um bloco contíguo de elementos [offset, offset + count) dentro de um buffer.
+struct ArenaBlock
+{
+    size_t offset;
+    size_t count;
+};
+
+// Sub-alocador de um buffer. Os blocos livres são mantidos ordenados por
+// offset, o que permite juntar blocos vizinhos quando o buffer cresce (veja
+// ArenaAllocator_Grow()).
+struct ArenaAllocator
+{
+    size_t capacity;                      // Número total de elementos do buffer
+    size_t used;                          // Número de elementos alocados
+    size_t num_allocations;               // Número de blocos alocados
+    std::vector<ArenaBlock> free_blocks;  // Blocos livres, ordenados por offset
+};
+
+GLuint meshArenaVAO = 0;
+GLuint meshArenaVBO = 0;
+GLuint meshArenaIBO = 0;
+ArenaAllocator meshArenaVertices;
+ArenaAllocator meshArenaIndices;
+
+// Insere o bloco livre [offset, offset + count) na lista de blocos livres,
+// juntando-o com os blocos vizinhos caso estes sejam contíguos.
+static void ArenaAllocator_InsertFree(ArenaAllocator &arena, size_t offset, size_t count)
+{
+    std::vector<ArenaBlock> &blocks = arena.free_blocks;
+
+    size_t i = 0;
+    while (i < blocks.size() && blocks[i].offset < offset)
+        ++i;
+
+    ArenaBlock block = {offset, count};
+    blocks.insert(blocks.begin() + i, block);
+
+    // Junta com o bloco seguinte
+    if (i + 1 < blocks.size() && blocks[i].offset + blocks[i].count == blocks[i + 1].offset)
+    {
+        blocks[i].count += blocks[i + 1].count;
+        blocks.erase(blocks.begin() + i + 1);
+    }
+
+    // Junta com o bloco anterior
+    if (i > 0 && blocks[i - 1].offset + blocks[i - 1].count == blocks[i].offset)
+    {
+        blocks[i - 1].count += blocks[i].count;
+        blocks.erase(blocks.begin() + i);
+    }
+}
+
+// Procura o primeiro bloco livre com pelo menos "count" elementos.
+static bool ArenaAllocator_Alloc(ArenaAllocator &arena, size_t count, size_t *offset)
+{
+    std::vector<ArenaBlock> &blocks = arena.free_blocks;
+
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        if (blocks[i].count < count)
+            continue;
+
+        *offset = blocks[i].offset;
+        blocks[i].offset += count;
+        blocks[i].count -= count;
+        if (blocks[i].count == 0)
+            blocks.erase(blocks.begin() + i);
+
+        arena.used += count;
+        arena.num_allocations += 1;
+        return true;
+    }
+
+    return false;
+}
+
+// Cria um novo buffer com "new_bytes" bytes e copia para ele o conteúdo do
+// buffer antigo (com "old_bytes" bytes), o qual é então deletado.
+static GLuint MeshArena_ReallocBuffer(GLuint old_buffer, size_t old_bytes, size_t new_bytes)
+{
+    GLuint new_buffer;
+    glGenBuffers(1, &new_buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, new_buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, new_bytes, NULL, GL_STATIC_DRAW);
+
+    if (old_buffer != 0)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, old_buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, old_bytes);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glDeleteBuffers(1, &old_buffer);
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return new_buffer;
+}
+
+// Aumenta a capacidade do sub-alocador, adicionando um bloco livre no final.
+static void ArenaAllocator_Grow(ArenaAllocator &arena, size_t new_capacity)
+{
+    ArenaAllocator_InsertFree(arena, arena.capacity, new_capacity - arena.capacity);
+    arena.capacity = new_capacity;
+}
+
+static size_t MeshArena_GrownCapacity(const ArenaAllocator &arena, size_t count)
+{
+    size_t new_capacity = std::max<size_t>(arena.capacity, 1);
+    while (new_capacity - arena.capacity < count)
+        new_capacity *= 2;
+    return new_capacity;
+}
+
+static void MeshArena_GrowVertices(size_t count)
+{
+    size_t new_capacity = MeshArena_GrownCapacity(meshArenaVertices, count);
+
+    meshArenaVBO = MeshArena_ReallocBuffer(meshArenaVBO,
+                                           meshArenaVertices.capacity * MESH_ARENA_VERTEX_STRIDE,
+                                           new_capacity * MESH_ARENA_VERTEX_STRIDE);
+    ArenaAllocator_Grow(meshArenaVertices, new_capacity);
+
+    // Os atributos do VAO apontam para o buffer antigo, então precisam ser
+    // especificados novamente.
+    glBindVertexArray(meshArenaVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, meshArenaVBO);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, MESH_ARENA_VERTEX_STRIDE, (void *)(0 * sizeof(float)));
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, MESH_ARENA_VERTEX_STRIDE, (void *)(4 * sizeof(float)));
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, MESH_ARENA_VERTEX_STRIDE, (void *)(8 * sizeof(float)));
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    glCheckError();
+}
+
+static void MeshArena_GrowIndices(size_t count)
+{
+    size_t new_capacity = MeshArena_GrownCapacity(meshArenaIndices, count);
+
+    meshArenaIBO = MeshArena_ReallocBuffer(meshArenaIBO,
+                                           meshArenaIndices.capacity * sizeof(GLuint),
+                                           new_capacity * sizeof(GLuint));
+    ArenaAllocator_Grow(meshArenaIndices, new_capacity);
+
+    // O GL_ELEMENT_ARRAY_BUFFER faz parte do estado do VAO.
+    glBindVertexArray(meshArenaVAO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshArenaIBO);
+    glBindVertexArray(0);
+    glCheckError();
+}
+
+// Cria o VAO da arena e reserva espaço inicial para "vertex_capacity" vértices
+// e "index_capacity" índices. Os buffers crescem automaticamente (dobrando de
+// tamanho) caso alguma alocação não caiba no espaço livre.
+void MeshArena_Init(size_t vertex_capacity, size_t index_capacity)
+{
+    glGenVertexArrays(1, &meshArenaVAO);
+
+    meshArenaVertices.capacity = 0;
+    meshArenaVertices.used = 0;
+    meshArenaVertices.num_allocations = 0;
+    meshArenaIndices = meshArenaVertices;
+
+    MeshArena_GrowVertices(vertex_capacity);
+    MeshArena_GrowIndices(index_capacity);
+}
+
+// Reserva um bloco de "count" vértices e retorna o índice do primeiro deles,
+// o qual deve ser utilizado como "basevertex" em glDrawElementsBaseVertex().
+size_t MeshArena_AllocVertices(size_t count)
+{
+    size_t offset;
+    if (!ArenaAllocator_Alloc(meshArenaVertices, count, &offset))
+    {
+        MeshArena_GrowVertices(count);
+        if (!ArenaAllocator_Alloc(meshArenaVertices, count, &offset))
+            throw std::runtime_error("Erro ao alocar vértices na arena de malhas.");
+    }
+    return offset;
+}
+
+// Reserva um bloco de "count" índices e retorna a posição do primeiro deles.
+size_t MeshArena_AllocIndices(size_t count)
+{
+    size_t offset;
+    if (!ArenaAllocator_Alloc(meshArenaIndices, count, &offset))
+    {
+        MeshArena_GrowIndices(count);
+        if (!ArenaAllocator_Alloc(meshArenaIndices, count, &offset))
+            throw std::runtime_error("Erro ao alocar índices na arena de malhas.");
+    }
+    return offset;
+}
+
+// Copia "count" vértices (MESH_ARENA_VERTEX_FLOATS floats cada) para a GPU,
+// a partir do vértice "first_vertex" da arena.
+void MeshArena_UploadVertices(size_t first_vertex, size_t count, const float *vertex_coefficients)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, meshArenaVBO);
+    glBufferSubData(GL_ARRAY_BUFFER, first_vertex * MESH_ARENA_VERTEX_STRIDE, count * MESH_ARENA_VERTEX_STRIDE, vertex_coefficients);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void MeshArena_UploadIndices(size_t first_index, size_t count, const GLuint *indices)
+{
+    // Utilizamos GL_COPY_WRITE_BUFFER para não alterar o GL_ELEMENT_ARRAY_BUFFER
+    // do VAO que estiver "ligado" no momento.
+    glBindBuffer(GL_COPY_WRITE_BUFFER, meshArenaIBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, first_index * sizeof(GLuint), count * sizeof(GLuint), indices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+GLuint MeshArena_VertexArrayObject()
+{
+    return meshArenaVAO;
+}
+
+// Imprime no terminal a utilização e a fragmentação de um dos buffers da arena.
+// A fragmentação é definida como 1 - (maior bloco livre / total livre), isto
+// é, 0% quando todo o espaço livre é contíguo.
+static void ArenaAllocator_PrintStats(const char *name, const ArenaAllocator &arena, size_t element_size)
+{
+    size_t free_total = arena.capacity - arena.used;
+    size_t largest_free = 0;
+    for (size_t i = 0; i < arena.free_blocks.size(); ++i)
+        largest_free = std::max(largest_free, arena.free_blocks[i].count);
+
+    float utilization = arena.capacity > 0 ? 100.0f * arena.used / arena.capacity : 0.0f;
+    float fragmentation = free_total > 0 ? 100.0f * (1.0f - (float)largest_free / free_total) : 0.0f;
+
+    printf("  %-8s %9lu/%9lu (%5.1f%% usado, %.2f MB), %lu alocações, %lu blocos livres, fragmentação %.1f%%\n",
+           name,
+           (unsigned long)arena.used, (unsigned long)arena.capacity, utilization,
+           arena.capacity * element_size / (1024.0f * 1024.0f),
+           (unsigned long)arena.num_allocations, (unsigned long)arena.free_blocks.size(),
+           fragmentation);
+}
+
+void MeshArena_PrintStats()
+{
+    printf("Arena de malhas:\n");
+    ArenaAllocator_PrintStats("Vértices", meshArenaVertices, MESH_ARENA_VERTEX_STRIDE);
+    ArenaAllocator_PrintStats("Índices", meshArenaIndices, sizeof(GLuint));
+}
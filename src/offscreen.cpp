@@ -0,0 +1,199 @@
+// Contexto OpenGL sem janela, para execução em máquinas sem display (por
+// exemplo, servidores de build somente com o Mesa llvmpipe). O contexto é
+// criado pela EGL na plataforma "surfaceless" do Mesa
+// (EGL_MESA_platform_surfaceless), sem conexão com um servidor X, e fica
+// corrente sem superfície alguma (EGL_KHR_surfaceless_context). Sem
+// framebuffer padrão, a cena é desenhada em um framebuffer object com
+// "renderbuffers" de cor e de profundidade do tamanho pedido, o qual fica
+// ligado no lugar do framebuffer da janela durante toda a execução.
+// Utilizado pelo modo de benchmark e pela reprodução com "--headless".
+//
+// As imagens desenhadas podem ser lidas de volta para análise (veja
+// Offscreen_ReadPixels(), que também funciona com o framebuffer da janela).
+//
+// Disponível somente no Linux; nas demais plataformas Offscreen_Init()
+// retorna false.
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <glad/glad.h>
+
+#if defined(__linux__)
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+static EGLDisplay g_OffscreenDisplay = EGL_NO_DISPLAY;
+static EGLContext g_OffscreenContext = EGL_NO_CONTEXT;
+#endif
+
+static GLuint g_OffscreenFramebuffer = 0;
+static GLuint g_OffscreenRenderbuffers[2]; // Cor e profundidade
+
+#if defined(__linux__)
+static bool Offscreen_HasExtension(EGLDisplay display, const char *name)
+{
+    const char *extensions = eglQueryString(display, EGL_EXTENSIONS);
+    if (extensions == NULL)
+        return false;
+
+    // A lista é separada por espaços; o nome deve coincidir por inteiro.
+    size_t length = strlen(name);
+    for (const char *p = strstr(extensions, name); p != NULL; p = strstr(p + length, name))
+        if ((p == extensions || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0'))
+            return true;
+    return false;
+}
+
+void *Offscreen_GetProcAddress(const char *name)
+{
+    return (void *)eglGetProcAddress(name);
+}
+#else
+void *Offscreen_GetProcAddress(const char *name)
+{
+    return NULL;
+}
+#endif
+
+// Cria o framebuffer object de "width" x "height" pixels onde a cena é
+// desenhada, e o deixa ligado.
+static bool Offscreen_CreateFramebuffer(int width, int height)
+{
+    glGenFramebuffers(1, &g_OffscreenFramebuffer);
+    glGenRenderbuffers(2, g_OffscreenRenderbuffers);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, g_OffscreenRenderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, g_OffscreenRenderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, g_OffscreenFramebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, g_OffscreenRenderbuffers[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, g_OffscreenRenderbuffers[1]);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        fprintf(stderr, "ERROR: Offscreen framebuffer incomplete (status 0x%x).\n", status);
+        return false;
+    }
+    return true;
+}
+
+// Cria o contexto OpenGL 3.3 "core" sem janela, carrega as funções OpenGL
+// (GLAD) e cria o framebuffer de "width" x "height" pixels. Retorna false,
+// após imprimir o motivo, se não for possível.
+bool Offscreen_Init(int width, int height)
+{
+#if defined(__linux__)
+    PFNEGLGETPLATFORMDISPLAYEXTPROC eglGetPlatformDisplayEXT = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (eglGetPlatformDisplayEXT == NULL || !Offscreen_HasExtension(EGL_NO_DISPLAY, "EGL_MESA_platform_surfaceless"))
+    {
+        fprintf(stderr, "ERROR: EGL_MESA_platform_surfaceless is not supported.\n");
+        return false;
+    }
+
+    g_OffscreenDisplay = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    EGLint major, minor;
+    if (g_OffscreenDisplay == EGL_NO_DISPLAY || !eglInitialize(g_OffscreenDisplay, &major, &minor))
+    {
+        fprintf(stderr, "ERROR: eglInitialize() failed.\n");
+        return false;
+    }
+
+    // Sem superfície, o contexto não precisa de uma configuração de pixels.
+    if (!Offscreen_HasExtension(g_OffscreenDisplay, "EGL_KHR_surfaceless_context") || !Offscreen_HasExtension(g_OffscreenDisplay, "EGL_KHR_no_config_context"))
+    {
+        fprintf(stderr, "ERROR: EGL_KHR_surfaceless_context and EGL_KHR_no_config_context are required.\n");
+        return false;
+    }
+
+    // Pedimos para utilizar OpenGL versão 3.3, perfil "core", como com a janela.
+    eglBindAPI(EGL_OPENGL_API);
+    const EGLint context_attributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE};
+    g_OffscreenContext = eglCreateContext(g_OffscreenDisplay, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, context_attributes);
+    if (g_OffscreenContext == EGL_NO_CONTEXT || !eglMakeCurrent(g_OffscreenDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, g_OffscreenContext))
+    {
+        fprintf(stderr, "ERROR: Cannot create an OpenGL 3.3 core context with EGL (error 0x%x).\n", eglGetError());
+        return false;
+    }
+
+    gladLoadGLLoader((GLADloadproc)eglGetProcAddress);
+
+    return Offscreen_CreateFramebuffer(width, height);
+#else
+    fprintf(stderr, "ERROR: Offscreen rendering is only supported on Linux.\n");
+    return false;
+#endif
+}
+
+// Destrói o framebuffer e o contexto.
+void Offscreen_Shutdown()
+{
+    if (g_OffscreenFramebuffer != 0)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &g_OffscreenFramebuffer);
+        glDeleteRenderbuffers(2, g_OffscreenRenderbuffers);
+        g_OffscreenFramebuffer = 0;
+    }
+
+#if defined(__linux__)
+    if (g_OffscreenDisplay != EGL_NO_DISPLAY)
+    {
+        eglMakeCurrent(g_OffscreenDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (g_OffscreenContext != EGL_NO_CONTEXT)
+            eglDestroyContext(g_OffscreenDisplay, g_OffscreenContext);
+        eglTerminate(g_OffscreenDisplay);
+        g_OffscreenDisplay = EGL_NO_DISPLAY;
+        g_OffscreenContext = EGL_NO_CONTEXT;
+    }
+#endif
+}
+
+// Lê os pixels RGB do framebuffer atual, de "width" x "height" pixels, em
+// "pixels", linha a linha de cima para baixo (o OpenGL as retorna de baixo
+// para cima). Com a janela, lê o "back buffer", e deve ser chamada antes da
+// troca dos buffers. Espera a GPU terminar de desenhar o quadro.
+void Offscreen_ReadPixels(int width, int height, std::vector<unsigned char> &pixels)
+{
+    size_t row_size = 3 * (size_t)width;
+    pixels.resize(row_size * height);
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+    std::vector<unsigned char> row(row_size);
+    for (int y = 0; y < height / 2; ++y)
+    {
+        unsigned char *top = &pixels[y * row_size];
+        unsigned char *bottom = &pixels[(height - 1 - y) * row_size];
+        memcpy(row.data(), top, row_size);
+        memcpy(top, bottom, row_size);
+        memcpy(bottom, row.data(), row_size);
+    }
+}
+
+// Grava os pixels lidos por Offscreen_ReadPixels() em uma imagem PPM binária
+// ("P6"), formato sem compressão lido pela maioria dos visualizadores e
+// ferramentas de análise de imagens.
+bool Offscreen_WritePPM(const char *filename, int width, int height, const std::vector<unsigned char> &pixels)
+{
+    FILE *file = fopen(filename, "wb");
+    if (file == NULL)
+        return false;
+
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    bool ok = fwrite(pixels.data(), 1, pixels.size(), file) == pixels.size();
+    if (fclose(file) != 0)
+        ok = false;
+    return ok;
+}
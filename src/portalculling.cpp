@@ -0,0 +1,282 @@
+// Visibilidade por portais ("cells and portals"). O nível é dividido em
+// células convexas (as salas), conectadas por portais: polígonos convexos que
+// representam as aberturas entre duas células (as portas). A partir da célula
+// onde está a câmera, percorremos o grafo de células atravessando apenas os
+// portais abertos; a cada portal atravessado, o frustum é reduzido ao
+// retângulo (em NDC) que contém a projeção do portal. Uma célula só pode ser
+// vista se for alcançada por algum caminho com frustum não vazio, e os
+// objetos de cada célula visível podem ser testados contra o frustum reduzido
+// da célula (veja FrustumCulling_TestBoxes()).
+//
+// Referência: D. Luebke e C. Georges, "Portals and Mirrors: Simple, Fast
+// Evaluation of Potentially Visible Sets", 1995.
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/geometric.hpp>
+
+// Uma célula do nível, delimitada por uma AABB em coordenadas do mundo.
+struct PortalCell
+{
+    glm::vec3 bbox_min;
+    glm::vec3 bbox_max;
+    std::vector<int> portals; // Índices em g_Portals dos portais desta célula
+};
+
+// Um portal entre duas células: um polígono convexo em coordenadas do mundo.
+struct Portal
+{
+    int cells[2];
+    std::vector<glm::vec3> polygon;
+    glm::vec3 normal;   // Normal do plano do polígono
+    glm::vec3 bbox_min; // AABB do polígono
+    glm::vec3 bbox_max;
+    bool open;          // Portais fechados (portas fechadas) não podem ser atravessados
+};
+
+// Retângulo em coordenadas NDC que delimita o frustum reduzido.
+struct PortalRect
+{
+    float xmin, xmax;
+    float ymin, ymax;
+};
+
+static std::vector<PortalCell> g_PortalCells;
+static std::vector<Portal> g_Portals;
+
+// Distância máxima da câmera ao plano de um portal para considerarmos que a
+// câmera está "dentro" da abertura. Neste caso a projeção do portal é
+// degenerada e a célula vizinha é vista com o frustum atual inteiro.
+static const float PORTAL_CROSSING_DISTANCE = 0.25f;
+
+// Adiciona uma célula ao nível e retorna o seu índice.
+int PortalCulling_AddCell(glm::vec3 bbox_min, glm::vec3 bbox_max)
+{
+    PortalCell cell;
+    cell.bbox_min = bbox_min;
+    cell.bbox_max = bbox_max;
+    g_PortalCells.push_back(cell);
+    return (int)g_PortalCells.size() - 1;
+}
+
+// Adiciona um portal entre as células "cell_a" e "cell_b", cuja abertura é o
+// polígono convexo e planar definido por "num_vertices" vértices. O portal é
+// criado aberto. Retorna o índice do portal.
+int PortalCulling_AddPortal(int cell_a, int cell_b, const glm::vec3 *vertices, int num_vertices)
+{
+    Portal portal;
+    portal.cells[0] = cell_a;
+    portal.cells[1] = cell_b;
+    portal.polygon.assign(vertices, vertices + num_vertices);
+    portal.normal = glm::normalize(glm::cross(vertices[1] - vertices[0], vertices[2] - vertices[0]));
+    portal.bbox_min = vertices[0];
+    portal.bbox_max = vertices[0];
+    for (int i = 1; i < num_vertices; ++i)
+    {
+        portal.bbox_min = glm::min(portal.bbox_min, vertices[i]);
+        portal.bbox_max = glm::max(portal.bbox_max, vertices[i]);
+    }
+    portal.open = true;
+
+    g_Portals.push_back(portal);
+    int index = (int)g_Portals.size() - 1;
+    g_PortalCells[cell_a].portals.push_back(index);
+    g_PortalCells[cell_b].portals.push_back(index);
+    return index;
+}
+
+// Abre ou fecha um portal (por exemplo, quando uma porta é aberta).
+void PortalCulling_SetPortalOpen(int portal, bool open)
+{
+    g_Portals[portal].open = open;
+}
+
+int PortalCulling_NumCells()
+{
+    return (int)g_PortalCells.size();
+}
+
+// Retorna a célula que contém o ponto "point", ou -1 se o ponto estiver fora
+// de todas as células.
+int PortalCulling_FindCell(glm::vec3 point)
+{
+    for (size_t i = 0; i < g_PortalCells.size(); ++i)
+    {
+        const PortalCell &cell = g_PortalCells[i];
+        if (point.x >= cell.bbox_min.x && point.x <= cell.bbox_max.x &&
+            point.y >= cell.bbox_min.y && point.y <= cell.bbox_max.y &&
+            point.z >= cell.bbox_min.z && point.z <= cell.bbox_max.z)
+            return (int)i;
+    }
+    return -1;
+}
+
+// Calcula o retângulo em NDC ocupado pela projeção do portal, intersectado
+// com "rect". Retorna false se a interseção for vazia (o portal não é visível
+// através de "rect").
+static bool PortalCulling_ClipPortal(const Portal &portal, const glm::mat4 &clip, glm::vec3 camera_position, const PortalRect &rect, PortalRect &result)
+{
+    // Câmera dentro da abertura do portal: a célula vizinha é vista pelo
+    // frustum atual inteiro.
+    float distance = glm::dot(portal.normal, camera_position - portal.polygon[0]);
+    if (fabsf(distance) < PORTAL_CROSSING_DISTANCE &&
+        camera_position.x >= portal.bbox_min.x - PORTAL_CROSSING_DISTANCE && camera_position.x <= portal.bbox_max.x + PORTAL_CROSSING_DISTANCE &&
+        camera_position.y >= portal.bbox_min.y - PORTAL_CROSSING_DISTANCE && camera_position.y <= portal.bbox_max.y + PORTAL_CROSSING_DISTANCE &&
+        camera_position.z >= portal.bbox_min.z - PORTAL_CROSSING_DISTANCE && camera_position.z <= portal.bbox_max.z + PORTAL_CROSSING_DISTANCE)
+    {
+        result = rect;
+        return true;
+    }
+
+    // Polígono em coordenadas de recorte, recortado pelo near plane
+    // (z >= -w) com o algoritmo de Sutherland-Hodgman. Após o recorte temos
+    // w > 0 em todos os vértices, e a divisão por w é válida.
+    size_t n = portal.polygon.size();
+    glm::vec4 vertices[16];
+    size_t num_vertices = 0;
+
+    glm::vec4 previous = clip * glm::vec4(portal.polygon[n - 1], 1.0f);
+    float previous_d = previous.z + previous.w;
+    for (size_t i = 0; i < n && num_vertices + 2 <= 16; ++i)
+    {
+        glm::vec4 current = clip * glm::vec4(portal.polygon[i], 1.0f);
+        float current_d = current.z + current.w;
+
+        if ((previous_d >= 0.0f) != (current_d >= 0.0f))
+            vertices[num_vertices++] = previous + (current - previous) * (previous_d / (previous_d - current_d));
+        if (current_d >= 0.0f)
+            vertices[num_vertices++] = current;
+
+        previous = current;
+        previous_d = current_d;
+    }
+
+    if (num_vertices == 0)
+        return false;
+
+    PortalRect bounds;
+    bounds.xmin = bounds.ymin = INFINITY;
+    bounds.xmax = bounds.ymax = -INFINITY;
+    for (size_t i = 0; i < num_vertices; ++i)
+    {
+        float w = std::max(vertices[i].w, 1e-6f);
+        float x = vertices[i].x / w;
+        float y = vertices[i].y / w;
+        bounds.xmin = std::min(bounds.xmin, x);
+        bounds.xmax = std::max(bounds.xmax, x);
+        bounds.ymin = std::min(bounds.ymin, y);
+        bounds.ymax = std::max(bounds.ymax, y);
+    }
+
+    result.xmin = std::max(rect.xmin, bounds.xmin);
+    result.xmax = std::min(rect.xmax, bounds.xmax);
+    result.ymin = std::max(rect.ymin, bounds.ymin);
+    result.ymax = std::min(rect.ymax, bounds.ymax);
+    return result.xmin < result.xmax && result.ymin < result.ymax;
+}
+
+// Visita a célula "cell", vista através do retângulo "rect", e recursivamente
+// as células vizinhas através dos portais abertos. Uma célula alcançada por
+// mais de um caminho é vista pela união (conservadora) dos retângulos.
+static void PortalCulling_VisitCell(int cell, const PortalRect &rect, const glm::mat4 &clip, glm::vec3 camera_position,
+                                    std::vector<unsigned char> &on_path, std::vector<PortalRect> &cell_rects, unsigned char *visible_cells)
+{
+    if (visible_cells[cell])
+    {
+        PortalRect &r = cell_rects[cell];
+        r.xmin = std::min(r.xmin, rect.xmin);
+        r.xmax = std::max(r.xmax, rect.xmax);
+        r.ymin = std::min(r.ymin, rect.ymin);
+        r.ymax = std::max(r.ymax, rect.ymax);
+    }
+    else
+    {
+        cell_rects[cell] = rect;
+        visible_cells[cell] = 1;
+    }
+
+    on_path[cell] = 1;
+
+    const std::vector<int> &portals = g_PortalCells[cell].portals;
+    for (size_t i = 0; i < portals.size(); ++i)
+    {
+        const Portal &portal = g_Portals[portals[i]];
+        if (!portal.open)
+            continue;
+
+        int neighbor = (portal.cells[0] == cell) ? portal.cells[1] : portal.cells[0];
+        if (on_path[neighbor])
+            continue;
+
+        PortalRect narrowed;
+        if (PortalCulling_ClipPortal(portal, clip, camera_position, rect, narrowed))
+            PortalCulling_VisitCell(neighbor, narrowed, clip, camera_position, on_path, cell_rects, visible_cells);
+    }
+
+    on_path[cell] = 0;
+}
+
+// Escreve os seis planos (no formato de FrustumCulling_ExtractPlanes()) do
+// frustum de "clip" reduzido ao retângulo "rect" em NDC.
+static void PortalCulling_RectPlanes(const glm::mat4 &clip, const PortalRect &rect, glm::vec4 planes[6])
+{
+    glm::vec4 row0 = glm::vec4(clip[0][0], clip[1][0], clip[2][0], clip[3][0]);
+    glm::vec4 row1 = glm::vec4(clip[0][1], clip[1][1], clip[2][1], clip[3][1]);
+    glm::vec4 row2 = glm::vec4(clip[0][2], clip[1][2], clip[2][2], clip[3][2]);
+    glm::vec4 row3 = glm::vec4(clip[0][3], clip[1][3], clip[2][3], clip[3][3]);
+
+    planes[0] = row0 - rect.xmin * row3; // x >= xmin * w
+    planes[1] = rect.xmax * row3 - row0; // x <= xmax * w
+    planes[2] = row1 - rect.ymin * row3; // y >= ymin * w
+    planes[3] = rect.ymax * row3 - row1; // y <= ymax * w
+    planes[4] = row3 + row2;             // near
+    planes[5] = row3 - row2;             // far
+}
+
+// Determina as células visíveis a partir da câmera em "camera_position",
+// com matriz clip = projection * view. Para cada célula i, escreve em
+// visible_cells[i] se a mesma é visível, e em cell_planes[6*i .. 6*i+5] os
+// planos do frustum reduzido pelos portais através dos quais ela é vista.
+// Se a câmera estiver fora de todas as células, todas são consideradas
+// visíveis com o frustum completo. Retorna o número de células visíveis.
+int PortalCulling_ComputeVisibleCells(glm::vec3 camera_position, const glm::mat4 &clip, unsigned char *visible_cells, glm::vec4 *cell_planes)
+{
+    static std::vector<unsigned char> on_path;
+    static std::vector<PortalRect> cell_rects;
+
+    size_t num_cells = g_PortalCells.size();
+    on_path.assign(num_cells, 0);
+    cell_rects.resize(num_cells);
+
+    PortalRect full = {-1.0f, 1.0f, -1.0f, 1.0f};
+
+    int camera_cell = PortalCulling_FindCell(camera_position);
+    if (camera_cell < 0)
+    {
+        for (size_t i = 0; i < num_cells; ++i)
+        {
+            visible_cells[i] = 1;
+            cell_rects[i] = full;
+        }
+    }
+    else
+    {
+        std::fill(visible_cells, visible_cells + num_cells, 0);
+        PortalCulling_VisitCell(camera_cell, full, clip, camera_position, on_path, cell_rects, visible_cells);
+    }
+
+    int num_visible = 0;
+    for (size_t i = 0; i < num_cells; ++i)
+    {
+        if (visible_cells[i])
+        {
+            PortalCulling_RectPlanes(clip, cell_rects[i], &cell_planes[6 * i]);
+            num_visible += 1;
+        }
+    }
+    return num_visible;
+}
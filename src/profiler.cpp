@@ -0,0 +1,200 @@
+// Buffers do profiler de CPU por zonas (veja "profiler.h").
+//
+// Cada thread escreve as suas zonas em um buffer circular próprio, de
+// PROFILER_BUFFER_EVENTS registros, sem travas: a thread é a única a
+// escrever no buffer, e publica cada registro incrementando "head" (com
+// semântica "release"). Quando o buffer enche, os registros mais antigos são
+// sobrescritos. A gravação do trace lê os buffers de qualquer thread
+// concorrentemente com as escritas: lê "head", copia os registros, e lê
+// "head" novamente, descartando os registros que podem ter sido
+// sobrescritos durante a cópia. Os campos dos registros são atômicos
+// (acessados com "memory_order_relaxed", sem custo adicional em x86), de forma
+// que uma leitura concorrente nunca é uma condição de corrida.
+//
+// Apenas o registro de uma thread nova, na sua primeira zona, utiliza uma
+// trava. Buffers de threads que terminaram são reaproveitados pela próxima
+// thread nova (a thread de simulação pode ser reiniciada com a tecla T).
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+
+#include "profiler.h"
+
+#define PROFILER_BUFFER_EVENTS (1 << 16) // Registros por thread (potência de dois)
+
+struct ProfilerEvent
+{
+    std::atomic<const char *> name;
+    std::atomic<unsigned long long> start_ns;
+    std::atomic<unsigned long long> end_ns;
+};
+
+struct ProfilerThreadBuffer
+{
+    ProfilerEvent events[PROFILER_BUFFER_EVENTS];
+    std::atomic<unsigned long long> head; // Número de registros já escritos
+    std::atomic<bool> in_use;             // Pertence a uma thread em execução
+    std::atomic<const char *> thread_name;
+    int thread_id; // Identificador da thread no trace
+};
+
+static std::mutex g_ProfilerMutex; // Protege g_ProfilerBuffers
+static std::vector<ProfilerThreadBuffer *> g_ProfilerBuffers;
+static const unsigned long long g_ProfilerStartNs = Profiler_Now();
+
+// Devolve o buffer da thread ao terminar a mesma.
+struct ProfilerThreadSlot
+{
+    ProfilerThreadBuffer *buffer;
+
+    ProfilerThreadSlot() : buffer(NULL) {}
+    ~ProfilerThreadSlot()
+    {
+        if (buffer != NULL)
+            buffer->in_use.store(false, std::memory_order_release);
+    }
+};
+
+static thread_local ProfilerThreadSlot g_ProfilerThreadSlot;
+
+static ProfilerThreadBuffer *Profiler_ThreadBuffer()
+{
+    ProfilerThreadBuffer *buffer = g_ProfilerThreadSlot.buffer;
+    if (buffer != NULL)
+        return buffer;
+
+    std::lock_guard<std::mutex> lock(g_ProfilerMutex);
+    for (size_t i = 0; i < g_ProfilerBuffers.size() && buffer == NULL; ++i)
+    {
+        if (!g_ProfilerBuffers[i]->in_use.load(std::memory_order_acquire))
+            buffer = g_ProfilerBuffers[i];
+    }
+    if (buffer == NULL)
+    {
+        buffer = new ProfilerThreadBuffer();
+        buffer->head.store(0);
+        buffer->thread_id = (int)g_ProfilerBuffers.size() + 1;
+        g_ProfilerBuffers.push_back(buffer);
+    }
+    buffer->thread_name.store(NULL);
+    buffer->in_use.store(true);
+
+    g_ProfilerThreadSlot.buffer = buffer;
+    return buffer;
+}
+
+void Profiler_Record(const char *name, unsigned long long start_ns, unsigned long long end_ns)
+{
+    ProfilerThreadBuffer *buffer = Profiler_ThreadBuffer();
+
+    unsigned long long head = buffer->head.load(std::memory_order_relaxed);
+    ProfilerEvent &event = buffer->events[head & (PROFILER_BUFFER_EVENTS - 1)];
+    event.name.store(name, std::memory_order_relaxed);
+    event.start_ns.store(start_ns, std::memory_order_relaxed);
+    event.end_ns.store(end_ns, std::memory_order_relaxed);
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler_SetThreadName(const char *name)
+{
+    Profiler_ThreadBuffer()->thread_name.store(name, std::memory_order_relaxed);
+}
+
+// Escreve "str" como string JSON (os nomes das zonas são identificadores C++
+// ou literais do programa, mas aspas e barras são escapadas por segurança).
+static void Profiler_WriteJSONString(FILE *file, const char *str)
+{
+    fputc('"', file);
+    for (; *str; ++str)
+    {
+        if (*str == '"' || *str == '\\')
+            fputc('\\', file);
+        fputc(*str, file);
+    }
+    fputc('"', file);
+}
+
+bool Profiler_WriteChromeTrace(const char *filename, double seconds)
+{
+    FILE *file = fopen(filename, "w");
+    if (file == NULL)
+    {
+        fprintf(stderr, "WARNING: Cannot write trace file \"%s\".\n", filename);
+        return false;
+    }
+
+    unsigned long long now_ns = Profiler_Now();
+    unsigned long long min_end_ns = seconds > 0.0 ? now_ns - (unsigned long long)(seconds * 1.0e9) : 0;
+
+    std::vector<ProfilerThreadBuffer *> buffers;
+    {
+        std::lock_guard<std::mutex> lock(g_ProfilerMutex);
+        buffers = g_ProfilerBuffers;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    size_t num_events = 0;
+
+    struct Copy
+    {
+        const char *name;
+        unsigned long long start_ns, end_ns;
+    };
+    std::vector<Copy> copies;
+
+    for (size_t b = 0; b < buffers.size(); ++b)
+    {
+        ProfilerThreadBuffer *buffer = buffers[b];
+
+        // Cópia dos registros ainda no buffer, descartando os sobrescritos
+        // pela thread durante a cópia.
+        unsigned long long head = buffer->head.load(std::memory_order_acquire);
+        unsigned long long tail = head > PROFILER_BUFFER_EVENTS ? head - PROFILER_BUFFER_EVENTS : 0;
+        copies.resize(head - tail);
+        for (unsigned long long i = tail; i < head; ++i)
+        {
+            const ProfilerEvent &event = buffer->events[i & (PROFILER_BUFFER_EVENTS - 1)];
+            copies[i - tail].name = event.name.load(std::memory_order_relaxed);
+            copies[i - tail].start_ns = event.start_ns.load(std::memory_order_relaxed);
+            copies[i - tail].end_ns = event.end_ns.load(std::memory_order_relaxed);
+        }
+        // O registro de índice "new_head" ocupa o mesmo espaço que o de índice
+        // "new_head - PROFILER_BUFFER_EVENTS", e pode estar sendo escrito.
+        unsigned long long new_head = buffer->head.load(std::memory_order_acquire);
+        unsigned long long valid_tail = new_head >= PROFILER_BUFFER_EVENTS ? new_head - PROFILER_BUFFER_EVENTS + 1 : 0;
+        size_t first_valid = (size_t)(std::max(valid_tail, tail) - tail);
+
+        const char *thread_name = buffer->thread_name.load(std::memory_order_relaxed);
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":",
+                first ? "" : ",\n", buffer->thread_id);
+        if (thread_name != NULL)
+            Profiler_WriteJSONString(file, thread_name);
+        else
+            fprintf(file, "\"thread %d\"", buffer->thread_id);
+        fprintf(file, "}}");
+        first = false;
+
+        // Eventos completos ("X"), com início e duração em microssegundos.
+        for (size_t i = first_valid; i < copies.size(); ++i)
+        {
+            if (copies[i].end_ns < min_end_ns || copies[i].start_ns < g_ProfilerStartNs)
+                continue;
+            fprintf(file, ",\n{\"name\":");
+            Profiler_WriteJSONString(file, copies[i].name);
+            fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    buffer->thread_id, (copies[i].start_ns - g_ProfilerStartNs) / 1000.0,
+                    (copies[i].end_ns - copies[i].start_ns) / 1000.0);
+            num_events += 1;
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    printf("Profiler: %lu zonas de %lu threads gravadas em \"%s\"\n", (unsigned long)num_events, (unsigned long)buffers.size(), filename);
+    return true;
+}
@@ -0,0 +1,242 @@
+// Cache de programas de GPU em disco. Compilar e linkar os shaders a partir
+// do código GLSL é a etapa mais lenta da inicialização, e o resultado depende
+// apenas do código e do driver. Com a extensão ARB_get_program_binary (parte
+// do OpenGL 4.1) o driver nos entrega o programa já linkado em um formato
+// binário próprio (glGetProgramBinary), o qual salvamos em um arquivo e
+// carregamos nas execuções seguintes (glProgramBinary), sem compilar nada.
+//
+// Cada arquivo é identificado pelo hash (FNV-1a de 64 bits) do código dos
+// dois shaders e das strings GL_VENDOR, GL_RENDERER e GL_VERSION, de modo que
+// uma mudança nos shaders ou no driver gera um arquivo novo. O driver pode
+// ainda rejeitar um binário (por exemplo, após uma atualização que não altera
+// GL_VERSION); neste caso ProgramCache_Load() retorna 0 e o programa é
+// compilado normalmente, substituindo o arquivo.
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include <glad/glad.h>
+
+bool HasOpenGLExtension(const char *name); // Função definida em main.cpp
+void *GetGLProcAddress(const char *name);  // Função definida em main.cpp
+
+// Constantes e funções de ARB_get_program_binary, ausentes do carregador
+// GLAD deste projeto (gerado somente para o OpenGL 3.3).
+#define PROGRAMCACHE_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define PROGRAMCACHE_PROGRAM_BINARY_LENGTH 0x8741
+#define PROGRAMCACHE_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+
+typedef void (APIENTRYP ProgramCache_GetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (APIENTRYP ProgramCache_ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (APIENTRYP ProgramCache_ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+
+static ProgramCache_GetProgramBinaryProc g_GetProgramBinary = NULL;
+static ProgramCache_ProgramBinaryProc g_ProgramBinary = NULL;
+static ProgramCache_ProgramParameteriProc g_ProgramParameteri = NULL;
+
+static bool g_ProgramCacheEnabled = false;
+static std::string g_ProgramCacheDirectory;
+static std::string g_ProgramCacheDriver; // GL_VENDOR, GL_RENDERER e GL_VERSION
+
+// Estatísticas desde ProgramCache_Init()
+static int g_ProgramCacheHits = 0;
+static int g_ProgramCacheMisses = 0;
+static int g_ProgramCacheRejected = 0;
+
+// Cabeçalho de cada arquivo do cache, seguido de "length" bytes do binário.
+struct ProgramCacheHeader
+{
+    char magic[4];           // "PBIN"
+    unsigned long long hash; // Hash que identifica o programa (confere com o nome do arquivo)
+    GLenum binary_format;    // Formato retornado por glGetProgramBinary()
+    GLsizei length;
+};
+
+static unsigned long long ProgramCache_Hash(const std::string &vertex_source, const std::string &fragment_source)
+{
+    const std::string *parts[3] = {&g_ProgramCacheDriver, &vertex_source, &fragment_source};
+
+    unsigned long long hash = 14695981039346656037ULL;
+    for (int p = 0; p < 3; ++p)
+    {
+        const std::string &part = *parts[p];
+        for (size_t i = 0; i < part.size(); ++i)
+        {
+            hash ^= (unsigned char)part[i];
+            hash *= 1099511628211ULL;
+        }
+
+        // Separador, para que a divisão entre as partes faça parte do hash
+        hash ^= 0xFF;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static std::string ProgramCache_Filename(unsigned long long hash)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.bin", hash);
+    return g_ProgramCacheDirectory + name;
+}
+
+// Habilita o cache, com os arquivos guardados em "directory" (criado caso não
+// exista). Deve ser chamada após a criação do contexto OpenGL. Sem suporte do
+// driver a binários de programas, o cache fica desabilitado e todos os
+// programas são compilados.
+void ProgramCache_Init(const char *directory)
+{
+    g_ProgramCacheEnabled = false;
+
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (major * 10 + minor < 41 && !HasOpenGLExtension("GL_ARB_get_program_binary"))
+    {
+        printf("Cache de programas: desabilitado (sem suporte a ARB_get_program_binary)\n");
+        return;
+    }
+
+    g_GetProgramBinary = (ProgramCache_GetProgramBinaryProc)GetGLProcAddress("glGetProgramBinary");
+    g_ProgramBinary = (ProgramCache_ProgramBinaryProc)GetGLProcAddress("glProgramBinary");
+    g_ProgramParameteri = (ProgramCache_ProgramParameteriProc)GetGLProcAddress("glProgramParameteri");
+
+    // Alguns drivers anunciam a extensão sem suportar formato binário algum.
+    GLint num_formats = 0;
+    glGetIntegerv(PROGRAMCACHE_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+    if (g_GetProgramBinary == NULL || g_ProgramBinary == NULL || num_formats == 0)
+    {
+        printf("Cache de programas: desabilitado (nenhum formato binário suportado)\n");
+        return;
+    }
+
+#if defined(_WIN32)
+    _mkdir(directory);
+#else
+    mkdir(directory, 0755);
+#endif
+
+    g_ProgramCacheDirectory = directory;
+    g_ProgramCacheDriver = std::string((const char *)glGetString(GL_VENDOR)) + '\n' +
+                           (const char *)glGetString(GL_RENDERER) + '\n' +
+                           (const char *)glGetString(GL_VERSION);
+    g_ProgramCacheEnabled = true;
+}
+
+// Marca um programa, antes de ser linkado, como destinado ao cache. Sem esta
+// indicação alguns drivers não guardam o binário do programa linkado.
+void ProgramCache_PrepareLink(GLuint program_id)
+{
+    if (g_ProgramCacheEnabled && g_ProgramParameteri != NULL)
+        g_ProgramParameteri(program_id, PROGRAMCACHE_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+// Cria um programa a partir do binário guardado para os shaders com os
+// códigos dados. Retorna 0 se o cache estiver desabilitado, se não existir
+// binário para estes shaders, ou se o driver rejeitar o binário; nestes
+// casos o programa deve ser compilado e entregue a ProgramCache_Store().
+GLuint ProgramCache_Load(const std::string &vertex_source, const std::string &fragment_source)
+{
+    if (!g_ProgramCacheEnabled)
+        return 0;
+
+    unsigned long long hash = ProgramCache_Hash(vertex_source, fragment_source);
+
+    FILE *file = fopen(ProgramCache_Filename(hash).c_str(), "rb");
+    if (file == NULL)
+    {
+        g_ProgramCacheMisses += 1;
+        return 0;
+    }
+
+    ProgramCacheHeader header;
+    std::vector<char> binary;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+                 std::string(header.magic, 4) == "PBIN" && header.hash == hash && header.length > 0;
+    if (valid)
+    {
+        binary.resize(header.length);
+        valid = fread(&binary[0], 1, binary.size(), file) == binary.size();
+    }
+    fclose(file);
+
+    if (!valid)
+    {
+        g_ProgramCacheRejected += 1;
+        return 0;
+    }
+
+    GLuint program_id = glCreateProgram();
+    g_ProgramBinary(program_id, header.binary_format, &binary[0], header.length);
+
+    // Um binário rejeitado deixa o programa sem linkagem válida (e, caso o
+    // formato não seja mais suportado, gera GL_INVALID_ENUM, o qual
+    // descartamos).
+    GLint linked_ok = GL_FALSE;
+    glGetProgramiv(program_id, GL_LINK_STATUS, &linked_ok);
+    if (linked_ok == GL_FALSE)
+    {
+        while (glGetError() != GL_NO_ERROR)
+            ;
+        glDeleteProgram(program_id);
+        g_ProgramCacheRejected += 1;
+        return 0;
+    }
+
+    g_ProgramCacheHits += 1;
+    return program_id;
+}
+
+// Guarda no cache o binário do programa "program_id", recém linkado a partir
+// dos shaders com os códigos dados.
+void ProgramCache_Store(const std::string &vertex_source, const std::string &fragment_source, GLuint program_id)
+{
+    if (!g_ProgramCacheEnabled)
+        return;
+
+    GLint linked_ok = GL_FALSE;
+    glGetProgramiv(program_id, GL_LINK_STATUS, &linked_ok);
+
+    GLint length = 0;
+    glGetProgramiv(program_id, PROGRAMCACHE_PROGRAM_BINARY_LENGTH, &length);
+    if (linked_ok == GL_FALSE || length <= 0)
+        return;
+
+    ProgramCacheHeader header;
+    header.magic[0] = 'P';
+    header.magic[1] = 'B';
+    header.magic[2] = 'I';
+    header.magic[3] = 'N';
+    header.hash = ProgramCache_Hash(vertex_source, fragment_source);
+
+    std::vector<char> binary(length);
+    g_GetProgramBinary(program_id, length, &header.length, &header.binary_format, &binary[0]);
+    if (header.length <= 0)
+        return;
+
+    std::string filename = ProgramCache_Filename(header.hash);
+    FILE *file = fopen(filename.c_str(), "wb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "WARNING: Cannot write shader cache file \"%s\".\n", filename.c_str());
+        return;
+    }
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(&binary[0], 1, header.length, file);
+    fclose(file);
+}
+
+void ProgramCache_PrintStats()
+{
+    if (!g_ProgramCacheEnabled)
+        return;
+
+    printf("Cache de programas: %d carregados de \"%s\", %d compilados, %d rejeitados\n",
+           g_ProgramCacheHits, g_ProgramCacheDirectory.c_str(), g_ProgramCacheMisses + g_ProgramCacheRejected, g_ProgramCacheRejected);
+}
@@ -0,0 +1,631 @@
+// Teste de regressão de imagem e de desempenho (opção "--regression
+// <roteiro>"; veja RunRegression() em "main.cpp"). A cena é desenhada sem
+// janela em poses fixas da câmera, e cada imagem é comparada com a imagem de
+// referência ("golden") da pose, e o tempo por quadro, as chamadas de desenho
+// e os triângulos com os valores de referência. Cada pose é desenhada em
+// várias execuções, que percorrem as poses em rodízio, e o tempo por quadro
+// considerado é a menor das medianas das execuções: o mínimo é pouco afetado
+// por interrupções do sistema e por outros processos, que só tornam um
+// quadro mais lento. Além de cada pose, é verificada a soma dos tempos de
+// todas as poses, cuja variação entre execuções do programa é bem menor que
+// a de cada pose, e que admite portanto uma tolerância mais estreita. Uma otimização (culling,
+// submissão em lote, ...) não deve alterar as imagens nem piorar os números;
+// o programa termina com erro se alguma pose falhar. Com "--update-golden",
+// as referências são (re)gravadas a partir da execução atual.
+//
+// Formato do roteiro, um comando por linha ('#' inicia um comentário):
+//
+//   size <largura> <altura>             Tamanho das imagens, em pixels
+//   frames <n>                          Quadros desenhados por execução
+//   runs <n>                            Execuções de cada pose
+//   golden <diretório>                  Diretório das referências
+//   image_tolerance <delta_e> <pct>     Diferença de cor tolerada por pixel,
+//                                       e porcentagem de pixels que podem
+//                                       excedê-la
+//   time_tolerance <pct> [<ms>]         Aumento tolerado do tempo por quadro
+//                                       das poses seguintes, em porcentagem
+//                                       e, opcionalmente, em milissegundos:
+//                                       só é regressão o aumento que excede
+//                                       os dois limites
+//   total_time_tolerance <pct>          Aumento tolerado da soma dos tempos
+//                                       por quadro de todas as poses
+//   count_tolerance <pct>               Aumento tolerado das chamadas de
+//                                       desenho e dos triângulos
+//   set <nome> <valor>                  Força uma variável em todas as poses
+//                                       (veja SetBenchmarkVariable())
+//   pose <nome> <px py pz> <lx ly lz>   Posição da câmera e ponto observado
+//
+// A diferença de cor é a distância euclidiana no espaço CIELAB (delta E
+// 1976), onde uma distância de aproximadamente 2,3 é a menor diferença
+// perceptível: pequenas variações de arredondamento entre drivers são
+// toleradas, mas um objeto ausente ou uma textura errada, não.
+//
+// Referências: "<diretório>/<pose>.png" e "<diretório>/baseline.csv". Se
+// "baseline.csv" não existe (por exemplo, em um clone novo do repositório),
+// a execução grava as referências, como com "--update-golden", e não
+// compara nada: as imagens e os tempos dependem da GPU e do driver, e as
+// referências são criadas em cada máquina utilizada para a comparação. Quando
+// uma pose falha, a imagem obtida e um mapa das diferenças (pixels acima da
+// tolerância em vermelho) são gravados em "regression_<pose>_actual.png" e
+// "regression_<pose>_diff.png", no diretório atual.
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <stb_image.h>
+
+struct RegressionPose
+{
+    std::string name;
+    glm::vec3 position;
+    glm::vec3 target;
+    double time_percent; // Tolerâncias do tempo por quadro (veja "time_tolerance")
+    double time_ms;
+};
+
+struct RegressionStateChange
+{
+    std::string name;
+    int value;
+};
+
+// Valores de referência de uma pose (uma linha de "baseline.csv").
+struct RegressionBaseline
+{
+    std::string pose;
+    double frame_ms;
+    int draw_calls;
+    long triangles;
+};
+
+static std::string g_RegressionGoldenDirectory;
+static int g_RegressionWidth = 640;
+static int g_RegressionHeight = 360;
+static int g_RegressionFrames = 20;
+static int g_RegressionRuns = 5;
+static double g_RegressionDeltaE = 3.0;
+static double g_RegressionPixelPercent = 0.01;
+static double g_RegressionTimePercent = 15.0;
+static double g_RegressionTimeMs = 1.0;
+static double g_RegressionTotalTimePercent = 10.0;
+static double g_RegressionCountPercent = 0.0;
+static std::vector<RegressionPose> g_RegressionPoses;
+static std::vector<RegressionStateChange> g_RegressionStateChanges;
+static std::vector<RegressionBaseline> g_RegressionBaselines; // Lidos de "baseline.csv"
+static std::vector<RegressionBaseline> g_RegressionResults;   // Desta execução
+static int g_RegressionFailures = 0;
+
+// Lê o roteiro "filename". Retorna false, após imprimir o erro, se o arquivo
+// não existe ou é inválido.
+bool Regression_LoadScript(const char *filename)
+{
+    std::ifstream file(filename);
+    if (!file)
+    {
+        fprintf(stderr, "ERROR: Cannot open regression script \"%s\".\n", filename);
+        return false;
+    }
+
+    // Por padrão, as referências ficam ao lado do roteiro, em
+    // "<roteiro sem extensão>_golden".
+    g_RegressionGoldenDirectory = filename;
+    std::string::size_type dot = g_RegressionGoldenDirectory.find_last_of('.');
+    std::string::size_type slash = g_RegressionGoldenDirectory.find_last_of("/\\");
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+        g_RegressionGoldenDirectory.erase(dot);
+    g_RegressionGoldenDirectory += "_golden";
+
+    g_RegressionPoses.clear();
+    g_RegressionStateChanges.clear();
+
+    std::string line;
+    for (int line_number = 1; std::getline(file, line); ++line_number)
+    {
+        std::string::size_type comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+
+        std::istringstream tokens(line);
+        std::string command;
+        if (!(tokens >> command))
+            continue;
+
+        bool ok;
+        if (command == "size")
+        {
+            ok = (tokens >> g_RegressionWidth >> g_RegressionHeight) && g_RegressionWidth > 0 && g_RegressionHeight > 0;
+        }
+        else if (command == "frames")
+        {
+            ok = (tokens >> g_RegressionFrames) && g_RegressionFrames > 0;
+        }
+        else if (command == "runs")
+        {
+            ok = (tokens >> g_RegressionRuns) && g_RegressionRuns > 0;
+        }
+        else if (command == "golden")
+        {
+            ok = !!(tokens >> g_RegressionGoldenDirectory);
+        }
+        else if (command == "image_tolerance")
+        {
+            ok = (tokens >> g_RegressionDeltaE >> g_RegressionPixelPercent) && g_RegressionDeltaE >= 0.0 && g_RegressionPixelPercent >= 0.0;
+        }
+        else if (command == "time_tolerance")
+        {
+            ok = (tokens >> g_RegressionTimePercent) && g_RegressionTimePercent >= 0.0;
+            if (ok && !(tokens >> g_RegressionTimeMs))
+            {
+                tokens.clear();
+                g_RegressionTimeMs = 1.0;
+            }
+            ok = ok && g_RegressionTimeMs >= 0.0;
+        }
+        else if (command == "total_time_tolerance")
+        {
+            ok = (tokens >> g_RegressionTotalTimePercent) && g_RegressionTotalTimePercent >= 0.0;
+        }
+        else if (command == "count_tolerance")
+        {
+            ok = (tokens >> g_RegressionCountPercent) && g_RegressionCountPercent >= 0.0;
+        }
+        else if (command == "set")
+        {
+            RegressionStateChange change;
+            ok = !!(tokens >> change.name >> change.value);
+            g_RegressionStateChanges.push_back(change);
+        }
+        else if (command == "pose")
+        {
+            RegressionPose pose;
+            ok = !!(tokens >> pose.name >> pose.position.x >> pose.position.y >> pose.position.z >> pose.target.x >> pose.target.y >> pose.target.z);
+            pose.time_percent = g_RegressionTimePercent;
+            pose.time_ms = g_RegressionTimeMs;
+            g_RegressionPoses.push_back(pose);
+        }
+        else
+        {
+            ok = false;
+        }
+
+        std::string extra;
+        if (!ok || (tokens >> extra))
+        {
+            fprintf(stderr, "ERROR: %s:%d: invalid regression command \"%s\".\n", filename, line_number, line.c_str());
+            return false;
+        }
+    }
+
+    if (g_RegressionPoses.empty())
+    {
+        fprintf(stderr, "ERROR: %s: no camera poses.\n", filename);
+        return false;
+    }
+
+    printf("Regressão: roteiro \"%s\", %d poses %dx%d, %d execuções de %d quadros por pose, referências em \"%s\"\n",
+           filename, (int)g_RegressionPoses.size(), g_RegressionWidth, g_RegressionHeight, g_RegressionRuns, g_RegressionFrames,
+           g_RegressionGoldenDirectory.c_str());
+    return true;
+}
+
+int Regression_Width()
+{
+    return g_RegressionWidth;
+}
+
+int Regression_Height()
+{
+    return g_RegressionHeight;
+}
+
+int Regression_Frames()
+{
+    return g_RegressionFrames;
+}
+
+int Regression_Runs()
+{
+    return g_RegressionRuns;
+}
+
+int Regression_NumStateChanges()
+{
+    return (int)g_RegressionStateChanges.size();
+}
+
+// Retorna o nome da variável da mudança de estado "index", e o seu valor em
+// "value".
+const char *Regression_StateChange(int index, int *value)
+{
+    *value = g_RegressionStateChanges[index].value;
+    return g_RegressionStateChanges[index].name.c_str();
+}
+
+int Regression_NumPoses()
+{
+    return (int)g_RegressionPoses.size();
+}
+
+// Retorna o nome da pose "index", e a posição da câmera e o ponto para onde
+// ela olha em "position" e "look_at".
+const char *Regression_Pose(int index, glm::vec4 &position, glm::vec4 &look_at)
+{
+    const RegressionPose &pose = g_RegressionPoses[index];
+    position = glm::vec4(pose.position.x, pose.position.y, pose.position.z, 1.0f);
+    look_at = glm::vec4(pose.target.x, pose.target.y, pose.target.z, 1.0f);
+    return pose.name.c_str();
+}
+
+// CRC-32 dos blocos PNG (polinômio 0xEDB88320).
+static unsigned int Regression_Crc32(unsigned int crc, const unsigned char *data, size_t size)
+{
+    static unsigned int table[256];
+    if (table[1] == 0)
+        for (unsigned int n = 0; n < 256; ++n)
+        {
+            unsigned int c = n;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i)
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void Regression_PutU32(std::vector<unsigned char> &out, unsigned int value)
+{
+    out.push_back((value >> 24) & 0xff);
+    out.push_back((value >> 16) & 0xff);
+    out.push_back((value >> 8) & 0xff);
+    out.push_back(value & 0xff);
+}
+
+static void Regression_WriteChunk(FILE *file, const char *type, const std::vector<unsigned char> &data)
+{
+    std::vector<unsigned char> chunk;
+    Regression_PutU32(chunk, (unsigned int)data.size());
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    Regression_PutU32(chunk, Regression_Crc32(0, &chunk[4], chunk.size() - 4));
+    fwrite(chunk.data(), 1, chunk.size(), file);
+}
+
+// Grava uma imagem RGB (linhas de cima para baixo) em PNG. Os dados são
+// guardados em blocos "deflate" sem compressão: o arquivo é maior, mas não
+// dependemos da zlib, e qualquer leitor de PNG (incluindo a stb_image) o lê.
+static bool Regression_WritePNG(const char *filename, int width, int height, const std::vector<unsigned char> &pixels)
+{
+    FILE *file = fopen(filename, "wb");
+    if (file == NULL)
+        return false;
+
+    static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    fwrite(signature, 1, sizeof(signature), file);
+
+    std::vector<unsigned char> header;
+    Regression_PutU32(header, width);
+    Regression_PutU32(header, height);
+    header.push_back(8); // Bits por canal
+    header.push_back(2); // RGB
+    header.push_back(0); // Compressão "deflate"
+    header.push_back(0); // Filtros adaptativos (usamos sempre o filtro 0)
+    header.push_back(0); // Sem entrelaçamento
+    Regression_WriteChunk(file, "IHDR", header);
+
+    // Linhas da imagem, cada uma precedida pelo tipo do filtro (0, nenhum).
+    size_t row_size = 3 * (size_t)width;
+    std::vector<unsigned char> raw;
+    raw.reserve((row_size + 1) * height);
+    for (int y = 0; y < height; ++y)
+    {
+        raw.push_back(0);
+        raw.insert(raw.end(), pixels.begin() + y * row_size, pixels.begin() + (y + 1) * row_size);
+    }
+
+    // Fluxo zlib com blocos "stored" de até 65535 bytes, e o Adler-32 dos
+    // dados no final.
+    std::vector<unsigned char> zlib;
+    zlib.push_back(0x78);
+    zlib.push_back(0x01);
+    unsigned int adler_a = 1, adler_b = 0;
+    for (size_t offset = 0; offset < raw.size(); offset += 65535)
+    {
+        size_t length = std::min(raw.size() - offset, (size_t)65535);
+        zlib.push_back(offset + length == raw.size() ? 1 : 0); // Último bloco
+        zlib.push_back(length & 0xff);
+        zlib.push_back((length >> 8) & 0xff);
+        zlib.push_back(~length & 0xff);
+        zlib.push_back((~length >> 8) & 0xff);
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + length);
+
+        for (size_t i = offset; i < offset + length; ++i)
+        {
+            adler_a = (adler_a + raw[i]) % 65521;
+            adler_b = (adler_b + adler_a) % 65521;
+        }
+    }
+    Regression_PutU32(zlib, (adler_b << 16) | adler_a);
+    Regression_WriteChunk(file, "IDAT", zlib);
+
+    Regression_WriteChunk(file, "IEND", std::vector<unsigned char>());
+
+    bool ok = ferror(file) == 0;
+    if (fclose(file) != 0)
+        ok = false;
+    return ok;
+}
+
+// Converte uma cor sRGB de 8 bits para o espaço CIELAB (iluminante D65).
+static glm::vec3 Regression_SrgbToLab(const unsigned char *rgb)
+{
+    float linear[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        float c = rgb[i] / 255.0f;
+        linear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+
+    // XYZ normalizado pelo branco de referência.
+    float xyz[3] = {
+        (0.4124f * linear[0] + 0.3576f * linear[1] + 0.1805f * linear[2]) / 0.95047f,
+        (0.2126f * linear[0] + 0.7152f * linear[1] + 0.0722f * linear[2]) / 1.00000f,
+        (0.0193f * linear[0] + 0.1192f * linear[1] + 0.9505f * linear[2]) / 1.08883f,
+    };
+    for (int i = 0; i < 3; ++i)
+        xyz[i] = xyz[i] > 0.008856f ? std::cbrt(xyz[i]) : 7.787f * xyz[i] + 16.0f / 116.0f;
+
+    return glm::vec3(116.0f * xyz[1] - 16.0f, 500.0f * (xyz[0] - xyz[1]), 200.0f * (xyz[1] - xyz[2]));
+}
+
+// Compara a imagem obtida com a de referência. Retorna a porcentagem de
+// pixels com diferença acima de g_RegressionDeltaE e a maior diferença, e
+// preenche "diff" com o mapa das diferenças.
+static double Regression_CompareImages(const std::vector<unsigned char> &actual, const unsigned char *golden, size_t num_pixels,
+                                       double *max_delta_e, std::vector<unsigned char> &diff)
+{
+    size_t different = 0;
+    *max_delta_e = 0.0;
+    diff.resize(3 * num_pixels);
+    for (size_t i = 0; i < num_pixels; ++i)
+    {
+        const unsigned char *a = &actual[3 * i];
+        const unsigned char *g = &golden[3 * i];
+        double delta_e = 0.0;
+        if (a[0] != g[0] || a[1] != g[1] || a[2] != g[2])
+        {
+            glm::vec3 d = Regression_SrgbToLab(a) - Regression_SrgbToLab(g);
+            delta_e = std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z);
+        }
+        *max_delta_e = std::max(*max_delta_e, delta_e);
+
+        // Pixels acima da tolerância em vermelho, sobre a imagem obtida
+        // esmaecida.
+        if (delta_e > g_RegressionDeltaE)
+        {
+            different += 1;
+            diff[3 * i + 0] = 255;
+            diff[3 * i + 1] = 0;
+            diff[3 * i + 2] = 0;
+        }
+        else
+        {
+            unsigned char gray = (unsigned char)(191 + (a[0] + a[1] + a[2]) / 12);
+            diff[3 * i + 0] = diff[3 * i + 1] = diff[3 * i + 2] = gray;
+        }
+    }
+    return 100.0 * different / num_pixels;
+}
+
+static const RegressionBaseline *Regression_FindBaseline(const std::string &pose)
+{
+    for (size_t i = 0; i < g_RegressionBaselines.size(); ++i)
+        if (g_RegressionBaselines[i].pose == pose)
+            return &g_RegressionBaselines[i];
+    return NULL;
+}
+
+// Prepara a execução: lê os valores de referência ou, com "update", cria o
+// diretório das referências. Se as referências não existem, liga "update":
+// esta execução as grava (veja Regression_End()).
+void Regression_Begin(bool &update)
+{
+    g_RegressionResults.clear();
+    g_RegressionFailures = 0;
+
+    std::string filename = g_RegressionGoldenDirectory + "/baseline.csv";
+    std::ifstream file;
+    if (!update)
+    {
+        file.open(filename.c_str());
+        if (!file)
+        {
+            printf("Regressão: \"%s\" não existe; gravando as referências nesta execução (execute novamente para comparar)\n", filename.c_str());
+            update = true;
+        }
+    }
+
+    if (update)
+    {
+#if defined(_WIN32)
+        _mkdir(g_RegressionGoldenDirectory.c_str());
+#else
+        mkdir(g_RegressionGoldenDirectory.c_str(), 0755);
+#endif
+        return;
+    }
+
+    g_RegressionBaselines.clear();
+    std::string line;
+    std::getline(file, line); // Cabeçalho
+    while (std::getline(file, line))
+    {
+        std::replace(line.begin(), line.end(), ',', ' ');
+        std::istringstream tokens(line);
+        RegressionBaseline baseline;
+        if (tokens >> baseline.pose >> baseline.frame_ms >> baseline.draw_calls >> baseline.triangles)
+            g_RegressionBaselines.push_back(baseline);
+    }
+}
+
+// Verifica se "value" excede "reference" em mais de "percent" por cento e em
+// mais de "absolute", imprimindo a comparação. O limite absoluto evita que
+// variações pequenas em tempos curtos, de poucos décimos de milissegundo,
+// excedam a porcentagem.
+static bool Regression_CheckValue(const char *name, double value, double reference, double percent, double absolute, const char *format)
+{
+    bool regressed = value > reference * (1.0 + percent / 100.0) && value - reference > absolute;
+    double change = reference > 0.0 ? 100.0 * (value - reference) / reference : 0.0;
+    printf("    %s: ", name);
+    printf(format, value);
+    printf(" (referência ");
+    printf(format, reference);
+    printf(", %+.1f%%)%s\n", change, regressed ? "  REGRESSÃO" : "");
+    return !regressed;
+}
+
+// Verifica a pose "index" desenhada: a imagem "pixels" (RGB, linhas de cima
+// para baixo), o tempo por quadro (a menor mediana das execuções) e as
+// contagens do último quadro. Com "update", grava a imagem como referência. Retorna false se a
+// pose falhou.
+bool Regression_CheckPose(int index, const std::vector<unsigned char> &pixels, double frame_ms, int draw_calls, size_t triangles, bool update)
+{
+    const RegressionPose &pose = g_RegressionPoses[index];
+    std::string golden_filename = g_RegressionGoldenDirectory + "/" + pose.name + ".png";
+
+    RegressionBaseline result;
+    result.pose = pose.name;
+    result.frame_ms = frame_ms;
+    result.draw_calls = draw_calls;
+    result.triangles = (long)triangles;
+    g_RegressionResults.push_back(result);
+
+    if (update)
+    {
+        bool ok = Regression_WritePNG(golden_filename.c_str(), g_RegressionWidth, g_RegressionHeight, pixels);
+        printf("  %-20s %.2f ms, %d chamadas de desenho, %ld triângulos%s\n", pose.name.c_str(), frame_ms, draw_calls, (long)triangles,
+               ok ? "" : "  ERRO ao gravar a imagem");
+        if (!ok)
+            g_RegressionFailures += 1;
+        return ok;
+    }
+
+    bool passed = true;
+    printf("  %s\n", pose.name.c_str());
+
+    // Imagem
+    // LoadTextureImage() liga a inversão vertical das imagens lidas (as
+    // texturas têm a origem embaixo); aqui as linhas vêm de cima para baixo.
+    int width, height, channels;
+    stbi_set_flip_vertically_on_load(false);
+    unsigned char *golden = stbi_load(golden_filename.c_str(), &width, &height, &channels, 3);
+    std::vector<unsigned char> diff;
+    if (golden == NULL)
+    {
+        printf("    imagem: referência \"%s\" ausente  FALHA\n", golden_filename.c_str());
+        passed = false;
+    }
+    else if (width != g_RegressionWidth || height != g_RegressionHeight)
+    {
+        printf("    imagem: referência %dx%d, esperado %dx%d  FALHA\n", width, height, g_RegressionWidth, g_RegressionHeight);
+        passed = false;
+    }
+    else
+    {
+        double max_delta_e;
+        double percent = Regression_CompareImages(pixels, golden, (size_t)width * height, &max_delta_e, diff);
+        bool image_ok = percent <= g_RegressionPixelPercent;
+        printf("    imagem: %.3f%% dos pixels com delta E > %.1f (máximo %.1f)%s\n", percent, g_RegressionDeltaE, max_delta_e,
+               image_ok ? "" : "  FALHA");
+        passed = passed && image_ok;
+    }
+    if (golden != NULL)
+        stbi_image_free(golden);
+
+    // Desempenho
+    const RegressionBaseline *baseline = Regression_FindBaseline(pose.name);
+    if (baseline == NULL)
+    {
+        printf("    desempenho: sem referência em baseline.csv  FALHA\n");
+        passed = false;
+    }
+    else
+    {
+        passed = Regression_CheckValue("tempo (ms)", frame_ms, baseline->frame_ms, pose.time_percent, pose.time_ms, "%.2f") && passed;
+        passed = Regression_CheckValue("chamadas", draw_calls, baseline->draw_calls, g_RegressionCountPercent, 0.0, "%.0f") && passed;
+        passed = Regression_CheckValue("triângulos", (double)triangles, (double)baseline->triangles, g_RegressionCountPercent, 0.0, "%.0f") && passed;
+    }
+
+    // Imagens para inspeção das falhas.
+    if (!passed)
+    {
+        std::string prefix = "regression_" + pose.name;
+        Regression_WritePNG((prefix + "_actual.png").c_str(), g_RegressionWidth, g_RegressionHeight, pixels);
+        if (!diff.empty())
+            Regression_WritePNG((prefix + "_diff.png").c_str(), g_RegressionWidth, g_RegressionHeight, diff);
+        g_RegressionFailures += 1;
+    }
+    return passed;
+}
+
+// Termina a execução: com "update", grava "baseline.csv"; senão, imprime o
+// resultado. Retorna false se alguma pose falhou.
+bool Regression_End(bool update)
+{
+    if (update)
+    {
+        std::string filename = g_RegressionGoldenDirectory + "/baseline.csv";
+        FILE *file = fopen(filename.c_str(), "w");
+        if (file == NULL)
+        {
+            fprintf(stderr, "ERROR: Cannot write \"%s\".\n", filename.c_str());
+            return false;
+        }
+        fprintf(file, "pose,frame_ms,draw_calls,triangles\n");
+        for (size_t i = 0; i < g_RegressionResults.size(); ++i)
+        {
+            const RegressionBaseline &result = g_RegressionResults[i];
+            fprintf(file, "%s,%.4f,%d,%ld\n", result.pose.c_str(), result.frame_ms, result.draw_calls, result.triangles);
+        }
+        fclose(file);
+        printf("Regressão: referências gravadas em \"%s\"\n", g_RegressionGoldenDirectory.c_str());
+        return g_RegressionFailures == 0;
+    }
+
+    // Soma dos tempos das poses com referência.
+    double total_ms = 0.0, total_reference_ms = 0.0;
+    for (size_t i = 0; i < g_RegressionResults.size(); ++i)
+    {
+        const RegressionBaseline *baseline = Regression_FindBaseline(g_RegressionResults[i].pose);
+        if (baseline == NULL)
+            continue;
+        total_ms += g_RegressionResults[i].frame_ms;
+        total_reference_ms += baseline->frame_ms;
+    }
+    printf("  todas as poses\n");
+    bool total_ok = Regression_CheckValue("tempo total (ms)", total_ms, total_reference_ms, g_RegressionTotalTimePercent, 0.0, "%.2f");
+
+    int num_poses = (int)g_RegressionPoses.size();
+    if (g_RegressionFailures == 0 && total_ok)
+        printf("Regressão: %d poses OK\n", num_poses);
+    else if (g_RegressionFailures == 0)
+        printf("Regressão: tempo total FALHOU\n");
+    else
+        printf("Regressão: %d de %d poses FALHARAM%s\n", g_RegressionFailures, num_poses, total_ok ? "" : ", e o tempo total");
+    return g_RegressionFailures == 0 && total_ok;
+}
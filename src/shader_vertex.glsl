@@ -1,5 +1,9 @@
 #version 330 core
 
+#ifdef MULTI_DRAW
+#extension GL_ARB_shader_draw_parameters : enable
+#endif
+
 // Atributos de vrtice recebidos como entrada ("in") pelo Vertex Shader.
 // Veja a funo BuildTrianglesAndAddToVirtualScene() em "main.cpp".
 layout (location = 0) in vec4 model_coefficients;
@@ -7,21 +11,61 @@ layout (location = 1) in vec4 normal_coefficients;
 layout (location = 2) in vec2 texture_coefficients;
 
 // Matrizes computadas no cdigo C++ e enviadas para a GPU
-uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+#ifdef MULTI_DRAW
+// Submisso em lote (veja SubmitDrawList_MultiDraw() em "main.cpp"): os dados
+// de cada objeto so lidos de um "texture buffer", com DRAW_DATA_TEXELS texels
+// RGBA32F por objeto: matriz "model" (4 colunas) e a matriz das normais
+// (4 colunas).
+#define DRAW_DATA_TEXELS 8
+uniform samplerBuffer draw_data;
+uniform int draw_offset; // Posio do primeiro objeto do lote dentro de draw_data
+
+// Sem a extenso, cada malha do lote  desenhada com instancing e o ndice
+// da instncia identifica o objeto.
+#ifdef GL_ARB_shader_draw_parameters
+#define DRAW_INDEX (draw_offset + gl_DrawIDARB)
+#else
+#define DRAW_INDEX (draw_offset + gl_InstanceID)
+#endif
+#else
+uniform mat4 model;
+
+// Transposta da inversa de "model", calculada na CPU uma vez por objeto (veja
+// ComputeDerivedUniforms() em "main.cpp").
+uniform mat4 normal_matrix;
+#endif
+
 // Atributos de vrtice que sero gerados como sada ("out") pelo Vertex Shader.
 // ** Estes sero interpolados pelo rasterizador! ** gerando, assim, valores
 // para cada fragmento, os quais sero recebidos como entrada pelo Fragment
 // Shader. Veja o arquivo "shader_fragment.glsl".
 out vec4 position_world;
-out vec4 position_model;
 out vec4 normal;
 out vec2 texcoords;
 
+// A posio final  calculada de forma idntica por todos os programas criados
+// a partir deste arquivo. Assim a passada de profundidade (veja SubmitDrawList()
+// em "main.cpp") e a passada principal, com glDepthFunc(GL_EQUAL), geram
+// exatamente as mesmas profundidades.
+invariant gl_Position;
+
 void main()
 {
+#ifdef MULTI_DRAW
+    int texel = DRAW_INDEX * DRAW_DATA_TEXELS;
+    mat4 model = mat4(texelFetch(draw_data, texel + 0),
+                      texelFetch(draw_data, texel + 1),
+                      texelFetch(draw_data, texel + 2),
+                      texelFetch(draw_data, texel + 3));
+    mat4 normal_matrix = mat4(texelFetch(draw_data, texel + 4),
+                              texelFetch(draw_data, texel + 5),
+                              texelFetch(draw_data, texel + 6),
+                              texelFetch(draw_data, texel + 7));
+#endif
+
     // A varivel gl_Position define a posio final de cada vrtice
     // OBRIGATORIAMENTE em "normalized device coordinates" (NDC), onde cada
     // coeficiente estar entre -1 e 1 aps diviso por w.
@@ -53,12 +97,11 @@ void main()
     // Posio do vrtice atual no sistema de coordenadas global (World).
     position_world = model * model_coefficients;
 
-    // Posio do vrtice atual no sistema de coordenadas local do modelo.
-    position_model = model_coefficients;
-
     // Normal do vrtice atual no sistema de coordenadas global (World).
     // Veja slides 123-151 do documento Aula_07_Transformacoes_Geometricas_3D.pdf.
-    normal = inverse(transpose(model)) * normal_coefficients;
+    // A matriz inverse(transpose(model))  a mesma para todos os vrtices do
+    // objeto, e por isso  calculada na CPU (varivel "normal_matrix").
+    normal = normal_matrix * normal_coefficients;
     normal.w = 0.0;
 
     // Coordenadas de textura obtidas do arquivo OBJ (se existirem!)
@@ -0,0 +1,190 @@
+// Observação dos arquivos de shaders (src/*.glsl) em uma thread separada. No
+// Linux utilizamos inotify, e a thread fica bloqueada até o sistema
+// operacional notificar a escrita de um arquivo do diretório; nos demais
+// sistemas a thread compara periodicamente a data de modificação de cada
+// arquivo. Os nomes dos arquivos alterados são acumulados em uma fila e
+// consumidos pela thread principal (a única com o contexto OpenGL) através
+// de ShaderWatcher_PollChanges(); veja UpdateShaderReload() em "main.cpp".
+// A cada alteração a thread principal é acordada com glfwPostEmptyEvent(),
+// caso esteja bloqueada esperando por eventos (veja WaitForRedraw()).
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+#include <sys/stat.h>
+#include <dirent.h>
+
+#include <GLFW/glfw3.h>
+
+#if defined(__linux__)
+#define SHADERWATCHER_INOTIFY
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+static std::thread g_ShaderWatcherThread;
+static std::atomic<bool> g_ShaderWatcherRunning(false);
+static std::mutex g_ShaderWatcherMutex;
+static std::vector<std::string> g_ShaderWatcherChanges; // Protegida por g_ShaderWatcherMutex
+
+static std::string g_ShaderWatcherDirectory;
+static std::string g_ShaderWatcherExtension;
+
+// Intervalo com que a thread verifica se deve terminar (e, sem inotify, com
+// que compara as datas de modificação dos arquivos).
+static const int SHADERWATCHER_INTERVAL_MS = 250;
+
+static bool ShaderWatcher_Matches(const char *name)
+{
+    size_t length = strlen(name);
+    size_t extension_length = g_ShaderWatcherExtension.size();
+    return length > extension_length && g_ShaderWatcherExtension == name + length - extension_length;
+}
+
+static void ShaderWatcher_Push(const char *name)
+{
+    {
+        std::lock_guard<std::mutex> lock(g_ShaderWatcherMutex);
+        if (std::find(g_ShaderWatcherChanges.begin(), g_ShaderWatcherChanges.end(), name) == g_ShaderWatcherChanges.end())
+            g_ShaderWatcherChanges.push_back(name);
+    }
+
+    // glfwPostEmptyEvent() pode ser chamada de qualquer thread.
+    glfwPostEmptyEvent();
+}
+
+#if defined(SHADERWATCHER_INOTIFY)
+static void ShaderWatcher_Run(int inotify_fd)
+{
+    // Buffer alinhado para as estruturas inotify_event
+    union
+    {
+        struct inotify_event event;
+        char bytes[4096];
+    } buffer;
+
+    struct pollfd descriptor;
+    descriptor.fd = inotify_fd;
+    descriptor.events = POLLIN;
+
+    while (g_ShaderWatcherRunning)
+    {
+        if (poll(&descriptor, 1, SHADERWATCHER_INTERVAL_MS) <= 0)
+            continue;
+
+        ssize_t length = read(inotify_fd, buffer.bytes, sizeof(buffer.bytes));
+        for (ssize_t offset = 0; offset < length;)
+        {
+            const struct inotify_event *event = (const struct inotify_event *)(buffer.bytes + offset);
+            if (event->len > 0 && ShaderWatcher_Matches(event->name))
+                ShaderWatcher_Push(event->name);
+            offset += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+    close(inotify_fd);
+}
+#else
+// Lê a data de modificação de todos os arquivos observados do diretório.
+static void ShaderWatcher_Scan(std::map<std::string, time_t> &times)
+{
+    times.clear();
+    DIR *directory = opendir(g_ShaderWatcherDirectory.c_str());
+    if (directory == NULL)
+        return;
+
+    while (struct dirent *entry = readdir(directory))
+    {
+        if (!ShaderWatcher_Matches(entry->d_name))
+            continue;
+
+        struct stat info;
+        std::string path = g_ShaderWatcherDirectory + "/" + entry->d_name;
+        if (stat(path.c_str(), &info) == 0)
+            times[entry->d_name] = info.st_mtime;
+    }
+    closedir(directory);
+}
+
+static void ShaderWatcher_Run()
+{
+    std::map<std::string, time_t> previous, current;
+    ShaderWatcher_Scan(previous);
+
+    while (g_ShaderWatcherRunning)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(SHADERWATCHER_INTERVAL_MS));
+
+        ShaderWatcher_Scan(current);
+        for (std::map<std::string, time_t>::iterator it = current.begin(); it != current.end(); ++it)
+        {
+            std::map<std::string, time_t>::iterator old = previous.find(it->first);
+            if (old == previous.end() || old->second != it->second)
+                ShaderWatcher_Push(it->first.c_str());
+        }
+        previous.swap(current);
+    }
+}
+#endif
+
+// Inicia a observação dos arquivos com extensão "extension" (por exemplo
+// ".glsl") no diretório "directory". Retorna false se não foi possível
+// observar o diretório.
+bool ShaderWatcher_Start(const char *directory, const char *extension)
+{
+    if (g_ShaderWatcherRunning)
+        return true;
+
+    g_ShaderWatcherDirectory = directory;
+    g_ShaderWatcherExtension = extension;
+
+#if defined(SHADERWATCHER_INOTIFY)
+    int inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0)
+        return false;
+
+    // Editores salvam arquivos escrevendo neles diretamente (IN_CLOSE_WRITE)
+    // ou escrevendo uma cópia e renomeando-a sobre o original (IN_MOVED_TO).
+    if (inotify_add_watch(inotify_fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        fprintf(stderr, "WARNING: Cannot watch directory \"%s\".\n", directory);
+        close(inotify_fd);
+        return false;
+    }
+
+    g_ShaderWatcherRunning = true;
+    g_ShaderWatcherThread = std::thread(ShaderWatcher_Run, inotify_fd);
+#else
+    g_ShaderWatcherRunning = true;
+    g_ShaderWatcherThread = std::thread(ShaderWatcher_Run);
+#endif
+    return true;
+}
+
+// Move para "changed" os nomes dos arquivos alterados desde a chamada
+// anterior. Retorna true se algum arquivo foi alterado.
+bool ShaderWatcher_PollChanges(std::vector<std::string> &changed)
+{
+    changed.clear();
+
+    std::lock_guard<std::mutex> lock(g_ShaderWatcherMutex);
+    changed.swap(g_ShaderWatcherChanges);
+    return !changed.empty();
+}
+
+void ShaderWatcher_Stop()
+{
+    if (!g_ShaderWatcherRunning)
+        return;
+
+    g_ShaderWatcherRunning = false;
+    g_ShaderWatcherThread.join();
+}
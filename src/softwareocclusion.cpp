@@ -0,0 +1,555 @@
+// Oclusão por software ("hierarchical Z-buffer" na CPU). A cada quadro, os
+// triângulos dos objetos oclusores (paredes, chão, teto e portas) são
+// rasterizados em um Z-buffer de baixa resolução (OCCLUSION_WIDTH x
+// OCCLUSION_HEIGHT). A partir dele construímos uma pirâmide de mipmaps onde
+// cada texel guarda a MAIOR profundidade (o oclusor mais distante) dos texels
+// que cobre. Um objeto está oculto se a sua menor profundidade (o ponto mais
+// próximo da sua bounding box) está atrás da maior profundidade de todos os
+// texels cobertos pela projeção da bounding box.
+//
+// A tela é dividida em blocos ("tiles") de OCCLUSION_TILE_WIDTH x
+// OCCLUSION_TILE_HEIGHT pixels. Os triângulos são distribuídos entre os
+// blocos que intersectam ("binning"), e cada bloco é rasterizado, junto com
+// a sua parte da pirâmide, de forma independente por uma das threads de
+// trabalho. A rasterização avalia as equações de aresta de 4 pixels por vez
+// com SSE2, quando disponível, ou de um pixel por vez.
+//
+// Referência: N. Greene, M. Kass e G. Miller, "Hierarchical Z-Buffer
+// Visibility", SIGGRAPH 1993.
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include <glad/glad.h>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include "utils.h"
+
+// Mesma condição de include/matrices.h: SSE2 somente quando o compilador o
+// gera por padrão.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOFTWAREOCCLUSION_SSE
+#include <emmintrin.h>
+#endif
+
+void CompileShader(const std::string &source, GLuint shader_id, const char *filename); // Função definida em main.cpp
+GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id); // Função definida em main.cpp
+
+#define OCCLUSION_WIDTH 256
+#define OCCLUSION_HEIGHT 128
+#define OCCLUSION_TILE_WIDTH 64
+#define OCCLUSION_TILE_HEIGHT 32
+#define OCCLUSION_TILES_X (OCCLUSION_WIDTH / OCCLUSION_TILE_WIDTH)
+#define OCCLUSION_TILES_Y (OCCLUSION_HEIGHT / OCCLUSION_TILE_HEIGHT)
+#define OCCLUSION_NUM_TILES (OCCLUSION_TILES_X * OCCLUSION_TILES_Y)
+#define OCCLUSION_NUM_LEVELS 8        // 256x128, 128x64, ..., 2x1
+#define OCCLUSION_TILE_LEVELS 6       // Níveis construídos dentro de cada bloco (até 2x1 texels por bloco)
+#define OCCLUSION_MAX_TEST_TEXELS 4   // Largura máxima, em texels, do retângulo testado em TestBox()
+#define OCCLUSION_DEBUG_TEXTURE_UNIT 29
+
+// Triângulo em coordenadas de tela (pixels do Z-buffer de oclusão), com as
+// equações das três arestas e do plano de profundidade já calculadas:
+// a aresta i contém o pixel (x,y) se edge_a[i]*x + edge_b[i]*y + edge_c[i] >= 0,
+// e a profundidade em (x,y) é depth_a*x + depth_b*y + depth_c.
+struct OcclusionTriangle
+{
+    float edge_a[3], edge_b[3], edge_c[3];
+    float depth_a, depth_b, depth_c;
+    int xmin, xmax, ymin, ymax; // Retângulo envolvente, em pixels (inclusivo)
+};
+
+static glm::mat4 g_OcclusionClip;
+static std::vector<OcclusionTriangle> g_OcclusionTriangles;
+static std::vector<unsigned int> g_OcclusionBins[OCCLUSION_NUM_TILES];
+
+// Pirâmide de profundidades. O nível 0 é o próprio Z-buffer, com a
+// profundidade em [0,1] (0 no near plane, 1 no far plane).
+alignas(16) static float g_OcclusionDepth[OCCLUSION_WIDTH * OCCLUSION_HEIGHT];
+static std::vector<float> g_OcclusionLevels[OCCLUSION_NUM_LEVELS];
+
+// Threads de trabalho. A cada chamada de SoftwareOcclusion_Rasterize(), todas
+// as threads (incluindo a thread principal) retiram blocos de
+// g_OcclusionNextTile até que todos tenham sido rasterizados.
+static std::vector<std::thread> g_OcclusionWorkers;
+static std::mutex g_OcclusionMutex;
+static std::condition_variable g_OcclusionWorkReady;
+static std::condition_variable g_OcclusionWorkDone;
+static unsigned int g_OcclusionGeneration = 0;
+static int g_OcclusionBusyWorkers = 0;
+static bool g_OcclusionQuit = false;
+static std::atomic<int> g_OcclusionNextTile(0);
+
+// Recursos da visualização do Z-buffer de oclusão. Veja SoftwareOcclusion_DrawDebug().
+static GLuint g_OcclusionDebugProgram = 0;
+static GLuint g_OcclusionDebugVAO;
+static GLuint g_OcclusionDebugVBO;
+static GLuint g_OcclusionDebugTexture;
+
+static const GLchar *const occlusiondebug_vertexshader_source = ""
+"#version 330\n"
+"layout (location = 0) in vec4 position;\n"
+"out vec2 texCoords;\n"
+"void main()\n"
+"{\n"
+    "gl_Position = vec4(position.xy, 0, 1);\n"
+    "texCoords = position.zw;\n"
+"}\n"
+"\0";
+
+static const GLchar *const occlusiondebug_fragmentshader_source = ""
+"#version 330\n"
+"uniform sampler2D tex;\n"
+"in vec2 texCoords;\n"
+"out vec4 fragColor;\n"
+"void main()\n"
+"{\n"
+    "float v = texture(tex, texCoords).r;\n"
+    "fragColor = vec4(v, v, v, 1.0);\n"
+"}\n"
+"\0";
+
+// Rasteriza os triângulos do bloco "tile" e constrói a parte da pirâmide
+// correspondente ao bloco.
+static void SoftwareOcclusion_RasterizeTile(int tile)
+{
+    int tile_x0 = (tile % OCCLUSION_TILES_X) * OCCLUSION_TILE_WIDTH;
+    int tile_y0 = (tile / OCCLUSION_TILES_X) * OCCLUSION_TILE_HEIGHT;
+    int tile_x1 = tile_x0 + OCCLUSION_TILE_WIDTH - 1;
+    int tile_y1 = tile_y0 + OCCLUSION_TILE_HEIGHT - 1;
+
+    for (int y = tile_y0; y <= tile_y1; ++y)
+        std::fill(&g_OcclusionDepth[y * OCCLUSION_WIDTH + tile_x0], &g_OcclusionDepth[y * OCCLUSION_WIDTH + tile_x1 + 1], 1.0f);
+
+    const std::vector<unsigned int> &bin = g_OcclusionBins[tile];
+    for (size_t t = 0; t < bin.size(); ++t)
+    {
+        const OcclusionTriangle &tri = g_OcclusionTriangles[bin[t]];
+
+        // Grupos de 4 pixels alinhados; pixels do grupo fora do triângulo são
+        // descartados pelas equações de aresta.
+        int x0 = std::max(tri.xmin, tile_x0) & ~3;
+        int x1 = std::min(tri.xmax, tile_x1);
+        int y0 = std::max(tri.ymin, tile_y0);
+        int y1 = std::min(tri.ymax, tile_y1);
+
+        for (int y = y0; y <= y1; ++y)
+        {
+            float py = y + 0.5f;
+            float *row = &g_OcclusionDepth[y * OCCLUSION_WIDTH];
+
+#ifdef SOFTWAREOCCLUSION_SSE
+            __m128 e_row[3], e_step[3];
+            for (int i = 0; i < 3; ++i)
+            {
+                e_row[i] = _mm_set1_ps(tri.edge_b[i] * py + tri.edge_c[i]);
+                e_step[i] = _mm_set1_ps(tri.edge_a[i]);
+            }
+            __m128 z_row = _mm_set1_ps(tri.depth_b * py + tri.depth_c);
+            __m128 z_step = _mm_set1_ps(tri.depth_a);
+            __m128 zero = _mm_setzero_ps();
+
+            for (int x = x0; x <= x1; x += 4)
+            {
+                __m128 px = _mm_add_ps(_mm_set1_ps(x + 0.5f), _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f));
+
+                __m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(e_step[0], px), e_row[0]), zero);
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(e_step[1], px), e_row[1]), zero));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(e_step[2], px), e_row[2]), zero));
+                if (_mm_movemask_ps(inside) == 0)
+                    continue;
+
+                __m128 depth = _mm_add_ps(_mm_mul_ps(z_step, px), z_row);
+                __m128 old_depth = _mm_load_ps(&row[x]);
+                __m128 new_depth = _mm_min_ps(old_depth, depth);
+                _mm_store_ps(&row[x], _mm_or_ps(_mm_and_ps(inside, new_depth), _mm_andnot_ps(inside, old_depth)));
+            }
+#else
+            for (int x = x0; x <= x1; ++x)
+            {
+                float px = x + 0.5f;
+                if (tri.edge_a[0] * px + tri.edge_b[0] * py + tri.edge_c[0] < 0.0f ||
+                    tri.edge_a[1] * px + tri.edge_b[1] * py + tri.edge_c[1] < 0.0f ||
+                    tri.edge_a[2] * px + tri.edge_b[2] * py + tri.edge_c[2] < 0.0f)
+                    continue;
+                float depth = tri.depth_a * px + tri.depth_b * py + tri.depth_c;
+                row[x] = std::min(row[x], depth);
+            }
+#endif
+        }
+    }
+
+    // Níveis da pirâmide contidos neste bloco: cada texel do nível k é o
+    // máximo dos 2x2 texels correspondentes do nível k-1.
+    for (int level = 1; level < OCCLUSION_TILE_LEVELS; ++level)
+    {
+        const float *source = (level == 1) ? g_OcclusionDepth : g_OcclusionLevels[level - 1].data();
+        float *target = g_OcclusionLevels[level].data();
+        int source_width = OCCLUSION_WIDTH >> (level - 1);
+        int target_width = OCCLUSION_WIDTH >> level;
+
+        for (int y = tile_y0 >> level; y <= tile_y1 >> level; ++y)
+        {
+            for (int x = tile_x0 >> level; x <= tile_x1 >> level; ++x)
+            {
+                const float *s = &source[2 * y * source_width + 2 * x];
+                target[y * target_width + x] = std::max(std::max(s[0], s[1]), std::max(s[source_width], s[source_width + 1]));
+            }
+        }
+    }
+}
+
+// Retira blocos da fila até que todos tenham sido rasterizados.
+static void SoftwareOcclusion_RasterizeTiles()
+{
+    int tile;
+    while ((tile = g_OcclusionNextTile.fetch_add(1)) < OCCLUSION_NUM_TILES)
+        SoftwareOcclusion_RasterizeTile(tile);
+}
+
+static void SoftwareOcclusion_WorkerLoop()
+{
+    unsigned int generation = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(g_OcclusionMutex);
+            g_OcclusionWorkReady.wait(lock, [&] { return g_OcclusionQuit || g_OcclusionGeneration != generation; });
+            if (g_OcclusionQuit)
+                return;
+            generation = g_OcclusionGeneration;
+        }
+
+        SoftwareOcclusion_RasterizeTiles();
+
+        std::lock_guard<std::mutex> lock(g_OcclusionMutex);
+        if (--g_OcclusionBusyWorkers == 0)
+            g_OcclusionWorkDone.notify_one();
+    }
+}
+
+// Inicializa a pirâmide, as threads de trabalho e a visualização do Z-buffer
+// de oclusão. São utilizadas até 7 threads além da thread principal.
+void SoftwareOcclusion_Init()
+{
+    for (int level = 1; level < OCCLUSION_NUM_LEVELS; ++level)
+        g_OcclusionLevels[level].assign((OCCLUSION_WIDTH >> level) * (OCCLUSION_HEIGHT >> level), 1.0f);
+    std::fill(g_OcclusionDepth, g_OcclusionDepth + OCCLUSION_WIDTH * OCCLUSION_HEIGHT, 1.0f);
+
+    unsigned int num_threads = std::thread::hardware_concurrency();
+    int num_workers = std::min(std::max((int)num_threads - 1, 0), 7);
+    for (int i = 0; i < num_workers; ++i)
+        g_OcclusionWorkers.push_back(std::thread(SoftwareOcclusion_WorkerLoop));
+
+    GLuint vertexshader_id = glCreateShader(GL_VERTEX_SHADER);
+    GLuint fragmentshader_id = glCreateShader(GL_FRAGMENT_SHADER);
+    CompileShader(occlusiondebug_vertexshader_source, vertexshader_id, "occlusiondebug_vertexshader_source");
+    CompileShader(occlusiondebug_fragmentshader_source, fragmentshader_id, "occlusiondebug_fragmentshader_source");
+    g_OcclusionDebugProgram = CreateGpuProgram(vertexshader_id, fragmentshader_id);
+
+    glGenVertexArrays(1, &g_OcclusionDebugVAO);
+    glGenBuffers(1, &g_OcclusionDebugVBO);
+    glBindVertexArray(g_OcclusionDebugVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, g_OcclusionDebugVBO);
+    glBufferData(GL_ARRAY_BUFFER, 24 * sizeof(float), NULL, GL_DYNAMIC_DRAW);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    glGenTextures(1, &g_OcclusionDebugTexture);
+    glActiveTexture(GL_TEXTURE0 + OCCLUSION_DEBUG_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, g_OcclusionDebugTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, OCCLUSION_WIDTH, OCCLUSION_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glUseProgram(g_OcclusionDebugProgram);
+    glUniform1i(glGetUniformLocation(g_OcclusionDebugProgram, "tex"), OCCLUSION_DEBUG_TEXTURE_UNIT);
+    glUseProgram(0);
+    glCheckError();
+
+    printf("Oclusão por software: Z-buffer %dx%d, %d blocos, %d threads\n",
+           OCCLUSION_WIDTH, OCCLUSION_HEIGHT, OCCLUSION_NUM_TILES, num_workers + 1);
+}
+
+// Termina as threads de trabalho. Deve ser chamada antes do fim do programa.
+void SoftwareOcclusion_Shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(g_OcclusionMutex);
+        g_OcclusionQuit = true;
+    }
+    g_OcclusionWorkReady.notify_all();
+    for (size_t i = 0; i < g_OcclusionWorkers.size(); ++i)
+        g_OcclusionWorkers[i].join();
+    g_OcclusionWorkers.clear();
+}
+
+// Inicia um novo quadro, com matriz clip = projection * view, descartando os
+// oclusores do quadro anterior.
+void SoftwareOcclusion_BeginFrame(const glm::mat4 &clip)
+{
+    g_OcclusionClip = clip;
+    g_OcclusionTriangles.clear();
+    for (int tile = 0; tile < OCCLUSION_NUM_TILES; ++tile)
+        g_OcclusionBins[tile].clear();
+}
+
+// Adiciona um triângulo já recortado pelo near plane (w > 0 em todos os
+// vértices) ao Z-buffer de oclusão.
+static void SoftwareOcclusion_AddTriangle(const glm::vec4 &c0, const glm::vec4 &c1, const glm::vec4 &c2)
+{
+    float x[3], y[3], z[3];
+    const glm::vec4 *clip[3] = {&c0, &c1, &c2};
+    for (int i = 0; i < 3; ++i)
+    {
+        float w = std::max(clip[i]->w, 1e-6f);
+        x[i] = (0.5f * clip[i]->x / w + 0.5f) * OCCLUSION_WIDTH;
+        y[i] = (0.5f * clip[i]->y / w + 0.5f) * OCCLUSION_HEIGHT;
+        z[i] = 0.5f * clip[i]->z / w + 0.5f;
+    }
+
+    // Triângulos de costas (ordem horária na tela) são descartados, como no
+    // Backface Culling da GPU; triângulos degenerados também.
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (area <= 0.0f)
+        return;
+
+    OcclusionTriangle tri;
+    tri.xmin = std::max((int)floorf(std::min(x[0], std::min(x[1], x[2]))), 0);
+    tri.xmax = std::min((int)ceilf(std::max(x[0], std::max(x[1], x[2]))), OCCLUSION_WIDTH - 1);
+    tri.ymin = std::max((int)floorf(std::min(y[0], std::min(y[1], y[2]))), 0);
+    tri.ymax = std::min((int)ceilf(std::max(y[0], std::max(y[1], y[2]))), OCCLUSION_HEIGHT - 1);
+    if (tri.xmin > tri.xmax || tri.ymin > tri.ymax)
+        return;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        int a = (i + 1) % 3;
+        int b = (i + 2) % 3;
+        tri.edge_a[i] = -(y[b] - y[a]);
+        tri.edge_b[i] = x[b] - x[a];
+        tri.edge_c[i] = (y[b] - y[a]) * x[a] - (x[b] - x[a]) * y[a];
+    }
+
+    tri.depth_a = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+    tri.depth_b = ((x[1] - x[0]) * (z[2] - z[0]) - (x[2] - x[0]) * (z[1] - z[0])) / area;
+    tri.depth_c = z[0] - tri.depth_a * x[0] - tri.depth_b * y[0];
+
+    unsigned int index = (unsigned int)g_OcclusionTriangles.size();
+    g_OcclusionTriangles.push_back(tri);
+
+    for (int ty = tri.ymin / OCCLUSION_TILE_HEIGHT; ty <= tri.ymax / OCCLUSION_TILE_HEIGHT; ++ty)
+        for (int tx = tri.xmin / OCCLUSION_TILE_WIDTH; tx <= tri.xmax / OCCLUSION_TILE_WIDTH; ++tx)
+            g_OcclusionBins[ty * OCCLUSION_TILES_X + tx].push_back(index);
+}
+
+// Adiciona os triângulos de um objeto oclusor, com matriz de modelagem
+// "model". "positions" contém as coordenadas (x,y,z) de "num_vertices"
+// vértices, onde cada três vértices consecutivos formam um triângulo.
+void SoftwareOcclusion_AddOccluder(const glm::mat4 &model, const float *positions, size_t num_vertices)
+{
+    glm::mat4 clip_model = g_OcclusionClip * model;
+
+    for (size_t v = 0; v + 3 <= num_vertices; v += 3)
+    {
+        glm::vec4 input[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            const float *p = &positions[3 * (v + i)];
+            input[i] = clip_model * glm::vec4(p[0], p[1], p[2], 1.0f);
+        }
+
+        // Recorte pelo near plane (z >= -w), com o algoritmo de
+        // Sutherland-Hodgman. O resultado tem até 4 vértices.
+        glm::vec4 polygon[4];
+        int num_polygon = 0;
+        for (int i = 0; i < 3; ++i)
+        {
+            const glm::vec4 &current = input[i];
+            const glm::vec4 &next = input[(i + 1) % 3];
+            float current_d = current.z + current.w;
+            float next_d = next.z + next.w;
+
+            if (current_d >= 0.0f)
+                polygon[num_polygon++] = current;
+            if ((current_d >= 0.0f) != (next_d >= 0.0f))
+                polygon[num_polygon++] = current + (next - current) * (current_d / (current_d - next_d));
+        }
+
+        for (int i = 1; i + 1 < num_polygon; ++i)
+            SoftwareOcclusion_AddTriangle(polygon[0], polygon[i], polygon[i + 1]);
+    }
+}
+
+// Rasteriza todos os oclusores adicionados desde SoftwareOcclusion_BeginFrame()
+// e constrói a pirâmide de profundidades, dividindo os blocos entre as
+// threads de trabalho.
+void SoftwareOcclusion_Rasterize()
+{
+    g_OcclusionNextTile = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(g_OcclusionMutex);
+        g_OcclusionGeneration += 1;
+        g_OcclusionBusyWorkers = (int)g_OcclusionWorkers.size();
+    }
+    g_OcclusionWorkReady.notify_all();
+
+    SoftwareOcclusion_RasterizeTiles();
+
+    {
+        std::unique_lock<std::mutex> lock(g_OcclusionMutex);
+        g_OcclusionWorkDone.wait(lock, [] { return g_OcclusionBusyWorkers == 0; });
+    }
+
+    // Últimos níveis da pirâmide, menores que um bloco.
+    for (int level = OCCLUSION_TILE_LEVELS; level < OCCLUSION_NUM_LEVELS; ++level)
+    {
+        const float *source = g_OcclusionLevels[level - 1].data();
+        float *target = g_OcclusionLevels[level].data();
+        int source_width = OCCLUSION_WIDTH >> (level - 1);
+        int target_width = OCCLUSION_WIDTH >> level;
+        int target_height = OCCLUSION_HEIGHT >> level;
+
+        for (int y = 0; y < target_height; ++y)
+        {
+            for (int x = 0; x < target_width; ++x)
+            {
+                const float *s = &source[2 * y * source_width + 2 * x];
+                target[y * target_width + x] = std::max(std::max(s[0], s[1]), std::max(s[source_width], s[source_width + 1]));
+            }
+        }
+    }
+}
+
+// Retorna o número de triângulos rasterizados no quadro atual.
+size_t SoftwareOcclusion_NumTriangles()
+{
+    return g_OcclusionTriangles.size();
+}
+
+// Testa a AABB [bbox_min, bbox_max] (em coordenadas de modelo) de um objeto
+// com matriz de modelagem "model" contra a pirâmide de profundidades.
+// Retorna false somente se o objeto está certamente oculto pelos oclusores.
+bool SoftwareOcclusion_TestBox(const glm::mat4 &model, glm::vec3 bbox_min, glm::vec3 bbox_max)
+{
+    glm::mat4 clip_model = g_OcclusionClip * model;
+
+    float xmin = INFINITY, xmax = -INFINITY;
+    float ymin = INFINITY, ymax = -INFINITY;
+    float zmin = INFINITY;
+    for (int i = 0; i < 8; ++i)
+    {
+        glm::vec4 corner = glm::vec4((i & 1) ? bbox_max.x : bbox_min.x,
+                                     (i & 2) ? bbox_max.y : bbox_min.y,
+                                     (i & 4) ? bbox_max.z : bbox_min.z, 1.0f);
+        glm::vec4 c = clip_model * corner;
+
+        // Caixa atravessando o near plane: consideramos visível.
+        if (c.z < -c.w || c.w <= 0.0f)
+            return true;
+
+        xmin = std::min(xmin, c.x / c.w);
+        xmax = std::max(xmax, c.x / c.w);
+        ymin = std::min(ymin, c.y / c.w);
+        ymax = std::max(ymax, c.y / c.w);
+        zmin = std::min(zmin, c.z / c.w);
+    }
+
+    int x0 = std::max((int)floorf((0.5f * xmin + 0.5f) * OCCLUSION_WIDTH), 0);
+    int x1 = std::min((int)floorf((0.5f * xmax + 0.5f) * OCCLUSION_WIDTH), OCCLUSION_WIDTH - 1);
+    int y0 = std::max((int)floorf((0.5f * ymin + 0.5f) * OCCLUSION_HEIGHT), 0);
+    int y1 = std::min((int)floorf((0.5f * ymax + 0.5f) * OCCLUSION_HEIGHT), OCCLUSION_HEIGHT - 1);
+
+    // Fora da tela: a decisão fica com o frustum culling.
+    if (x0 > x1 || y0 > y1)
+        return true;
+
+    float depth = 0.5f * zmin + 0.5f;
+
+    // Escolhemos o nível mais fino onde o retângulo cobre no máximo
+    // OCCLUSION_MAX_TEST_TEXELS x OCCLUSION_MAX_TEST_TEXELS texels.
+    int level = 0;
+    while (level < OCCLUSION_NUM_LEVELS - 1 &&
+           ((x1 >> level) - (x0 >> level) >= OCCLUSION_MAX_TEST_TEXELS || (y1 >> level) - (y0 >> level) >= OCCLUSION_MAX_TEST_TEXELS))
+        level += 1;
+
+    const float *texels = (level == 0) ? g_OcclusionDepth : g_OcclusionLevels[level].data();
+    int width = OCCLUSION_WIDTH >> level;
+    for (int y = y0 >> level; y <= y1 >> level; ++y)
+    {
+        for (int x = x0 >> level; x <= x1 >> level; ++x)
+        {
+            if (depth <= texels[y * width + x])
+                return true;
+        }
+    }
+    return false;
+}
+
+// Converte o Z-buffer de oclusão do último quadro em uma imagem em tons de
+// cinza, para ajuste da escolha de oclusores. Pixels mais claros são
+// oclusores mais próximos; pixels sem oclusores são pretos. A imagem é lida
+// pela thread que rasteriza os oclusores, e pode ser desenhada por outra
+// thread com SoftwareOcclusion_DrawDebug().
+void SoftwareOcclusion_ReadDebugImage(std::vector<unsigned char> &pixels)
+{
+    pixels.resize(OCCLUSION_WIDTH * OCCLUSION_HEIGHT);
+
+    // Em projeção perspectiva, 1/(1 - profundidade) é proporcional à
+    // distância até a câmera. Normalizamos pela maior distância da imagem.
+    float max_distance = 0.0f;
+    for (int i = 0; i < OCCLUSION_WIDTH * OCCLUSION_HEIGHT; ++i)
+    {
+        if (g_OcclusionDepth[i] < 1.0f)
+            max_distance = std::max(max_distance, 1.0f / (1.0f - g_OcclusionDepth[i]));
+    }
+    for (int i = 0; i < OCCLUSION_WIDTH * OCCLUSION_HEIGHT; ++i)
+    {
+        if (g_OcclusionDepth[i] < 1.0f)
+            pixels[i] = (unsigned char)(255.0f * (1.0f - 0.8f * (1.0f / (1.0f - g_OcclusionDepth[i])) / max_distance));
+        else
+            pixels[i] = 0;
+    }
+}
+
+// Desenha a imagem lida por SoftwareOcclusion_ReadDebugImage() no retângulo
+// [x0,x1]x[y0,y1] (em NDC) da tela.
+void SoftwareOcclusion_DrawDebug(const unsigned char *pixels, float x0, float y0, float x1, float y1)
+{
+    glActiveTexture(GL_TEXTURE0 + OCCLUSION_DEBUG_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, g_OcclusionDebugTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, OCCLUSION_WIDTH, OCCLUSION_HEIGHT, GL_RED, GL_UNSIGNED_BYTE, pixels);
+
+    float data[24] = {
+        x0, y0, 0.0f, 0.0f,
+        x1, y0, 1.0f, 0.0f,
+        x1, y1, 1.0f, 1.0f,
+        x0, y0, 0.0f, 0.0f,
+        x1, y1, 1.0f, 1.0f,
+        x0, y1, 0.0f, 1.0f};
+
+    glBindBuffer(GL_ARRAY_BUFFER, g_OcclusionDebugVBO);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(data), data);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glDepthFunc(GL_ALWAYS);
+    glUseProgram(g_OcclusionDebugProgram);
+    glBindVertexArray(g_OcclusionDebugVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glBindVertexArray(0);
+    glDepthFunc(GL_LESS);
+}
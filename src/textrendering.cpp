@@ -1,6 +1,18 @@
 // Based on http://hamelot.io/visualization/opengl-text-without-any-external-libraries/
 //   and on https://github.com/rougier/freetype-gl
+//
+// O texto é desenhado a partir de um atlas de "signed distance fields" (SDF),
+// gerado em TextRendering_Init() a partir do atlas de cobertura de
+// "dejavufont.h": cada texel guarda a distância (com sinal) até a borda do
+// glifo, e o fragment shader recorta a borda com smoothstep(). Como a
+// distância é interpolada linearmente, o mesmo atlas (e o mesmo programa)
+// serve para qualquer escala do texto sem serrilhado nem borrões. Veja
+// Green, "Improved Alpha-Tested Magnification for Vector Textures and
+// Special Effects", SIGGRAPH 2007.
+#include <cmath>
 #include <string>
+#include <vector>
+#include <algorithm>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -9,9 +21,15 @@
 #include <glm/vec4.hpp>
 
 #include "utils.h"
+#include "profiler.h"
 #include "dejavufont.h"
 
 GLuint CreateGpuProgram(GLuint vertex_shader_id, GLuint fragment_shader_id); // Função definida em main.cpp
+double GetTimeSeconds();                                                     // Função definida em main.cpp
+
+// Funções definidas em programcache.cpp
+GLuint ProgramCache_Load(const std::string &vertex_source, const std::string &fragment_source);
+void ProgramCache_Store(const std::string &vertex_source, const std::string &fragment_source, GLuint program_id);
 
 const GLchar* const textvertexshader_source = ""
 "#version 330\n"
@@ -24,6 +42,9 @@ const GLchar* const textvertexshader_source = ""
 "}\n"
 "\0";
 
+// A borda do glifo é a isolinha 0.5 do atlas SDF. A largura da transição é
+// calculada pela variação da distância entre pixels vizinhos da tela, de
+// forma que a borda tenha cerca de um pixel de largura em qualquer escala.
 const GLchar* const textfragmentshader_source = ""
 "#version 330\n"
 "uniform sampler2D tex;\n"
@@ -31,7 +52,10 @@ const GLchar* const textfragmentshader_source = ""
 "out vec4 fragColor;\n"
 "void main()\n"
 "{\n"
-    "fragColor = vec4(0, 0, 0, texture(tex, texCoords).r);\n"
+    "float distance = texture(tex, texCoords).r;\n"
+    "float width = 0.7 * length(vec2(dFdx(distance), dFdy(distance)));\n"
+    "float alpha = smoothstep(0.5 - width, 0.5 + width, distance);\n"
+    "fragColor = vec4(0, 0, 0, alpha);\n"
 "}\n"
 "\0";
 
@@ -87,6 +111,216 @@ GLuint textVBO;
 GLuint textprogram_id;
 GLuint texttexture_id;
 
+// Vértices (x, y, s, t) dos glifos do quadro atual. TextRendering_PrintString()
+// apenas acrescenta os 6 vértices de cada glifo a este vetor; todos os glifos
+// são enviados à GPU e desenhados de uma só vez por TextRendering_Flush().
+static std::vector<float> g_TextVertices;
+static size_t g_TextBufferCapacity = 0; // Tamanho atual de textVBO, em floats
+
+// Parâmetros do atlas SDF. As distâncias são medidas em pixels do atlas
+// original de "dejavufont.h".
+#define TEXT_SDF_SCALE 1        // Texels do atlas SDF por pixel do atlas original
+#define TEXT_SDF_SPREAD 2       // Distância máxima guardada, para dentro e para fora do glifo
+#define TEXT_SDF_SUPERSAMPLE 4  // Resolução (por pixel do atlas original) da transformada de distância
+#define TEXT_SDF_ATLAS_WIDTH 512
+
+// Glifo do atlas SDF: o glifo de "dejavufont.h", para as métricas, e a região
+// do atlas SDF, a qual inclui TEXT_SDF_SPREAD pixels de margem em cada lado.
+struct TextGlyph
+{
+    const texture_glyph_t *glyph;
+    float s0, t0, s1, t1;
+};
+
+// Tabela de glifos indexada pelo "codepoint" Unicode, construída uma única vez
+// em TextRendering_Init(). Entradas nulas são caracteres sem glifo no atlas.
+#define TEXT_GLYPH_TABLE_SIZE 256
+static TextGlyph g_GlyphTable[TEXT_GLYPH_TABLE_SIZE];
+
+// Tamanho da janela, em coordenadas de tela, atualizado somente quando a
+// janela é redimensionada (veja TextRendering_SetWindowSize()).
+static int g_TextWindowWidth = 800;
+static int g_TextWindowHeight = 600;
+
+// Texto já posicionado por TextRendering_PrintLayout(): os vértices dos seus
+// glifos e os parâmetros com que foram calculados.
+struct TextLayout
+{
+    std::string text;
+    float x, y, scale;
+    int window_width, window_height;
+    std::vector<float> vertices;
+};
+static std::vector<TextLayout> g_TextLayouts;
+
+// Transformada de distância euclidiana em duas passadas (8SSEDT, veja
+// Danielsson, "Euclidean Distance Mapping", 1980). Na entrada, "vx" e "vy" são
+// nulos nos pixels de origem e grandes nos demais; na saída, (vx,vy) é o
+// vetor de cada pixel até a origem mais próxima.
+static void TextRendering_DistanceTransform(int *vx, int *vy, int width, int height)
+{
+    #define TEXT_EDT_COMPARE(x, y, dx, dy)                                             \
+        if ((x) + (dx) >= 0 && (x) + (dx) < width && (y) + (dy) >= 0 && (y) + (dy) < height) \
+        {                                                                            \
+            int p = (y) * width + (x);                                               \
+            int q = ((y) + (dy)) * width + (x) + (dx);                               \
+            int cx = vx[q] + (dx), cy = vy[q] + (dy);                                \
+            if (cx * cx + cy * cy < vx[p] * vx[p] + vy[p] * vy[p])                   \
+            {                                                                        \
+                vx[p] = cx;                                                          \
+                vy[p] = cy;                                                          \
+            }                                                                        \
+        }
+
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            TEXT_EDT_COMPARE(x, y, -1, 0);
+            TEXT_EDT_COMPARE(x, y, 0, -1);
+            TEXT_EDT_COMPARE(x, y, -1, -1);
+            TEXT_EDT_COMPARE(x, y, 1, -1);
+        }
+        for (int x = width - 1; x >= 0; --x)
+            TEXT_EDT_COMPARE(x, y, 1, 0);
+    }
+
+    for (int y = height - 1; y >= 0; --y)
+    {
+        for (int x = width - 1; x >= 0; --x)
+        {
+            TEXT_EDT_COMPARE(x, y, 1, 0);
+            TEXT_EDT_COMPARE(x, y, 0, 1);
+            TEXT_EDT_COMPARE(x, y, -1, 1);
+            TEXT_EDT_COMPARE(x, y, 1, 1);
+        }
+        for (int x = 0; x < width; ++x)
+            TEXT_EDT_COMPARE(x, y, -1, 0);
+    }
+
+    #undef TEXT_EDT_COMPARE
+}
+
+// Gera o campo de distâncias de um glifo, com (glyph.width + 2*SPREAD)*SCALE
+// por (glyph.height + 2*SPREAD)*SCALE texels, em "sdf" (com "pitch" bytes por
+// linha). A cobertura do glifo no atlas original é interpolada bilinearmente
+// em uma grade TEXT_SDF_SUPERSAMPLE vezes mais fina, a qual é limiarizada em
+// 50% para obter a forma do glifo; a distância de cada texel é então a
+// distância, nesta grade, até o pixel mais próximo do lado oposto da borda.
+static void TextRendering_GenerateGlyphSDF(const texture_glyph_t &glyph, unsigned char *sdf, int pitch)
+{
+    const int SS = TEXT_SDF_SUPERSAMPLE;
+    int width = (glyph.width + 2 * TEXT_SDF_SPREAD) * SS;
+    int height = (glyph.height + 2 * TEXT_SDF_SPREAD) * SS;
+
+    int atlas_x = (int)floorf(glyph.s0 * dejavufont.tex_width + 0.5f);
+    int atlas_y = (int)floorf(glyph.t0 * dejavufont.tex_height + 0.5f);
+
+    // Cobertura do pixel (x,y) do glifo, nula fora do mesmo.
+    #define TEXT_COVERAGE(x, y) \
+        (((x) >= 0 && (x) < glyph.width && (y) >= 0 && (y) < glyph.height) ? dejavufont.tex_data[(atlas_y + (y)) * dejavufont.tex_width + atlas_x + (x)] / 255.0f : 0.0f)
+
+    const int FAR = 1 << 14;
+    std::vector<int> inside_x(width * height), inside_y(width * height);   // Vetor até o pixel interno mais próximo
+    std::vector<int> outside_x(width * height), outside_y(width * height); // Vetor até o pixel externo mais próximo
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            // Posição do pixel da grade fina em pixels do glifo original,
+            // relativa ao centro do primeiro pixel.
+            float gx = (x + 0.5f) / SS - TEXT_SDF_SPREAD - 0.5f;
+            float gy = (y + 0.5f) / SS - TEXT_SDF_SPREAD - 0.5f;
+            int ix = (int)floorf(gx), iy = (int)floorf(gy);
+            float fx = gx - ix, fy = gy - iy;
+            float coverage = (1 - fy) * ((1 - fx) * TEXT_COVERAGE(ix, iy) + fx * TEXT_COVERAGE(ix + 1, iy)) +
+                             fy * ((1 - fx) * TEXT_COVERAGE(ix, iy + 1) + fx * TEXT_COVERAGE(ix + 1, iy + 1));
+
+            bool inside = coverage > 0.5f;
+            int p = y * width + x;
+            inside_x[p] = inside_y[p] = inside ? 0 : FAR;
+            outside_x[p] = outside_y[p] = inside ? FAR : 0;
+        }
+    }
+    #undef TEXT_COVERAGE
+
+    TextRendering_DistanceTransform(inside_x.data(), inside_y.data(), width, height);
+    TextRendering_DistanceTransform(outside_x.data(), outside_y.data(), width, height);
+
+    // Cada texel do atlas SDF cobre SS/SCALE pixels da grade fina; a
+    // distância é a do pixel central. A borda fica entre os centros de dois
+    // pixels vizinhos, a meio pixel de cada um.
+    int sdf_width = width / (SS / TEXT_SDF_SCALE);
+    int sdf_height = height / (SS / TEXT_SDF_SCALE);
+    for (int y = 0; y < sdf_height; ++y)
+    {
+        for (int x = 0; x < sdf_width; ++x)
+        {
+            int p = (y * SS / TEXT_SDF_SCALE + SS / TEXT_SDF_SCALE / 2) * width + x * SS / TEXT_SDF_SCALE + SS / TEXT_SDF_SCALE / 2;
+            float to_inside = sqrtf((float)(inside_x[p] * inside_x[p] + inside_y[p] * inside_y[p]));
+            float to_outside = sqrtf((float)(outside_x[p] * outside_x[p] + outside_y[p] * outside_y[p]));
+            float distance = (to_inside > 0.0f) ? -(to_inside - 0.5f) : (to_outside - 0.5f); // Positiva dentro do glifo
+            distance /= SS;
+
+            float value = 0.5f + 0.5f * distance / TEXT_SDF_SPREAD;
+            sdf[y * pitch + x] = (unsigned char)(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+        }
+    }
+}
+
+// Gera o atlas SDF de todos os glifos de "dejavufont.h", dispostos em
+// prateleiras ("shelf packing") de TEXT_SDF_ATLAS_WIDTH texels de largura, e
+// preenche g_GlyphTable. Retorna o atlas em "atlas", com "atlas_height"
+// linhas (potência de dois).
+static void TextRendering_BuildSDFAtlas(std::vector<unsigned char> &atlas, int &atlas_height)
+{
+    struct Placement
+    {
+        int x, y;
+    };
+    std::vector<Placement> placements(dejavufont.glyphs_count);
+
+    // Posição de cada glifo no atlas, com um texel de separação.
+    int shelf_x = 0, shelf_y = 0, shelf_height = 0;
+    for (size_t j = 0; j < dejavufont.glyphs_count; ++j)
+    {
+        const texture_glyph_t &glyph = dejavufont.glyphs[j];
+        int w = (glyph.width + 2 * TEXT_SDF_SPREAD) * TEXT_SDF_SCALE;
+        int h = (glyph.height + 2 * TEXT_SDF_SPREAD) * TEXT_SDF_SCALE;
+        if (shelf_x + w > TEXT_SDF_ATLAS_WIDTH)
+        {
+            shelf_x = 0;
+            shelf_y += shelf_height + 1;
+            shelf_height = 0;
+        }
+        placements[j].x = shelf_x;
+        placements[j].y = shelf_y;
+        shelf_x += w + 1;
+        shelf_height = std::max(shelf_height, h);
+    }
+
+    atlas_height = 1;
+    while (atlas_height < shelf_y + shelf_height)
+        atlas_height *= 2;
+    atlas.assign(TEXT_SDF_ATLAS_WIDTH * atlas_height, 0);
+
+    for (size_t j = 0; j < dejavufont.glyphs_count; ++j)
+    {
+        const texture_glyph_t &glyph = dejavufont.glyphs[j];
+        TextRendering_GenerateGlyphSDF(glyph, &atlas[placements[j].y * TEXT_SDF_ATLAS_WIDTH + placements[j].x], TEXT_SDF_ATLAS_WIDTH);
+
+        if (glyph.codepoint < TEXT_GLYPH_TABLE_SIZE)
+        {
+            TextGlyph &entry = g_GlyphTable[glyph.codepoint];
+            entry.glyph = &glyph;
+            entry.s0 = (float)placements[j].x / TEXT_SDF_ATLAS_WIDTH;
+            entry.t0 = (float)placements[j].y / atlas_height;
+            entry.s1 = (float)(placements[j].x + (glyph.width + 2 * TEXT_SDF_SPREAD) * TEXT_SDF_SCALE) / TEXT_SDF_ATLAS_WIDTH;
+            entry.t1 = (float)(placements[j].y + (glyph.height + 2 * TEXT_SDF_SPREAD) * TEXT_SDF_SCALE) / atlas_height;
+        }
+    }
+}
+
 void TextRendering_Init()
 {
     GLuint sampler;
@@ -101,33 +335,52 @@ void TextRendering_Init()
     glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glCheckError();
 
-    GLuint textvertexshader_id = glCreateShader(GL_VERTEX_SHADER);
-    TextRendering_LoadShader(textvertexshader_source, textvertexshader_id);
-    glCheckError();
-
-    GLuint textfragmentshader_id = glCreateShader(GL_FRAGMENT_SHADER);
-    TextRendering_LoadShader(textfragmentshader_source, textfragmentshader_id);
-    glCheckError();
-
-    textprogram_id = CreateGpuProgram(textvertexshader_id, textfragmentshader_id);
-    glLinkProgram(textprogram_id);
+    // O programa é carregado do cache de programas, se disponível, e
+    // compilado somente na primeira execução.
+    textprogram_id = ProgramCache_Load(textvertexshader_source, textfragmentshader_source);
+    if (textprogram_id == 0)
+    {
+        GLuint textvertexshader_id = glCreateShader(GL_VERTEX_SHADER);
+        TextRendering_LoadShader(textvertexshader_source, textvertexshader_id);
+        glCheckError();
+
+        GLuint textfragmentshader_id = glCreateShader(GL_FRAGMENT_SHADER);
+        TextRendering_LoadShader(textfragmentshader_source, textfragmentshader_id);
+        glCheckError();
+
+        // CreateGpuProgram() chama ProgramCache_PrepareLink() antes de
+        // glLinkProgram(); sem isso alguns drivers não guardam o binário.
+        textprogram_id = CreateGpuProgram(textvertexshader_id, textfragmentshader_id);
+        ProgramCache_Store(textvertexshader_source, textfragmentshader_source, textprogram_id);
+    }
     glCheckError();
 
     GLuint texttex_uniform;
     texttex_uniform = glGetUniformLocation(textprogram_id, "tex");
     glCheckError();
 
+    double start = GetTimeSeconds();
+    std::vector<unsigned char> atlas;
+    int atlas_height;
+    TextRendering_BuildSDFAtlas(atlas, atlas_height);
+    printf("Texto: atlas SDF %dx%d gerado em %.1f ms\n", TEXT_SDF_ATLAS_WIDTH, atlas_height, (GetTimeSeconds() - start) * 1000.0);
+
     GLuint textureunit = 31;
     glActiveTexture(GL_TEXTURE0 + textureunit);
     glBindTexture(GL_TEXTURE_2D, texttexture_id);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, dejavufont.tex_width, dejavufont.tex_height, 0, GL_RED, GL_UNSIGNED_BYTE, dejavufont.tex_data);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, TEXT_SDF_ATLAS_WIDTH, atlas_height, 0, GL_RED, GL_UNSIGNED_BYTE, atlas.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
     glBindSampler(textureunit, sampler);
     glCheckError();
 
     glBindVertexArray(textVAO);
 
+    // Espaço inicial para 256 glifos; o buffer cresce em TextRendering_Flush().
+    g_TextBufferCapacity = 256 * 24;
+    g_TextVertices.reserve(g_TextBufferCapacity);
     glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-    glBufferData(GL_ARRAY_BUFFER, 24 * sizeof(float), NULL, GL_DYNAMIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, g_TextBufferCapacity * sizeof(float), NULL, GL_STREAM_DRAW);
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, 0);
     glEnableVertexAttribArray(0);
     glCheckError();
@@ -142,87 +395,187 @@ void TextRendering_Init()
     glCheckError();
 }
 
-float textscale = 1.5f;
+// Atualiza o tamanho da janela utilizado na conversão de pixels do atlas para
+// coordenadas NDC. Chamada por FramebufferSizeCallback() em main.cpp.
+void TextRendering_SetWindowSize(int width, int height)
+{
+    if (width > 0 && height > 0)
+    {
+        g_TextWindowWidth = width;
+        g_TextWindowHeight = height;
+    }
+}
 
-void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float x, float y, float scale = 1.0f)
+// Decodifica o caractere UTF-8 que inicia na posição "i" de "str", avançando
+// "i" para o próximo caractere. Sequências inválidas resultam em U+FFFD.
+static uint32_t TextRendering_DecodeUTF8(const std::string &str, size_t &i)
 {
-    scale *= textscale;
-    int width, height;
-    glfwGetWindowSize(window, &width, &height);
-    float sx = scale / width;
-    float sy = scale / height;
+    unsigned char c = (unsigned char)str[i++];
+    if (c < 0x80)
+        return c;
 
-    for (size_t i = 0; i < str.size(); i++)
+    int length;
+    uint32_t codepoint;
+    if ((c & 0xE0) == 0xC0)
     {
-        // Find the glyph for the character we are looking for
-        texture_glyph_t *glyph = 0;
-        for (size_t j = 0; j < dejavufont.glyphs_count; ++j)
-        {
-            if (dejavufont.glyphs[j].codepoint == (uint32_t)str[i])
-            {
-                glyph = &dejavufont.glyphs[j];
-                break;
-            }
-        }
-        if (!glyph) {
+        length = 1;
+        codepoint = c & 0x1F;
+    }
+    else if ((c & 0xF0) == 0xE0)
+    {
+        length = 2;
+        codepoint = c & 0x0F;
+    }
+    else if ((c & 0xF8) == 0xF0)
+    {
+        length = 3;
+        codepoint = c & 0x07;
+    }
+    else
+        return 0xFFFD;
+
+    for (int k = 0; k < length; ++k)
+    {
+        if (i >= str.size() || ((unsigned char)str[i] & 0xC0) != 0x80)
+            return 0xFFFD;
+        codepoint = (codepoint << 6) | ((unsigned char)str[i++] & 0x3F);
+    }
+    return codepoint;
+}
+
+// Acrescenta a "vertices" os vértices dos glifos de "str", em UTF-8, com a
+// linha de base iniciando em (x,y).
+static void TextRendering_LayoutString(const std::string &str, float x, float y, float scale, std::vector<float> &vertices)
+{
+    float sx = scale / g_TextWindowWidth;
+    float sy = scale / g_TextWindowHeight;
+
+    for (size_t i = 0; i < str.size();)
+    {
+        uint32_t codepoint = TextRendering_DecodeUTF8(str, i);
+        if (codepoint >= TEXT_GLYPH_TABLE_SIZE || !g_GlyphTable[codepoint].glyph) {
             continue;
         }
+        const TextGlyph &entry = g_GlyphTable[codepoint];
+        const texture_glyph_t *glyph = entry.glyph;
         x += glyph->kerning[0].kerning;
-        float x0 = (float) (x + glyph->offset_x * sx);
-        float y0 = (float) (y + glyph->offset_y * sy);
-        float x1 = (float) (x0 + glyph->width * sx);
-        float y1 = (float) (y0 - glyph->height * sy);
-
-        float s0 = glyph->s0 - 0.5f/dejavufont.tex_width;
-        float t0 = glyph->t0 - 0.5f/dejavufont.tex_height;
-        float s1 = glyph->s1 - 0.5f/dejavufont.tex_width;
-        float t1 = glyph->t1 - 0.5f/dejavufont.tex_height;
-
-        struct {float x, y, s, t;} data[6] = {
-            { x0, y0, s0, t0 },
-            { x0, y1, s0, t1 },
-            { x1, y1, s1, t1 },
-            { x0, y0, s0, t0 },
-            { x1, y1, s1, t1 },
-            { x1, y0, s1, t0 }
+
+        // O quadrilátero inclui a margem do atlas SDF em volta do glifo.
+        float x0 = (float) (x + (glyph->offset_x - TEXT_SDF_SPREAD) * sx);
+        float y0 = (float) (y + (glyph->offset_y + TEXT_SDF_SPREAD) * sy);
+        float x1 = (float) (x0 + (glyph->width + 2 * TEXT_SDF_SPREAD) * sx);
+        float y1 = (float) (y0 - (glyph->height + 2 * TEXT_SDF_SPREAD) * sy);
+
+        float s0 = entry.s0;
+        float t0 = entry.t0;
+        float s1 = entry.s1;
+        float t1 = entry.t1;
+
+        const float data[24] = {
+            x0, y0, s0, t0,
+            x0, y1, s0, t1,
+            x1, y1, s1, t1,
+            x0, y0, s0, t0,
+            x1, y1, s1, t1,
+            x1, y0, s1, t0
         };
+        vertices.insert(vertices.end(), data, data + 24);
 
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        x += (glyph->advance_x * sx);
+    }
+}
 
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-        glDepthFunc(GL_ALWAYS);
-        glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, 24 * sizeof(float), data);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+float textscale = 1.5f;
 
-        glUseProgram(textprogram_id);
-        glBindVertexArray(textVAO);
+void TextRendering_PrintString(GLFWwindow* window, const std::string &str, float x, float y, float scale = 1.0f)
+{
+    TextRendering_LayoutString(str, x, y, scale * textscale, g_TextVertices);
+}
+
+// Cria um texto com posicionamento guardado entre quadros, e retorna o seu
+// identificador para TextRendering_PrintLayout().
+int TextRendering_NewLayout()
+{
+    g_TextLayouts.push_back(TextLayout());
+    g_TextLayouts.back().scale = 0.0f;
+    return (int)g_TextLayouts.size() - 1;
+}
+
+// Equivalente a TextRendering_PrintString() para textos que raramente mudam
+// (rótulos, estatísticas atualizadas a cada segundo): os glifos só são
+// posicionados novamente quando o texto, a posição, a escala ou o tamanho da
+// janela diferem da chamada anterior com o mesmo "layout"; caso contrário os
+// vértices guardados são simplesmente copiados para o quadro.
+void TextRendering_PrintLayout(GLFWwindow* window, int layout, const std::string &str, float x, float y, float scale = 1.0f)
+{
+    TextLayout &cached = g_TextLayouts[layout];
+    if (cached.text != str || cached.x != x || cached.y != y || cached.scale != scale ||
+        cached.window_width != g_TextWindowWidth || cached.window_height != g_TextWindowHeight)
+    {
+        cached.text = str;
+        cached.x = x;
+        cached.y = y;
+        cached.scale = scale;
+        cached.window_width = g_TextWindowWidth;
+        cached.window_height = g_TextWindowHeight;
+        cached.vertices.clear();
+        TextRendering_LayoutString(str, x, y, scale * textscale, cached.vertices);
+    }
 
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+    g_TextVertices.insert(g_TextVertices.end(), cached.vertices.begin(), cached.vertices.end());
+}
 
-        glBindVertexArray(0);
-        glUseProgram(0);
-        glDepthFunc(GL_LESS);
+// Desenha, com uma única chamada de desenho, todos os glifos acumulados por
+// TextRendering_PrintString() desde a chamada anterior, e esvazia a lista.
+// Deve ser chamada antes de glfwSwapBuffers() (ou entre "camadas" de texto
+// que devem ser desenhadas em ordem com outros objetos).
+void TextRendering_Flush()
+{
+    PROFILE_FUNCTION();
 
-        glDisable(GL_BLEND);
+    if (g_TextVertices.empty())
+        return;
 
-        x += (glyph->advance_x * sx);
-    }
+    glBindBuffer(GL_ARRAY_BUFFER, textVBO);
+
+    // O buffer cresce, dobrando de tamanho, quando o texto do quadro não cabe
+    // nele. Caso contrário é "orfanado" (glBufferData com NULL), de forma que
+    // o driver não precise esperar a GPU terminar o desenho do quadro
+    // anterior para reescrevê-lo.
+    while (g_TextBufferCapacity < g_TextVertices.size())
+        g_TextBufferCapacity *= 2;
+    glBufferData(GL_ARRAY_BUFFER, g_TextBufferCapacity * sizeof(float), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, g_TextVertices.size() * sizeof(float), g_TextVertices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glDepthFunc(GL_ALWAYS);
+
+    glUseProgram(textprogram_id);
+    glBindVertexArray(textVAO);
+
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)(g_TextVertices.size() / 4));
+
+    glBindVertexArray(0);
+    glUseProgram(0);
+    glDepthFunc(GL_LESS);
+
+    glDisable(GL_BLEND);
+
+    g_TextVertices.clear();
 }
 
 float TextRendering_LineHeight(GLFWwindow* window)
 {
-    int width, height;
-    glfwGetWindowSize(window, &width, &height);
-    return dejavufont.height / height * textscale;
+    return dejavufont.height / g_TextWindowHeight * textscale;
 }
 
 float TextRendering_CharWidth(GLFWwindow* window)
 {
-    int width, height;
-    glfwGetWindowSize(window, &width, &height);
-    return dejavufont.glyphs[32].advance_x / width * textscale;
+    return dejavufont.glyphs[32].advance_x / g_TextWindowWidth * textscale;
 }
 
 void TextRendering_PrintMatrix(GLFWwindow* window, glm::mat4 M, float x, float y, float scale = 1.0f)